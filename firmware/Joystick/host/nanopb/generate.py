@@ -0,0 +1,415 @@
+#!/usr/bin/env python3
+# Generates the messages of a .proto file for the host stand-in for nanopb (see pb.h), as <name>.pb.h and <name>.pb.c
+# The structs, initializers, tags and sizes are the ones the nanopb generator makes, so code written against nanopb builds
+# The .options file is read like nanopb does with --error-on-unmatched (max_size and max_count, every option must match a field)
+#
+#   generate.py Joystick.proto Joystick.options <output directory>
+
+import os
+import re
+import sys
+
+SCALAR_TYPES = {
+    'bool': ('bool', 'PB_LTYPE_BOOL'),
+    'int32': ('int32_t', 'PB_LTYPE_VARINT'),
+    'uint32': ('uint32_t', 'PB_LTYPE_UVARINT'),
+    'string': ('char', 'PB_LTYPE_STRING'),
+}
+
+
+class ProtoError(Exception):
+    pass
+
+
+class Field:
+    def __init__(self, label, type_name, name, tag, oneof=None):
+        self.label = label  # None, 'optional' or 'repeated'
+        self.type_name = type_name
+        self.name = name
+        self.tag = tag
+        self.oneof = oneof
+        self.max_size = None
+        self.max_count = None
+
+
+class Message:
+    def __init__(self, name):
+        self.name = name
+        self.members = []  # Fields and oneofs (name, fields), in the order of the .proto file
+
+    def fields(self):
+        for member in self.members:
+            if isinstance(member, Field):
+                yield member
+            else:
+                yield from member[1]
+
+
+class Enum:
+    def __init__(self, name):
+        self.name = name
+        self.values = []
+
+
+def tokenize(text):
+    text = re.sub(r'/\*.*?\*/', ' ', text, flags=re.S)
+    text = re.sub(r'//[^\n]*', ' ', text)
+    return re.findall(r'"[^"]*"|[A-Za-z_][A-Za-z0-9_.]*|-?\d+|[{}=;\[\],<>()]', text)
+
+
+class Parser:
+    def __init__(self, tokens):
+        self.tokens = tokens
+        self.position = 0
+        self.messages = []
+        self.enums = []
+
+    def peek(self):
+        return self.tokens[self.position] if self.position < len(self.tokens) else None
+
+    def next(self, expected=None):
+        token = self.peek()
+        if token is None or (expected is not None and token != expected):
+            raise ProtoError('expected %s, got %s' % (expected or 'more', token))
+        self.position += 1
+        return token
+
+    def parse(self):
+        while self.peek() is not None:
+            keyword = self.next()
+            if keyword == 'syntax':
+                self.next('=')
+                if self.next() != '"proto3"':
+                    raise ProtoError('only proto3 is supported')
+                self.next(';')
+            elif keyword in ('package', 'option'):
+                while self.next() != ';':
+                    pass
+            elif keyword == 'message':
+                self.messages.append(self.parse_message())
+            elif keyword == 'enum':
+                self.enums.append(self.parse_enum())
+            else:
+                raise ProtoError('%s is not supported' % keyword)
+
+    def parse_enum(self):
+        enum = Enum(self.next())
+        self.next('{')
+        while self.peek() != '}':
+            name = self.next()
+            self.next('=')
+            enum.values.append((name, int(self.next())))
+            self.next(';')
+        self.next('}')
+        return enum
+
+    def parse_field(self, oneof=None):
+        label = None
+        if self.peek() in ('optional', 'repeated'):
+            label = self.next()
+        type_name = self.next()
+        name = self.next()
+        self.next('=')
+        field = Field(label, type_name, name, int(self.next()), oneof)
+        if self.peek() == '[':
+            raise ProtoError('field options are not supported (%s)' % name)
+        self.next(';')
+        return field
+
+    def parse_message(self):
+        message = Message(self.next())
+        self.next('{')
+        while self.peek() != '}':
+            if self.peek() in ('message', 'enum', 'map', 'reserved', 'extensions'):
+                raise ProtoError('%s in a message is not supported (%s)' % (self.peek(), message.name))
+            if self.peek() == 'oneof':
+                self.next()
+                name = self.next()
+                fields = []
+                self.next('{')
+                while self.peek() != '}':
+                    fields.append(self.parse_field(name))
+                self.next('}')
+                message.members.append((name, fields))
+            else:
+                message.members.append(self.parse_field())
+        self.next('}')
+        return message
+
+
+def read_options(path, messages):
+    fields = {}
+    for message in messages:
+        for field in message.fields():
+            fields['%s.%s' % (message.name, field.name)] = field
+
+    with open(path) as file:
+        for line_number, line in enumerate(file, 1):
+            line = line.split('#')[0].strip()
+            if not line:
+                continue
+            parts = line.split()
+            field = fields.get(parts[0])
+            if field is None:
+                raise ProtoError('%s:%d: option for %s doesn\'t match any field' % (path, line_number, parts[0]))
+            for option in parts[1:]:
+                key, _, value = option.partition(':')
+                if key not in ('max_size', 'max_count'):
+                    raise ProtoError('%s:%d: option %s is not supported' % (path, line_number, key))
+                setattr(field, key, int(value))
+
+
+def varint_size(value):
+    size = 1
+    while value >= 0x80:
+        value >>= 7
+        size += 1
+    return size
+
+
+class Generator:
+    def __init__(self, name, messages, enums):
+        self.name = name
+        self.messages = {message.name: message for message in messages}
+        self.enums = {enum.name: enum for enum in enums}
+        self.enum_order = enums
+        self.message_order = []
+        self.sizes = {}
+        for message in messages:
+            self.add_ordered(message, [])
+        for message in self.message_order:
+            self.check(message)
+
+    # Messages go after the messages they contain
+    def add_ordered(self, message, path):
+        if message in self.message_order:
+            return
+        if message.name in path:
+            raise ProtoError('recursive message %s is not supported' % message.name)
+        for field in message.fields():
+            if field.type_name in self.messages:
+                self.add_ordered(self.messages[field.type_name], path + [message.name])
+        self.message_order.append(message)
+
+    def check(self, message):
+        for field in message.fields():
+            where = '%s.%s' % (message.name, field.name)
+            if field.type_name not in SCALAR_TYPES and field.type_name not in self.messages and field.type_name not in self.enums:
+                raise ProtoError('%s: type %s is not supported' % (where, field.type_name))
+            if field.type_name == 'string' and field.max_size is None:
+                raise ProtoError('%s: a string needs max_size (callbacks are not supported)' % where)
+            if field.label == 'repeated' and field.max_count is None:
+                raise ProtoError('%s: a repeated field needs max_count (callbacks are not supported)' % where)
+            if field.label == 'repeated' and field.type_name == 'string':
+                raise ProtoError('%s: repeated strings are not supported' % where)
+
+    def c_type(self, field):
+        if field.type_name in SCALAR_TYPES:
+            return SCALAR_TYPES[field.type_name][0]
+        return field.type_name
+
+    def ltype(self, field):
+        if field.type_name in SCALAR_TYPES:
+            return SCALAR_TYPES[field.type_name][1]
+        return 'PB_LTYPE_SUBMESSAGE' if field.type_name in self.messages else 'PB_LTYPE_VARINT'
+
+    def has_presence(self, field):
+        return field.oneof is None and field.label != 'repeated' and (field.label == 'optional' or field.type_name in self.messages)
+
+    def declaration(self, field):
+        suffix = ''
+        if field.type_name == 'string':
+            suffix = '[%d]' % field.max_size
+        elif field.label == 'repeated':
+            suffix = '[%d]' % field.max_count
+        return '%s %s%s;' % (self.c_type(field), field.name, suffix)
+
+    def struct(self, message):
+        lines = ['typedef struct _%s {' % message.name]
+        if not message.members:
+            lines.append('    char dummy_field;')
+        for member in message.members:
+            if isinstance(member, Field):
+                if self.has_presence(member):
+                    lines.append('    bool has_%s;' % member.name)
+                if member.label == 'repeated':
+                    lines.append('    pb_size_t %s_count;' % member.name)
+                lines.append('    %s' % self.declaration(member))
+            else:
+                name, fields = member
+                lines.append('    pb_size_t which_%s;' % name)
+                lines.append('    union {')
+                for field in fields:
+                    lines.append('        %s' % self.declaration(field))
+                lines.append('    } %s;' % name)
+        lines.append('} %s;' % message.name)
+        return '\n'.join(lines)
+
+    def item_initializer(self, field, kind):
+        if field.type_name == 'string':
+            return '""'
+        if field.type_name in self.messages:
+            return '%s_init_%s' % (field.type_name, kind)
+        if field.type_name in self.enums:
+            return '_%s_MIN' % field.type_name
+        return '0'
+
+    def initializer(self, message, kind):
+        values = []
+        for member in message.members:
+            if isinstance(member, Field):
+                item = self.item_initializer(member, kind)
+                if self.has_presence(member):
+                    values.append('false')
+                if member.label == 'repeated':
+                    values.append('0')
+                    values.append('{%s}' % ', '.join([item] * member.max_count))
+                else:
+                    values.append(item)
+            else:
+                values.append('0')
+                values.append('{%s}' % self.item_initializer(member[1][0], kind))
+        return '{%s}' % ', '.join(values or ['0'])
+
+    def item_size(self, field):
+        if field.type_name == 'bool':
+            return 1
+        if field.type_name == 'uint32':
+            return 5
+        if field.type_name == 'int32':
+            return 10
+        if field.type_name in self.enums:
+            values = [value for _, value in self.enums[field.type_name].values]
+            return 10 if min(values) < 0 else varint_size(max(values))
+        if field.type_name == 'string':
+            return varint_size(field.max_size - 1) + field.max_size - 1
+        size = self.message_size(self.messages[field.type_name])
+        return varint_size(size) + size
+
+    def field_size(self, field):
+        tag_size = varint_size(field.tag << 3)
+        if field.label != 'repeated':
+            return tag_size + self.item_size(field)
+        if field.type_name in self.messages:
+            return field.max_count * (tag_size + self.item_size(field))
+        packed = field.max_count * self.item_size(field)
+        return tag_size + varint_size(packed) + packed
+
+    def message_size(self, message):
+        if message.name not in self.sizes:
+            size = 0
+            for member in message.members:
+                if isinstance(member, Field):
+                    size += self.field_size(member)
+                else:
+                    size += max(self.field_size(field) for field in member[1])
+            self.sizes[message.name] = size
+        return self.sizes[message.name]
+
+    def descriptor(self, message, field):
+        member = field.name if field.oneof is None else '%s.%s' % (field.oneof, field.name)
+        item = member + ('[0]' if field.label == 'repeated' else '')
+        if field.oneof is not None:
+            htype, size_offset = 'PB_HTYPE_ONEOF', 'offsetof(%s, which_%s)' % (message.name, field.oneof)
+        elif field.label == 'repeated':
+            htype, size_offset = 'PB_HTYPE_REPEATED', 'offsetof(%s, %s_count)' % (message.name, field.name)
+        elif self.has_presence(field):
+            htype, size_offset = 'PB_HTYPE_OPTIONAL', 'offsetof(%s, has_%s)' % (message.name, field.name)
+        else:
+            htype, size_offset = 'PB_HTYPE_SINGULAR', '0'
+        if field.type_name == 'string':
+            array_size = field.max_size
+        elif field.label == 'repeated':
+            array_size = field.max_count
+        else:
+            array_size = 0
+        submsg = '&%s_msg' % field.type_name if field.type_name in self.messages else 'NULL'
+        return '    { %d, %s, %s, offsetof(%s, %s), pb_membersize(%s, %s), %d, %s, %s },' % (
+            field.tag, self.ltype(field), htype, message.name, member, message.name, item, array_size, size_offset, submsg)
+
+    def header(self):
+        guard = 'PB_%s_PB_H_INCLUDED' % re.sub(r'\W', '_', self.name).upper()
+        out = ['/* Generated from %s.proto by host/nanopb/generate.py, don\'t edit */' % self.name, '',
+               '#ifndef %s' % guard, '#define %s' % guard, '#include "pb.h"', '']
+        if self.enum_order:
+            out.append('/* Enum definitions */')
+            for enum in self.enum_order:
+                out.append('typedef enum _%s {' % enum.name)
+                out.append(',\n'.join('    %s = %d' % value for value in enum.values))
+                out.append('} %s;' % enum.name)
+                out.append('')
+        out.append('/* Struct definitions */')
+        for message in self.message_order:
+            out.append(self.struct(message))
+            out.append('')
+        out += ['', '#ifdef __cplusplus', 'extern "C" {', '#endif', '']
+        if self.enum_order:
+            out.append('/* Helper constants for enums */')
+            for enum in self.enum_order:
+                lowest = min(enum.values, key=lambda value: value[1])[0]
+                highest = max(enum.values, key=lambda value: value[1])[0]
+                out.append('#define _%s_MIN %s' % (enum.name, lowest))
+                out.append('#define _%s_MAX %s' % (enum.name, highest))
+                out.append('#define _%s_ARRAYSIZE ((%s)(%s+1))' % (enum.name, enum.name, highest))
+            out.append('')
+        out.append('/* Initializer values for message structs */')
+        for message in self.message_order:
+            out.append('#define %s_init_default %s' % (message.name, self.initializer(message, 'default')))
+        for message in self.message_order:
+            out.append('#define %s_init_zero %s' % (message.name, self.initializer(message, 'zero')))
+        out += ['', '/* Field tags (for use in manual encoding/decoding) */']
+        for message in self.message_order:
+            for field in message.fields():
+                out.append('#define %s_%s_tag %d' % (message.name, field.name, field.tag))
+        out += ['', '/* Struct field encoding specification for nanopb */']
+        for message in self.message_order:
+            out.append('extern const pb_msgdesc_t %s_msg;' % message.name)
+        for message in self.message_order:
+            out.append('#define %s_fields &%s_msg' % (message.name, message.name))
+        out += ['', '/* Maximum encoded size of messages (where known) */']
+        for message in self.message_order:
+            out.append('#define %s_size %d' % (message.name, self.message_size(message)))
+        out += ['', '#ifdef __cplusplus', '} /* extern "C" */', '#endif', '', '#endif', '']
+        return '\n'.join(out)
+
+    def source(self):
+        out = ['/* Generated from %s.proto by host/nanopb/generate.py, don\'t edit */' % self.name, '',
+               '#include "%s.pb.h"' % self.name, '',
+               '#define pb_membersize(st, m) (sizeof ((st *)0)->m)', '']
+        for message in self.message_order:
+            fields = list(message.fields())
+            if fields:
+                out.append('static const pb_field_t %s_field_info[%d] = {' % (message.name, len(fields)))
+                out += [self.descriptor(message, field) for field in fields]
+                out.append('};')
+                out.append('const pb_msgdesc_t %s_msg = { %s_field_info, %d, sizeof(%s) };' % (
+                    message.name, message.name, len(fields), message.name))
+            else:
+                out.append('const pb_msgdesc_t %s_msg = { NULL, 0, sizeof(%s) };' % (message.name, message.name))
+            out.append('')
+        return '\n'.join(out)
+
+
+def main():
+    if len(sys.argv) != 4:
+        sys.exit('usage: generate.py <file.proto> <file.options> <output directory>')
+    proto_path, options_path, output_dir = sys.argv[1:]
+    name = os.path.splitext(os.path.basename(proto_path))[0]
+    try:
+        with open(proto_path) as file:
+            parser = Parser(tokenize(file.read()))
+        parser.parse()
+        read_options(options_path, parser.messages)
+        generator = Generator(name, parser.messages, parser.enums)
+    except ProtoError as error:
+        sys.exit('%s: %s' % (proto_path, error))
+
+    os.makedirs(output_dir, exist_ok=True)
+    with open(os.path.join(output_dir, name + '.pb.h'), 'w') as file:
+        file.write(generator.header())
+    with open(os.path.join(output_dir, name + '.pb.c'), 'w') as file:
+        file.write(generator.source())
+
+
+if __name__ == '__main__':
+    main()
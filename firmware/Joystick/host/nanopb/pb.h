@@ -0,0 +1,80 @@
+/* Host stand-in for nanopb, the protobuf library the firmware gets from PlatformIO (lib_deps = Nanopb)
+ * It has the nanopb API the link uses (pb_encode(), pb_decode() and their buffer streams) with the same wire format,
+ * for the statically allocated fields nanopb generates from Joystick.proto and Joystick.options:
+ * bool, int32, uint32 and enum scalars, strings with a max_size, submessages, oneofs and repeated scalars or submessages
+ * with a max_count
+ * The messages are generated with generate.py, which takes the same .proto and .options files as the nanopb generator
+ */
+
+#ifndef PB_H_INCLUDED
+#define PB_H_INCLUDED
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdbool.h>
+#include <string.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef uint_least16_t pb_size_t;
+typedef uint8_t pb_byte_t;
+
+/* How a field is stored */
+typedef enum
+{
+    PB_LTYPE_BOOL,
+    PB_LTYPE_VARINT,     /* int32 and enums, sign extended to 64 bits on the wire */
+    PB_LTYPE_UVARINT,    /* uint32 */
+    PB_LTYPE_STRING,     /* Null terminated char array of array_size bytes */
+    PB_LTYPE_SUBMESSAGE
+} pb_ltype_t;
+
+/* How many of a field there are */
+typedef enum
+{
+    PB_HTYPE_SINGULAR,   /* proto3 field without presence, not sent while it is zero */
+    PB_HTYPE_OPTIONAL,   /* With a has_ bool at size_offset */
+    PB_HTYPE_REPEATED,   /* array_size items with a pb_size_t count at size_offset, scalars are packed */
+    PB_HTYPE_ONEOF       /* A union member, the pb_size_t which_ field at size_offset holds the tag of the member set */
+} pb_htype_t;
+
+typedef struct pb_msgdesc_s pb_msgdesc_t;
+
+typedef struct pb_field_s
+{
+    pb_size_t tag;
+    uint8_t ltype;
+    uint8_t htype;
+    pb_size_t data_offset;
+    pb_size_t data_size;   /* The size of one item */
+    pb_size_t array_size;  /* The items of a repeated field, or the size of a string (a string can't be repeated) */
+    pb_size_t size_offset; /* The has_, count or which_ field */
+    const pb_msgdesc_t *submsg;
+} pb_field_t;
+
+struct pb_msgdesc_s
+{
+    const pb_field_t *fields;
+    pb_size_t field_count;
+    size_t struct_size;
+};
+
+/* Wire types */
+typedef enum
+{
+    PB_WT_VARINT = 0,
+    PB_WT_64BIT = 1,
+    PB_WT_STRING = 2,
+    PB_WT_32BIT = 5
+} pb_wire_type_t;
+
+#define PB_RETURN_ERROR(stream, msg) return ((stream)->errmsg = (msg), false)
+#define PB_GET_ERROR(stream) ((stream)->errmsg ? (stream)->errmsg : "(none)")
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
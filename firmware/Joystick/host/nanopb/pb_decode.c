@@ -0,0 +1,264 @@
+/* Decoding of the host stand-in for nanopb (see pb.h) */
+
+#include "pb_decode.h"
+
+static bool pb_read(pb_istream_t *stream, pb_byte_t *buf, size_t count)
+{
+    if (count > stream->bytes_left)
+    {
+        PB_RETURN_ERROR(stream, "end-of-stream");
+    }
+    if (buf != NULL)
+    {
+        memcpy(buf, stream->buf, count);
+    }
+    stream->buf += count;
+    stream->bytes_left -= count;
+    return true;
+}
+
+static bool pb_decode_varint(pb_istream_t *stream, uint64_t *value)
+{
+    *value = 0;
+    for (int shift = 0; shift < 70; shift += 7)
+    {
+        pb_byte_t byte;
+        if (!pb_read(stream, &byte, 1))
+        {
+            return false;
+        }
+        *value |= (uint64_t)(byte & 0x7F) << shift;
+        if ((byte & 0x80) == 0)
+        {
+            return true;
+        }
+    }
+    PB_RETURN_ERROR(stream, "varint overflow");
+}
+
+static bool pb_skip_field(pb_istream_t *stream, pb_wire_type_t wiretype)
+{
+    uint64_t value;
+    switch (wiretype)
+    {
+        case PB_WT_VARINT:
+            return pb_decode_varint(stream, &value);
+        case PB_WT_64BIT:
+            return pb_read(stream, NULL, 8);
+        case PB_WT_STRING:
+            return pb_decode_varint(stream, &value) && pb_read(stream, NULL, value);
+        case PB_WT_32BIT:
+            return pb_read(stream, NULL, 4);
+        default:
+            PB_RETURN_ERROR(stream, "invalid wire_type");
+    }
+}
+
+/* Stores an integer item of any size, a value that doesn't fit is an error */
+static bool pb_write_integer(pb_istream_t *stream, const pb_field_t *field, void *item, uint64_t value)
+{
+    int64_t svalue = (int64_t)value;
+    bool fits;
+    switch (field->data_size)
+    {
+        case 1:
+            fits = field->ltype == PB_LTYPE_VARINT ? svalue >= INT8_MIN && svalue <= INT8_MAX : value <= UINT8_MAX;
+            *(uint8_t *)item = (uint8_t)value;
+            break;
+        case 2:
+            fits = field->ltype == PB_LTYPE_VARINT ? svalue >= INT16_MIN && svalue <= INT16_MAX : value <= UINT16_MAX;
+            *(uint16_t *)item = (uint16_t)value;
+            break;
+        case 4:
+            fits = field->ltype == PB_LTYPE_VARINT ? svalue >= INT32_MIN && svalue <= INT32_MAX : value <= UINT32_MAX;
+            *(uint32_t *)item = (uint32_t)value;
+            break;
+        default:
+            fits = true;
+            *(uint64_t *)item = value;
+            break;
+    }
+    if (!fits)
+    {
+        PB_RETURN_ERROR(stream, "integer too large");
+    }
+    return true;
+}
+
+static bool pb_decode_scalar(pb_istream_t *stream, const pb_field_t *field, void *item)
+{
+    uint64_t value;
+    if (!pb_decode_varint(stream, &value))
+    {
+        return false;
+    }
+    if (field->ltype == PB_LTYPE_BOOL)
+    {
+        *(bool *)item = value != 0;
+        return true;
+    }
+    return pb_write_integer(stream, field, item, value);
+}
+
+static bool pb_decode_fields(pb_istream_t *stream, const pb_msgdesc_t *fields, void *dest_struct);
+
+/* A string or a submessage, the length comes first */
+static bool pb_decode_delimited(pb_istream_t *stream, const pb_field_t *field, void *item)
+{
+    uint64_t length;
+    if (!pb_decode_varint(stream, &length))
+    {
+        return false;
+    }
+    if (length > stream->bytes_left)
+    {
+        PB_RETURN_ERROR(stream, "parent stream too short");
+    }
+
+    if (field->ltype == PB_LTYPE_STRING)
+    {
+        if (length + 1 > field->array_size)
+        {
+            PB_RETURN_ERROR(stream, "string overflow");
+        }
+        ((char *)item)[length] = '\0';
+        return pb_read(stream, (pb_byte_t *)item, length);
+    }
+
+    /* A submessage that is repeated in the stream is merged into the earlier one */
+    pb_istream_t substream = pb_istream_from_buffer(stream->buf, length);
+    if (!pb_decode_fields(&substream, field->submsg, item))
+    {
+        stream->errmsg = substream.errmsg;
+        return false;
+    }
+    return pb_read(stream, NULL, length);
+}
+
+static bool pb_decode_repeated(pb_istream_t *stream, const pb_field_t *field, pb_byte_t *data, pb_size_t *count,
+    pb_wire_type_t wiretype)
+{
+    bool packable = field->ltype != PB_LTYPE_STRING && field->ltype != PB_LTYPE_SUBMESSAGE;
+    if (packable && wiretype == PB_WT_STRING)
+    {
+        uint64_t length;
+        if (!pb_decode_varint(stream, &length))
+        {
+            return false;
+        }
+        if (length > stream->bytes_left)
+        {
+            PB_RETURN_ERROR(stream, "parent stream too short");
+        }
+        pb_istream_t substream = pb_istream_from_buffer(stream->buf, length);
+        while (substream.bytes_left > 0)
+        {
+            if (*count >= field->array_size)
+            {
+                PB_RETURN_ERROR(stream, "array overflow");
+            }
+            if (!pb_decode_scalar(&substream, field, data + *count * field->data_size))
+            {
+                stream->errmsg = substream.errmsg;
+                return false;
+            }
+            (*count)++;
+        }
+        return pb_read(stream, NULL, length);
+    }
+
+    if (wiretype != (packable ? PB_WT_VARINT : PB_WT_STRING))
+    {
+        PB_RETURN_ERROR(stream, "wrong wire type");
+    }
+    if (*count >= field->array_size)
+    {
+        PB_RETURN_ERROR(stream, "array overflow");
+    }
+    pb_byte_t *item = data + *count * field->data_size;
+    memset(item, 0, field->data_size);
+    (*count)++;
+    return packable ? pb_decode_scalar(stream, field, item) : pb_decode_delimited(stream, field, item);
+}
+
+static bool pb_decode_field(pb_istream_t *stream, const pb_field_t *field, void *dest_struct, pb_wire_type_t wiretype)
+{
+    pb_byte_t *data = (pb_byte_t *)dest_struct + field->data_offset;
+    void *size = (pb_byte_t *)dest_struct + field->size_offset;
+    if (field->htype == PB_HTYPE_REPEATED)
+    {
+        return pb_decode_repeated(stream, field, data, (pb_size_t *)size, wiretype);
+    }
+
+    bool delimited = field->ltype == PB_LTYPE_STRING || field->ltype == PB_LTYPE_SUBMESSAGE;
+    if (wiretype != (delimited ? PB_WT_STRING : PB_WT_VARINT))
+    {
+        PB_RETURN_ERROR(stream, "wrong wire type");
+    }
+
+    if (field->htype == PB_HTYPE_OPTIONAL)
+    {
+        if (field->ltype == PB_LTYPE_SUBMESSAGE && !*(bool *)size)
+        {
+            memset(data, 0, field->data_size);
+        }
+        *(bool *)size = true;
+    }
+    else if (field->htype == PB_HTYPE_ONEOF)
+    {
+        /* Another member of the oneof is replaced */
+        if (*(pb_size_t *)size != field->tag)
+        {
+            memset(data, 0, field->data_size);
+        }
+        *(pb_size_t *)size = field->tag;
+    }
+    return delimited ? pb_decode_delimited(stream, field, data) : pb_decode_scalar(stream, field, data);
+}
+
+static bool pb_decode_fields(pb_istream_t *stream, const pb_msgdesc_t *fields, void *dest_struct)
+{
+    while (stream->bytes_left > 0)
+    {
+        uint64_t key;
+        if (!pb_decode_varint(stream, &key))
+        {
+            return false;
+        }
+        pb_wire_type_t wiretype = (pb_wire_type_t)(key & 7);
+        uint64_t tag = key >> 3;
+        if (tag == 0)
+        {
+            PB_RETURN_ERROR(stream, "zero tag");
+        }
+
+        const pb_field_t *field = NULL;
+        for (pb_size_t i = 0; i < fields->field_count && field == NULL; i++)
+        {
+            if (fields->fields[i].tag == tag)
+            {
+                field = &fields->fields[i];
+            }
+        }
+
+        bool decoded = field != NULL ? pb_decode_field(stream, field, dest_struct, wiretype) : pb_skip_field(stream, wiretype);
+        if (!decoded)
+        {
+            return false;
+        }
+    }
+    return true;
+}
+
+pb_istream_t pb_istream_from_buffer(const pb_byte_t *buf, size_t msglen)
+{
+    pb_istream_t stream = { buf, msglen, NULL };
+    return stream;
+}
+
+bool pb_decode(pb_istream_t *stream, const pb_msgdesc_t *fields, void *dest_struct)
+{
+    /* Every field starts out at its proto3 default, which is zero */
+    memset(dest_struct, 0, fields->struct_size);
+    return pb_decode_fields(stream, fields, dest_struct);
+}
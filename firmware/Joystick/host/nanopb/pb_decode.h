@@ -0,0 +1,29 @@
+/* Decoding of the host stand-in for nanopb (see pb.h) */
+
+#ifndef PB_DECODE_H_INCLUDED
+#define PB_DECODE_H_INCLUDED
+
+#include "pb.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef struct pb_istream_s
+{
+    const pb_byte_t *buf;
+    size_t bytes_left;
+    const char *errmsg;
+} pb_istream_t;
+
+pb_istream_t pb_istream_from_buffer(const pb_byte_t *buf, size_t msglen);
+
+/* Decodes a whole message, the fields it doesn't have are zero and unknown fields are skipped
+ * Returns false if the message is cut short, malformed or has more than a field can hold */
+bool pb_decode(pb_istream_t *stream, const pb_msgdesc_t *fields, void *dest_struct);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,234 @@
+/* Encoding of the host stand-in for nanopb (see pb.h) */
+
+#include "pb_encode.h"
+
+static bool pb_write(pb_ostream_t *stream, const pb_byte_t *buf, size_t count)
+{
+    if (count > stream->max_size - stream->bytes_written)
+    {
+        PB_RETURN_ERROR(stream, "stream full");
+    }
+    if (stream->buf != NULL)
+    {
+        memcpy(stream->buf + stream->bytes_written, buf, count);
+    }
+    stream->bytes_written += count;
+    return true;
+}
+
+static bool pb_encode_varint(pb_ostream_t *stream, uint64_t value)
+{
+    pb_byte_t buffer[10];
+    size_t count = 0;
+    do
+    {
+        buffer[count] = (pb_byte_t)(value & 0x7F);
+        value >>= 7;
+        if (value != 0)
+        {
+            buffer[count] |= 0x80;
+        }
+        count++;
+    } while (value != 0);
+    return pb_write(stream, buffer, count);
+}
+
+static bool pb_encode_tag(pb_ostream_t *stream, pb_wire_type_t wiretype, pb_size_t tag)
+{
+    return pb_encode_varint(stream, ((uint64_t)tag << 3) | wiretype);
+}
+
+/* Reads an integer item of any size, int32 and enums are sign extended */
+static uint64_t pb_read_integer(const pb_field_t *field, const void *item)
+{
+    switch (field->data_size)
+    {
+        case 1:
+            return field->ltype == PB_LTYPE_VARINT ? (uint64_t)(int64_t)*(const int8_t *)item : *(const uint8_t *)item;
+        case 2:
+            return field->ltype == PB_LTYPE_VARINT ? (uint64_t)(int64_t)*(const int16_t *)item : *(const uint16_t *)item;
+        case 4:
+            return field->ltype == PB_LTYPE_VARINT ? (uint64_t)(int64_t)*(const int32_t *)item : *(const uint32_t *)item;
+        default:
+            return *(const uint64_t *)item;
+    }
+}
+
+static bool pb_encode_scalar(pb_ostream_t *stream, const pb_field_t *field, const void *item)
+{
+    if (field->ltype == PB_LTYPE_BOOL)
+    {
+        return pb_encode_varint(stream, *(const bool *)item ? 1 : 0);
+    }
+    return pb_encode_varint(stream, pb_read_integer(field, item));
+}
+
+static bool pb_encode_fields(pb_ostream_t *stream, const pb_msgdesc_t *fields, const void *src_struct);
+
+static bool pb_encode_submessage(pb_ostream_t *stream, const pb_msgdesc_t *fields, const void *src_struct)
+{
+    /* The length goes first, so the message is sized before it is written */
+    size_t size;
+    if (!pb_get_encoded_size(&size, fields, src_struct))
+    {
+        PB_RETURN_ERROR(stream, "submessage doesn't encode");
+    }
+    if (!pb_encode_varint(stream, size))
+    {
+        return false;
+    }
+    if (size > stream->max_size - stream->bytes_written)
+    {
+        PB_RETURN_ERROR(stream, "stream full");
+    }
+    if (stream->buf == NULL)
+    {
+        stream->bytes_written += size;
+        return true;
+    }
+
+    pb_ostream_t substream = pb_ostream_from_buffer(stream->buf + stream->bytes_written, size);
+    if (!pb_encode_fields(&substream, fields, src_struct))
+    {
+        stream->errmsg = substream.errmsg;
+        return false;
+    }
+    stream->bytes_written += substream.bytes_written;
+    return true;
+}
+
+static bool pb_encode_item(pb_ostream_t *stream, const pb_field_t *field, const void *item)
+{
+    switch (field->ltype)
+    {
+        case PB_LTYPE_STRING:
+        {
+            size_t length = strnlen((const char *)item, field->array_size);
+            if (length == field->array_size)
+            {
+                PB_RETURN_ERROR(stream, "unterminated string");
+            }
+            return pb_encode_tag(stream, PB_WT_STRING, field->tag) && pb_encode_varint(stream, length)
+                && pb_write(stream, (const pb_byte_t *)item, length);
+        }
+
+        case PB_LTYPE_SUBMESSAGE:
+            return pb_encode_tag(stream, PB_WT_STRING, field->tag) && pb_encode_submessage(stream, field->submsg, item);
+
+        default:
+            return pb_encode_tag(stream, PB_WT_VARINT, field->tag) && pb_encode_scalar(stream, field, item);
+    }
+}
+
+static bool pb_is_zero(const void *item, size_t size)
+{
+    const pb_byte_t *bytes = (const pb_byte_t *)item;
+    for (size_t i = 0; i < size; i++)
+    {
+        if (bytes[i] != 0)
+        {
+            return false;
+        }
+    }
+    return true;
+}
+
+static bool pb_encode_field(pb_ostream_t *stream, const pb_field_t *field, const void *src_struct)
+{
+    const pb_byte_t *data = (const pb_byte_t *)src_struct + field->data_offset;
+    const void *size = (const pb_byte_t *)src_struct + field->size_offset;
+    switch (field->htype)
+    {
+        case PB_HTYPE_OPTIONAL:
+            return !*(const bool *)size || pb_encode_item(stream, field, data);
+
+        case PB_HTYPE_ONEOF:
+            return *(const pb_size_t *)size != field->tag || pb_encode_item(stream, field, data);
+
+        case PB_HTYPE_REPEATED:
+        {
+            pb_size_t count = *(const pb_size_t *)size;
+            if (count > field->array_size)
+            {
+                PB_RETURN_ERROR(stream, "array max size exceeded");
+            }
+            if (count == 0)
+            {
+                return true;
+            }
+
+            /* Scalars are packed, as proto3 does by default */
+            if (field->ltype == PB_LTYPE_STRING || field->ltype == PB_LTYPE_SUBMESSAGE)
+            {
+                for (pb_size_t i = 0; i < count; i++)
+                {
+                    if (!pb_encode_item(stream, field, data + i * field->data_size))
+                    {
+                        return false;
+                    }
+                }
+                return true;
+            }
+
+            pb_ostream_t sizing = pb_ostream_from_buffer(NULL, SIZE_MAX);
+            for (pb_size_t i = 0; i < count; i++)
+            {
+                pb_encode_scalar(&sizing, field, data + i * field->data_size);
+            }
+            if (!pb_encode_tag(stream, PB_WT_STRING, field->tag) || !pb_encode_varint(stream, sizing.bytes_written))
+            {
+                return false;
+            }
+            for (pb_size_t i = 0; i < count; i++)
+            {
+                if (!pb_encode_scalar(stream, field, data + i * field->data_size))
+                {
+                    return false;
+                }
+            }
+            return true;
+        }
+
+        default:
+            /* Zero is the default of a proto3 field, it isn't sent */
+            if (field->ltype == PB_LTYPE_STRING ? *(const char *)data == '\0' : pb_is_zero(data, field->data_size))
+            {
+                return true;
+            }
+            return pb_encode_item(stream, field, data);
+    }
+}
+
+static bool pb_encode_fields(pb_ostream_t *stream, const pb_msgdesc_t *fields, const void *src_struct)
+{
+    for (pb_size_t i = 0; i < fields->field_count; i++)
+    {
+        if (!pb_encode_field(stream, &fields->fields[i], src_struct))
+        {
+            return false;
+        }
+    }
+    return true;
+}
+
+pb_ostream_t pb_ostream_from_buffer(pb_byte_t *buf, size_t bufsize)
+{
+    pb_ostream_t stream = { buf, bufsize, 0, NULL };
+    return stream;
+}
+
+bool pb_encode(pb_ostream_t *stream, const pb_msgdesc_t *fields, const void *src_struct)
+{
+    return pb_encode_fields(stream, fields, src_struct);
+}
+
+bool pb_get_encoded_size(size_t *size, const pb_msgdesc_t *fields, const void *src_struct)
+{
+    pb_ostream_t stream = pb_ostream_from_buffer(NULL, SIZE_MAX);
+    if (!pb_encode_fields(&stream, fields, src_struct))
+    {
+        return false;
+    }
+    *size = stream.bytes_written;
+    return true;
+}
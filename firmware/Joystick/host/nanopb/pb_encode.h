@@ -0,0 +1,33 @@
+/* Encoding of the host stand-in for nanopb (see pb.h) */
+
+#ifndef PB_ENCODE_H_INCLUDED
+#define PB_ENCODE_H_INCLUDED
+
+#include "pb.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* A stream without a buffer only counts the bytes written */
+typedef struct pb_ostream_s
+{
+    pb_byte_t *buf;
+    size_t max_size;
+    size_t bytes_written;
+    const char *errmsg;
+} pb_ostream_t;
+
+pb_ostream_t pb_ostream_from_buffer(pb_byte_t *buf, size_t bufsize);
+
+/* Encodes a message, returns false if it doesn't fit in the stream or a field can't be encoded */
+bool pb_encode(pb_ostream_t *stream, const pb_msgdesc_t *fields, const void *src_struct);
+
+/* Gets the size of an encoded message */
+bool pb_get_encoded_size(size_t *size, const pb_msgdesc_t *fields, const void *src_struct);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,7 @@
+#ifndef _ADAFRUIT_I2CDEVICE_H_
+#define _ADAFRUIT_I2CDEVICE_H_
+
+// Adafruit_GFX includes it, nothing on the joystick uses I2C
+
+
+#endif // end _ADAFRUIT_I2CDEVICE_H_
@@ -0,0 +1,38 @@
+#ifndef _ADAFRUIT_SPIDEVICE_H_
+#define _ADAFRUIT_SPIDEVICE_H_
+
+// Stands in for the Adafruit_BusIO SPI device, the blocking writes of Adafruit_PCD8544 go straight to the display emulation
+
+#include "SPI.h"
+
+typedef enum
+{
+    SPI_BITORDER_MSBFIRST,
+    SPI_BITORDER_LSBFIRST,
+} BusIOBitOrder;
+
+void shimSpiWrite(const uint8_t *data, size_t count);
+
+class Adafruit_SPIDevice
+{
+public:
+    Adafruit_SPIDevice(int8_t csPin, uint32_t frequency = 1000000, BusIOBitOrder dataOrder = SPI_BITORDER_MSBFIRST,
+        uint8_t dataMode = SPI_MODE0, SPIClass *theSPI = &SPI) {}
+    Adafruit_SPIDevice(int8_t csPin, int8_t sclkPin, int8_t misoPin, int8_t mosiPin, uint32_t frequency = 1000000,
+        BusIOBitOrder dataOrder = SPI_BITORDER_MSBFIRST, uint8_t dataMode = SPI_MODE0) {}
+
+    bool begin() { return true; }
+    bool write(const uint8_t *buffer, size_t length, const uint8_t *prefixBuffer = nullptr, size_t prefixLength = 0)
+    {
+        shimSpiWrite(prefixBuffer, prefixLength);
+        shimSpiWrite(buffer, length);
+        return true;
+    }
+    void beginTransaction() {}
+    void endTransaction() {}
+    void beginTransactionWithAssertingCS() {}
+    void endTransactionWithDeassertingCS() {}
+};
+
+
+#endif // end _ADAFRUIT_SPIDEVICE_H_
@@ -0,0 +1,227 @@
+#ifndef _ARDUINO_H_
+#define _ARDUINO_H_
+
+// Headless stand in for the Teensy Arduino core, just enough of it for the firmware sources the host build compiles
+// Time only moves when a test moves it (see shim.h), so every run of a test draws the same frames
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdarg.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <algorithm>
+#include <string>
+#include <vector>
+
+#define PROGMEM
+#define F(text) text
+#define pgm_read_byte(address) (*(const uint8_t *)(address))
+#define pgm_read_word(address) (*(const uint16_t *)(address))
+#define pgm_read_dword(address) (*(const uint32_t *)(address))
+
+#define HIGH 1
+#define LOW 0
+#define INPUT 0
+#define OUTPUT 1
+#define DEC 10
+#define HEX 16
+
+#ifndef constrain
+#define constrain(amount, low, high) ((amount) < (low) ? (low) : ((amount) > (high) ? (high) : (amount)))
+#endif
+
+#define __disable_irq() do {} while (0)
+#define __enable_irq() do {} while (0)
+
+using std::min;
+using std::max;
+
+typedef bool boolean;
+typedef uint8_t byte;
+
+
+// =============================================================================
+// Virtual clock
+// =============================================================================
+
+extern uint32_t ShimMicros;
+
+inline uint32_t micros()
+{
+    return ShimMicros;
+}
+
+inline uint32_t millis()
+{
+    return ShimMicros / 1000;
+}
+
+// Waiting moves the clock on, nothing else runs in the meantime
+inline void delay(uint32_t milliseconds)
+{
+    ShimMicros += milliseconds * 1000;
+}
+
+inline void delayMicroseconds(uint32_t microseconds)
+{
+    ShimMicros += microseconds;
+}
+
+inline void yield()
+{
+}
+
+
+// =============================================================================
+// Pins and random numbers
+// =============================================================================
+
+extern uint8_t ShimPins[64];
+
+inline void pinMode(uint8_t pin, uint8_t mode)
+{
+}
+
+inline void digitalWrite(uint8_t pin, uint8_t value)
+{
+    ShimPins[pin] = value;
+}
+
+inline int digitalRead(uint8_t pin)
+{
+    return ShimPins[pin];
+}
+
+// The same sequence on every host, unlike rand()
+extern uint32_t ShimRandomState;
+
+inline void randomSeed(uint32_t seed)
+{
+    ShimRandomState = seed;
+}
+
+inline int32_t random(int32_t high)
+{
+    ShimRandomState = ShimRandomState * 1103515245 + 12345;
+    return high > 0 ? (int32_t)((ShimRandomState >> 8) % (uint32_t)high) : 0;
+}
+
+inline int32_t random(int32_t low, int32_t high)
+{
+    return low + random(high - low);
+}
+
+
+// =============================================================================
+// Print and serial ports
+// =============================================================================
+
+// Flash strings are plain strings on the host
+class __FlashStringHelper;
+
+// Only what Adafruit_GFX needs, it allocates like the Arduino String does
+class String
+{
+public:
+    String(const char *text = "") : _text(text) {}
+    unsigned int length() const { return _text.length(); }
+    const char *c_str() const { return _text.c_str(); }
+
+private:
+    std::string _text;
+};
+
+class Print
+{
+public:
+    virtual ~Print() {}
+    virtual size_t write(uint8_t c) = 0;
+    virtual int availableForWrite() { return 0; }
+
+    virtual size_t write(const uint8_t *buffer, size_t size)
+    {
+        size_t count = 0;
+        while (size-- > 0)
+        {
+            count += write(*buffer++);
+        }
+        return count;
+    }
+    size_t write(const char *text) { return text != NULL ? write((const uint8_t *)text, strlen(text)) : 0; }
+    size_t write(const char *buffer, size_t size) { return write((const uint8_t *)buffer, size); }
+
+    size_t print(const char *text) { return write(text); }
+    size_t print(char c) { return write((uint8_t)c); }
+    size_t print(int value, int base = DEC) { return print((long)value, base); }
+    size_t print(unsigned int value, int base = DEC) { return print((unsigned long)value, base); }
+    size_t print(long value, int base = DEC) { return printf(base == HEX ? "%lx" : "%ld", value); }
+    size_t print(unsigned long value, int base = DEC) { return printf(base == HEX ? "%lx" : "%lu", value); }
+    size_t print(unsigned char value, int base = DEC) { return print((unsigned long)value, base); }
+    size_t print(double value, int digits = 2) { return printf("%.*f", digits, value); }
+
+    size_t println() { return write("\r\n"); }
+    template <typename T> size_t println(T value) { size_t count = print(value); return count + println(); }
+
+    int printf(const char *format, ...) __attribute__((format(printf, 2, 3)))
+    {
+        char text[256];
+        va_list args;
+        va_start(args, format);
+        int length = vsnprintf(text, sizeof(text), format, args);
+        va_end(args);
+        return write((const uint8_t *)text, min(length, (int)sizeof(text) - 1));
+    }
+};
+
+class Stream : public Print
+{
+public:
+    virtual int available() { return 0; }
+    virtual int read() { return -1; }
+    virtual int peek() { return -1; }
+};
+
+// A serial port that keeps what is written to it and reads what a test gave it
+class HardwareSerial : public Stream
+{
+public:
+    void begin(uint32_t baud) {}
+    operator bool() { return true; }
+    int availableForWrite() override { return writeRoom; }
+    void flush() {}
+
+    size_t write(uint8_t c) override { written.push_back(c); return 1; }
+    using Print::write;
+
+    int available() override { return (int)(input.size() - inputRead); }
+    int read() override { return inputRead < input.size() ? input[inputRead++] : -1; }
+    int peek() override { return inputRead < input.size() ? input[inputRead] : -1; }
+
+    // Test side
+    std::vector<uint8_t> written;
+    std::vector<uint8_t> input;
+    size_t inputRead = 0;
+    int writeRoom = 64;
+};
+
+extern HardwareSerial Serial;
+extern HardwareSerial Serial1;
+extern HardwareSerial Serial2;
+
+
+// =============================================================================
+// Timers
+// =============================================================================
+
+// There are no interrupts on the host, the core never sleeps (see schedulerIdle())
+class IntervalTimer
+{
+public:
+    bool begin(void (*function)(), uint32_t microseconds) { return true; }
+    void end() {}
+};
+
+
+#endif // end _ARDUINO_H_
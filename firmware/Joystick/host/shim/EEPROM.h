@@ -0,0 +1,31 @@
+#ifndef _EEPROM_H_
+#define _EEPROM_H_
+
+#include <stdint.h>
+#include <string.h>
+
+// The Teensy 3.6 EEPROM, erased (all 0xFF) when a test starts
+class EEPROMClass
+{
+public:
+    EEPROMClass() { memset(data, 0xFF, sizeof(data)); }
+
+    template <typename T> T &get(int address, T &value)
+    {
+        memcpy(&value, &data[address], sizeof(T));
+        return value;
+    }
+
+    template <typename T> const T &put(int address, const T &value)
+    {
+        memcpy(&data[address], &value, sizeof(T));
+        return value;
+    }
+
+    uint8_t data[4096];
+};
+
+extern EEPROMClass EEPROM;
+
+
+#endif // end _EEPROM_H_
@@ -0,0 +1,24 @@
+#ifndef _EVENT_RESPONDER_H_
+#define _EVENT_RESPONDER_H_
+
+// Only the immediate responses the SPI DMA completion uses, called from shim.cpp when a transfer completes
+
+class EventResponder;
+typedef EventResponder &EventResponderRef;
+typedef void (*EventResponderFunction)(EventResponderRef);
+
+class EventResponder
+{
+public:
+    void setContext(void *context) { _context = context; }
+    void *getContext() { return _context; }
+    void attachImmediate(EventResponderFunction function) { _function = function; }
+    void triggerEvent() { _function(*this); }
+
+private:
+    void *_context = nullptr;
+    EventResponderFunction _function = nullptr;
+};
+
+
+#endif // end _EVENT_RESPONDER_H_
@@ -0,0 +1,8 @@
+#ifndef _PRINT_H_
+#define _PRINT_H_
+
+// Print is part of Arduino.h in the shim
+#include "Arduino.h"
+
+
+#endif // end _PRINT_H_
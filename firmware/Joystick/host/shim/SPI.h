@@ -0,0 +1,24 @@
+#ifndef _SPI_H_
+#define _SPI_H_
+
+#include "Arduino.h"
+#include "EventResponder.h"
+
+// The display is driven with DMA transfers like on the Teensy (see Adafruit_PCD8544::displayAsync())
+#define SPI_HAS_TRANSFER_ASYNC
+
+#define SPI_MODE0 0x00
+#define MSBFIRST 1
+
+// Hardware SPI, every byte sent is fed to the display emulation in shim.cpp
+class SPIClass
+{
+public:
+    void begin() {}
+    bool transfer(const void *txBuffer, void *rxBuffer, size_t count, EventResponderRef event);
+};
+
+extern SPIClass SPI;
+
+
+#endif // end _SPI_H_
@@ -0,0 +1,111 @@
+#ifndef _USB_HOST_T36_H_
+#define _USB_HOST_T36_H_
+
+// The parts of the USBHost_t36 library joystickHid.cpp uses, the joysticks are driven by the tests instead of USB reports
+
+#include "Arduino.h"
+
+class USBHost
+{
+public:
+    void begin() {}
+    void Task() {}
+};
+
+// The identity of a connected device
+class USBDeviceInfo
+{
+public:
+    uint16_t idVendor() { return 0x054C; }
+    uint16_t idProduct() { return 0x05C4; }
+    const uint8_t *manufacturer() { return (const uint8_t *)"Sony"; }
+    const uint8_t *product() { return (const uint8_t *)"Wireless Controller"; }
+    const uint8_t *serialNumber() { return nullptr; }
+};
+
+class USBDriver : public USBDeviceInfo
+{
+public:
+    operator bool() { return connected; }
+    bool connected = false;
+};
+
+class USBHIDInput : public USBDeviceInfo
+{
+public:
+    operator bool() { return false; }
+};
+
+class USBHub : public USBDriver
+{
+public:
+    USBHub(USBHost &host) {}
+};
+
+class USBHIDParser : public USBDriver
+{
+public:
+    USBHIDParser(USBHost &host) {}
+};
+
+class JoystickController : public USBDriver, public USBHIDInput
+{
+public:
+    enum joytype_t
+    {
+        UNKNOWN,
+        PS3,
+        PS4,
+        XBOXONE,
+        XBOX360,
+        PS3_MOTION,
+        SpaceNav,
+        SWITCH,
+    };
+
+    JoystickController(USBHost &host) {}
+
+    bool available() { return reportAvailable; }
+    void joystickDataClear()
+    {
+        reportAvailable = false;
+        axesChanged = 0;
+    }
+    uint32_t getButtons() { return buttons; }
+    int getAxis(uint32_t index) { return axes[index]; }
+    uint64_t axisMask() { return (1 << JOYSTICK_SHIM_AXIS_COUNT) - 1; }
+    uint64_t axisChangedMask() { return axesChanged; }
+    joytype_t joystickType() { return type; }
+
+    bool setLEDs(uint8_t red, uint8_t green, uint8_t blue)
+    {
+        ledReports++;
+        leds[0] = red;
+        leds[1] = green;
+        leds[2] = blue;
+        return true;
+    }
+    bool setLEDs(uint8_t playerLeds) { return setLEDs(playerLeds, 0, 0); }
+    bool setRumble(uint8_t left, uint8_t right, uint8_t timeout = 0xFF)
+    {
+        rumbleReports++;
+        rumble[0] = left;
+        rumble[1] = right;
+        return true;
+    }
+
+    // Test side: the next report (see shimJoystickReport() in shim.h) and the output reports that were sent
+    static const int JOYSTICK_SHIM_AXIS_COUNT = 5;
+    bool reportAvailable = false;
+    uint32_t buttons = 0;
+    int axes[JOYSTICK_SHIM_AXIS_COUNT] = { 128, 128, 128, 128, 8 };
+    uint64_t axesChanged = 0;
+    joytype_t type = PS4;
+    uint32_t ledReports = 0;
+    uint32_t rumbleReports = 0;
+    uint8_t leds[3] = { 0, 0, 0 };
+    uint8_t rumble[2] = { 0, 0 };
+};
+
+
+#endif // end _USB_HOST_T36_H_
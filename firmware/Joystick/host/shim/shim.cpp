@@ -0,0 +1,163 @@
+#include "shim.h"
+#include "SPI.h"
+#include "EEPROM.h"
+#include "USBHost_t36.h"
+
+// The display's D/C pin (see the Display in ux.cpp), data when high and commands when low
+const int SHIM_LCD_DC_PIN = 5;
+
+// PCD8544 commands, the address commands only count in the basic instruction set
+const uint8_t SHIM_LCD_FUNCTION_SET_MASK = 0xF8;
+const uint8_t SHIM_LCD_FUNCTION_SET = 0x20;
+const uint8_t SHIM_LCD_EXTENDED_INSTRUCTIONS = 0x01;
+const uint8_t SHIM_LCD_SET_X = 0x80;
+const uint8_t SHIM_LCD_SET_Y_MASK = 0xF8;
+const uint8_t SHIM_LCD_SET_Y = 0x40;
+
+const int SHIM_LCD_WIDTH = 84;
+const int SHIM_LCD_PAGES = 6;
+
+uint32_t ShimMicros = 0;
+uint8_t ShimPins[64];
+uint32_t ShimRandomState = 1;
+
+HardwareSerial Serial;
+HardwareSerial Serial1;
+HardwareSerial Serial2;
+SPIClass SPI;
+EEPROMClass EEPROM;
+
+extern JoystickController joysticks[];
+
+// Display emulation
+uint8_t ShimLcdRam[SHIM_LCD_RAM_SIZE];
+int ShimLcdX = 0;
+int ShimLcdY = 0;
+bool ShimLcdExtended = false;
+uint32_t ShimSpiBytes = 0;
+
+// The DMA transfer waiting for shimSpiCompleteTransfer()
+bool ShimSpiDeferred = false;
+const uint8_t *ShimSpiPendingData = nullptr;
+size_t ShimSpiPendingCount = 0;
+uint8_t ShimSpiPendingDc = LOW;
+EventResponder *ShimSpiPendingEvent = nullptr;
+
+void shimLcdReceive(const uint8_t *data, size_t count, bool isData);
+
+
+void shimSetMicros(uint32_t timeMicros)
+{
+    ShimMicros = timeMicros;
+}
+
+void shimAdvanceMicros(uint32_t micros)
+{
+    ShimMicros += micros;
+}
+
+void shimJoystickConnect(int slot, bool connected)
+{
+    USBDriver *driver = &joysticks[slot];
+    driver->connected = connected;
+}
+
+void shimJoystickReport(int slot, uint32_t buttons, const uint8_t *axes)
+{
+    JoystickController *joystick = &joysticks[slot];
+    joystick->reportAvailable = true;
+    joystick->buttons = buttons;
+    for (int i = 0; i < JoystickController::JOYSTICK_SHIM_AXIS_COUNT; i++)
+    {
+        if (joystick->axes[i] != axes[i])
+        {
+            joystick->axes[i] = axes[i];
+            joystick->axesChanged |= 1 << i;
+        }
+    }
+}
+
+void shimSpiSetDeferred(bool deferred)
+{
+    ShimSpiDeferred = deferred;
+}
+
+bool shimSpiCompleteTransfer()
+{
+    if (ShimSpiPendingEvent == nullptr)
+    {
+        return false;
+    }
+
+    // The bytes reach the display when the transfer completes, with the D/C level it was started with
+    EventResponder *event = ShimSpiPendingEvent;
+    ShimSpiPendingEvent = nullptr;
+    shimLcdReceive(ShimSpiPendingData, ShimSpiPendingCount, ShimSpiPendingDc == HIGH);
+    event->triggerEvent();
+    return true;
+}
+
+uint32_t shimSpiBytesSent()
+{
+    return ShimSpiBytes;
+}
+
+const uint8_t *shimLcdRam()
+{
+    return ShimLcdRam;
+}
+
+void shimSpiWrite(const uint8_t *data, size_t count)
+{
+    shimLcdReceive(data, count, ShimPins[SHIM_LCD_DC_PIN] == HIGH);
+}
+
+bool SPIClass::transfer(const void *txBuffer, void *rxBuffer, size_t count, EventResponderRef event)
+{
+    if (ShimSpiPendingEvent != nullptr)
+    {
+        fprintf(stderr, "shim: DMA transfer started while another one is pending\n");
+        abort();
+    }
+
+    ShimSpiPendingData = (const uint8_t *)txBuffer;
+    ShimSpiPendingCount = count;
+    ShimSpiPendingDc = ShimPins[SHIM_LCD_DC_PIN];
+    ShimSpiPendingEvent = &event;
+    if (!ShimSpiDeferred)
+    {
+        shimSpiCompleteTransfer();
+    }
+    return true;
+}
+
+void shimLcdReceive(const uint8_t *data, size_t count, bool isData)
+{
+    ShimSpiBytes += count;
+    for (size_t i = 0; i < count; i++)
+    {
+        uint8_t c = data[i];
+        if (isData)
+        {
+            // The address moves right along the page and wraps to the start of the next page
+            ShimLcdRam[ShimLcdY * SHIM_LCD_WIDTH + ShimLcdX] = c;
+            if (++ShimLcdX == SHIM_LCD_WIDTH)
+            {
+                ShimLcdX = 0;
+                ShimLcdY = (ShimLcdY + 1) % SHIM_LCD_PAGES;
+            }
+        }
+        else if ((c & SHIM_LCD_FUNCTION_SET_MASK) == SHIM_LCD_FUNCTION_SET)
+        {
+            ShimLcdExtended = (c & SHIM_LCD_EXTENDED_INSTRUCTIONS) != 0;
+        }
+        else if (!ShimLcdExtended && (c & SHIM_LCD_SET_X))
+        {
+            ShimLcdX = min(c & ~SHIM_LCD_SET_X, SHIM_LCD_WIDTH - 1);
+        }
+        else if (!ShimLcdExtended && (c & SHIM_LCD_SET_Y_MASK) == SHIM_LCD_SET_Y)
+        {
+            ShimLcdY = min(c & ~SHIM_LCD_SET_Y_MASK, SHIM_LCD_PAGES - 1);
+        }
+    }
+}
@@ -0,0 +1,39 @@
+#ifndef _SHIM_H_
+#define _SHIM_H_
+
+// Test side of the host shim: the virtual clock, the joysticks and the display emulation
+
+#include "Arduino.h"
+
+// The size of the PCD8544 display RAM, one byte per column of each 8 row page
+const int SHIM_LCD_RAM_SIZE = 84 * 48 / 8;
+
+// Sets the virtual clock (millis() and micros() are the same clock)
+void shimSetMicros(uint32_t timeMicros);
+
+// Moves the virtual clock on
+void shimAdvanceMicros(uint32_t micros);
+
+// Connects or disconnects the USB joystick in a slot
+void shimJoystickConnect(int slot, bool connected);
+
+// Gives the joystick in a slot a report to read, with the buttons and the raw axes (see AXIS_LEFT_STICK_X...)
+// Only the axes that differ from the last report are flagged as changed, like the USB host driver does
+void shimJoystickReport(int slot, uint32_t buttons, const uint8_t *axes);
+
+// Whether or not DMA transfers wait for shimSpiCompleteTransfer(), by default they complete as soon as they start
+// Waiting lets a test draw while the previous update is still being sent
+void shimSpiSetDeferred(bool deferred);
+
+// Completes the pending DMA transfer, the display update continues with the next one from its completion event
+// Returns false if no transfer was pending
+bool shimSpiCompleteTransfer();
+
+// The bytes sent over SPI since the start (commands and data, blocking writes and DMA transfers)
+uint32_t shimSpiBytesSent();
+
+// The display RAM as the bytes sent over SPI left it, in the layout of pcd8544_buffer
+const uint8_t *shimLcdRam();
+
+
+#endif // end _SHIM_H_
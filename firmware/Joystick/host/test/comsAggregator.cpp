@@ -0,0 +1,122 @@
+#include "comsAggregator.h"
+#include "pb_encode.h"
+#include "pb_decode.h"
+#include <stdio.h>
+#include <vector>
+
+int comsAggregatorRead(uint8_t *data, int length);
+int comsAggregatorWrite(const uint8_t *data, int length);
+
+const ComsPort_t ComsAggregatorPort = { comsAggregatorRead, comsAggregatorWrite, NULL };
+int ComsAggregatorRoom = -1;
+
+std::vector<uint8_t> ComsAggregatorWritten;
+size_t ComsAggregatorWrittenRead = 0;
+std::vector<uint8_t> ComsAggregatorInput;
+size_t ComsAggregatorInputRead = 0;
+int ComsAggregatorBadFrames = 0;
+
+
+void comsAggregatorReset()
+{
+    ComsAggregatorRoom = -1;
+    ComsAggregatorWritten.clear();
+    ComsAggregatorWrittenRead = 0;
+    ComsAggregatorInput.clear();
+    ComsAggregatorInputRead = 0;
+}
+
+int comsAggregatorRead(uint8_t *data, int length)
+{
+    int count = 0;
+    while (count < length && ComsAggregatorInputRead < ComsAggregatorInput.size())
+    {
+        data[count++] = ComsAggregatorInput[ComsAggregatorInputRead++];
+    }
+    return count;
+}
+
+int comsAggregatorWrite(const uint8_t *data, int length)
+{
+    int count = ComsAggregatorRoom < 0 || length < ComsAggregatorRoom ? length : ComsAggregatorRoom;
+    ComsAggregatorWritten.insert(ComsAggregatorWritten.end(), data, data + count);
+    if (ComsAggregatorRoom >= 0)
+    {
+        ComsAggregatorRoom -= count;
+    }
+    return count;
+}
+
+bool comsAggregatorNextMessage(JoystickMessage *message)
+{
+    size_t end = ComsAggregatorWrittenRead;
+    while (end < ComsAggregatorWritten.size() && ComsAggregatorWritten[end] != 0)
+    {
+        end++;
+    }
+    if (end == ComsAggregatorWritten.size())
+    {
+        return false;
+    }
+
+    // COBS, every block but a full one (0xFF) ends with a 0 unless it is the last
+    std::vector<uint8_t> decoded;
+    size_t position = ComsAggregatorWrittenRead;
+    while (position < end)
+    {
+        uint8_t code = ComsAggregatorWritten[position++];
+        for (int i = 1; i < code && position < end; i++)
+        {
+            decoded.push_back(ComsAggregatorWritten[position++]);
+        }
+        if (code != 0xFF && position < end)
+        {
+            decoded.push_back(0);
+        }
+    }
+    ComsAggregatorWrittenRead = end + 1;
+
+    pb_istream_t stream = pb_istream_from_buffer(decoded.data(), decoded.size());
+    if (!pb_decode(&stream, JoystickMessage_fields, message))
+    {
+        printf("FAIL: a frame from the joystick doesn't decode: %s\n", PB_GET_ERROR(&stream));
+        ComsAggregatorBadFrames++;
+        return comsAggregatorNextMessage(message);
+    }
+    return true;
+}
+
+void comsAggregatorReply(const JoystickReplyMessage *reply)
+{
+    uint8_t message[JoystickReplyMessage_size];
+    pb_ostream_t stream = pb_ostream_from_buffer(message, sizeof(message));
+    if (!pb_encode(&stream, JoystickReplyMessage_fields, reply))
+    {
+        printf("FAIL: reply %d doesn't encode: %s\n", reply->which_message, PB_GET_ERROR(&stream));
+        ComsAggregatorBadFrames++;
+        return;
+    }
+
+    size_t codeIndex = ComsAggregatorInput.size();
+    ComsAggregatorInput.push_back(0);
+    for (size_t i = 0; i < stream.bytes_written; i++)
+    {
+        if (message[i] != 0)
+        {
+            ComsAggregatorInput.push_back(message[i]);
+        }
+        if (message[i] == 0 || ComsAggregatorInput.size() - codeIndex == 0xFF)
+        {
+            ComsAggregatorInput[codeIndex] = ComsAggregatorInput.size() - codeIndex;
+            codeIndex = ComsAggregatorInput.size();
+            ComsAggregatorInput.push_back(0);
+        }
+    }
+    ComsAggregatorInput[codeIndex] = ComsAggregatorInput.size() - codeIndex;
+    ComsAggregatorInput.push_back(0);
+}
+
+int comsAggregatorBadFrames()
+{
+    return ComsAggregatorBadFrames;
+}
@@ -0,0 +1,29 @@
+#ifndef _COMS_AGGREGATOR_H_
+#define _COMS_AGGREGATOR_H_
+
+#include "coms.h"
+
+// The aggregator end of an in-memory link for the coms tests
+// The port takes bytes while it has room (the test sets it, like a UART transmit buffer draining), the frames the joystick
+// wrote are decoded back into messages and the replies queued by the test are read by the joystick in the next comsUpdate()
+
+extern const ComsPort_t ComsAggregatorPort;
+
+// The bytes the port still takes, -1 for no limit
+extern int ComsAggregatorRoom;
+
+// Clears the bytes written and the replies not read yet, and removes the limit
+void comsAggregatorReset();
+
+// Gets the next frame the joystick finished writing
+// Returns false if there is none; true otherwise (a frame that doesn't decode is a test failure and counted)
+bool comsAggregatorNextMessage(JoystickMessage *message);
+
+// Queues a reply for the joystick
+void comsAggregatorReply(const JoystickReplyMessage *reply);
+
+// Gets the number of frames from the joystick that didn't decode
+int comsAggregatorBadFrames();
+
+
+#endif // end _COMS_AGGREGATOR_H_
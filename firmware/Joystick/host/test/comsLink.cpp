@@ -0,0 +1,355 @@
+// The aggregator link over a pty
+// Opens the joystick end of a pty with comsPosixOpen() and plays the aggregator on the other end: the messages sent with
+// comsSend() have to come out as the same JoystickMessage, and the replies written back have to be applied by comsUpdate(),
+// from fault texts long enough to need a full 254 byte COBS block to a reply split across reads
+// Truncated, corrupt and overlong frames are counted as bad frames and the frame after each one is received
+
+#include "coms.h"
+#include "faultLog.h"
+#include "pb_encode.h"
+#include "pb_decode.h"
+#include <fcntl.h>
+#include <pty.h>
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+#include <string>
+#include <vector>
+
+// How long the other end of the pty is waited for, 1ms at a time
+const int COMS_LINK_WAIT_STEPS = 1000;
+
+// How long the joystick is left to read a part of a reply
+const int COMS_LINK_SETTLE_STEPS = 50;
+
+int ComsLinkAggregator = -1;
+SystemStatus_t ComsLinkStatus = {};
+uint32_t ComsLinkMicros = 0;
+int ComsLinkFailures = 0;
+
+// Runs comsUpdate() until the condition holds, returns false if it never does
+template <typename Condition>
+bool comsLinkUpdateUntil(Condition condition, int steps = COMS_LINK_WAIT_STEPS)
+{
+    for (int step = 0; step < steps; step++)
+    {
+        ComsLinkMicros += 1000;
+        comsUpdate(&ComsLinkStatus, ComsLinkMicros / 1000, ComsLinkMicros);
+        if (condition())
+        {
+            return true;
+        }
+        usleep(1000);
+    }
+    return false;
+}
+
+// Encodes a frame the way the aggregator does, with its own COBS encoder
+std::vector<uint8_t> comsLinkEncodeReply(const JoystickReplyMessage *reply)
+{
+    uint8_t message[JoystickReplyMessage_size];
+    pb_ostream_t stream = pb_ostream_from_buffer(message, sizeof(message));
+    if (!pb_encode(&stream, JoystickReplyMessage_fields, reply))
+    {
+        printf("FAIL: reply %d doesn't encode: %s\n", reply->which_message, PB_GET_ERROR(&stream));
+        ComsLinkFailures++;
+    }
+
+    std::vector<uint8_t> frame(1);
+    size_t codeIndex = 0;
+    for (size_t i = 0; i < stream.bytes_written; i++)
+    {
+        if (message[i] != 0)
+        {
+            frame.push_back(message[i]);
+        }
+        if (message[i] == 0 || frame.size() - codeIndex == 0xFF)
+        {
+            frame[codeIndex] = frame.size() - codeIndex;
+            codeIndex = frame.size();
+            frame.push_back(0);
+        }
+    }
+    frame[codeIndex] = frame.size() - codeIndex;
+    frame.push_back(0);
+    return frame;
+}
+
+void comsLinkWrite(const std::vector<uint8_t> &bytes)
+{
+    if (write(ComsLinkAggregator, bytes.data(), bytes.size()) != (ssize_t)bytes.size())
+    {
+        printf("FAIL: the aggregator end of the pty didn't take %zu bytes\n", bytes.size());
+        ComsLinkFailures++;
+    }
+}
+
+// Writes a reply frame and waits for the joystick to take it, good or bad
+bool comsLinkReply(const std::vector<uint8_t> &frame)
+{
+    ComsStats_t before = *comsStats();
+    comsLinkWrite(frame);
+    return comsLinkUpdateUntil([&]() {
+        return comsStats()->framesReceived + comsStats()->badFrames != before.framesReceived + before.badFrames;
+    });
+}
+
+// Reads the next frame the joystick sent and decodes it
+bool comsLinkReadMessage(JoystickMessage *message)
+{
+    std::vector<uint8_t> frame;
+    for (int step = 0; step < COMS_LINK_WAIT_STEPS && (frame.empty() || frame.back() != 0); step++)
+    {
+        uint8_t data;
+        if (read(ComsLinkAggregator, &data, 1) == 1)
+        {
+            frame.push_back(data);
+        }
+        else
+        {
+            comsUpdate(&ComsLinkStatus, ComsLinkMicros / 1000, ComsLinkMicros);
+            usleep(1000);
+        }
+    }
+    if (frame.empty() || frame.back() != 0)
+    {
+        printf("FAIL: no frame from the joystick\n");
+        ComsLinkFailures++;
+        return false;
+    }
+
+    std::vector<uint8_t> decoded;
+    for (size_t i = 0; i + 1 < frame.size(); )
+    {
+        uint8_t code = frame[i++];
+        for (int j = 1; j < code && i + 1 < frame.size(); j++)
+        {
+            decoded.push_back(frame[i++]);
+        }
+        if (code != 0xFF && i + 1 < frame.size())
+        {
+            decoded.push_back(0);
+        }
+    }
+    pb_istream_t stream = pb_istream_from_buffer(decoded.data(), decoded.size());
+    if (!pb_decode(&stream, JoystickMessage_fields, message))
+    {
+        printf("FAIL: a frame from the joystick doesn't decode: %s\n", PB_GET_ERROR(&stream));
+        ComsLinkFailures++;
+        return false;
+    }
+    return true;
+}
+
+void comsLinkCheckSent(const JoystickMessage *message)
+{
+    uint32_t framesSent = comsStats()->framesSent;
+    if (!comsSend(message))
+    {
+        printf("FAIL: message %d wasn't sent\n", message->which_message);
+        ComsLinkFailures++;
+        return;
+    }
+    JoystickMessage received;
+    if (!comsLinkReadMessage(&received))
+    {
+        return;
+    }
+    if (received.which_message != message->which_message || memcmp(&received.message, &message->message, sizeof(message->message)) != 0)
+    {
+        printf("FAIL: message %d came out of the pty as message %d with other values\n", message->which_message,
+            received.which_message);
+        ComsLinkFailures++;
+    }
+    if (comsStats()->framesSent != framesSent + 1)
+    {
+        printf("FAIL: message %d counted as %u frames sent\n", message->which_message, comsStats()->framesSent - framesSent);
+        ComsLinkFailures++;
+    }
+}
+
+// A message with every byte of the union cleared, so it compares with memcmp()
+JoystickMessage comsLinkMessage(pb_size_t tag)
+{
+    JoystickMessage message;
+    memset(&message, 0, sizeof(message));
+    message.which_message = tag;
+    return message;
+}
+
+void comsLinkCheckSend()
+{
+    JoystickMessage message = comsLinkMessage(JoystickMessage_get_ping_tag);
+    message.message.get_ping.iteration = 1234567;
+    comsLinkCheckSent(&message);
+
+    message = comsLinkMessage(JoystickMessage_trigger_sequence_tag);
+    strcpy(message.message.trigger_sequence.id, "15");
+    message.message.trigger_sequence.frame = -3;
+    comsLinkCheckSent(&message);
+
+    message = comsLinkMessage(JoystickMessage_set_propulsion_tag);
+    message.message.set_propulsion.left = 0;
+    message.message.set_propulsion.right = 255;
+    comsLinkCheckSent(&message);
+
+    message = comsLinkMessage(JoystickMessage_abort_sequence_tag);
+    comsLinkCheckSent(&message);
+}
+
+// Fault texts around the length that fills a COBS block (the frame has no 0 but its delimiter)
+void comsLinkCheckLongFrames()
+{
+    for (int length = 240; length <= FAULT_LOG_MAX_LENGTH; length++)
+    {
+        JoystickReplyMessage reply = JoystickReplyMessage_init_zero;
+        reply.which_message = JoystickReplyMessage_fault_event_tag;
+        for (int i = 0; i < length; i++)
+        {
+            reply.message.fault_event.fault_message[i] = 'A' + (i + length) % 26;
+        }
+        std::vector<uint8_t> frame = comsLinkEncodeReply(&reply);
+
+        uint32_t framesReceived = comsStats()->framesReceived;
+        if (!comsLinkReply(frame) || comsStats()->framesReceived != framesReceived + 1)
+        {
+            printf("FAIL: a %zu byte frame with a %d byte fault wasn't received\n", frame.size(), length);
+            ComsLinkFailures++;
+            continue;
+        }
+
+        int textLength;
+        const char *text = faultLogText(faultLogGet(0), &textLength);
+        if (textLength != length || memcmp(text, reply.message.fault_event.fault_message, length) != 0)
+        {
+            printf("FAIL: a %d byte fault came out as %d bytes \"%.20s\"\n", length, textLength, text);
+            ComsLinkFailures++;
+        }
+    }
+}
+
+void comsLinkCheckBadFrames()
+{
+    JoystickReplyMessage reply = JoystickReplyMessage_init_zero;
+    reply.which_message = JoystickReplyMessage_ping_reply_tag;
+    reply.message.ping_reply.iteration = 77;
+    std::vector<uint8_t> good = comsLinkEncodeReply(&reply);
+
+    reply = JoystickReplyMessage_init_zero;
+    reply.which_message = JoystickReplyMessage_fault_event_tag;
+    strcpy(reply.message.fault_event.fault_message, "Sequencer disconnected");
+    std::vector<uint8_t> truncated = comsLinkEncodeReply(&reply);
+    truncated.erase(truncated.end() - 6, truncated.end() - 1);
+
+    // A fault event that is longer than the frame it is in
+    std::vector<uint8_t> corrupt = { 0x04, 0x22, 0x10, 0x0A, 0x00 };
+
+    // More than the longest reply
+    std::vector<uint8_t> overlong(JoystickReplyMessage_size + 20, 0x55);
+    for (size_t i = 0; i < overlong.size(); i += 0xFF)
+    {
+        overlong[i] = 0xFF;
+    }
+    overlong.push_back(0);
+
+    const std::vector<uint8_t> *bad[] = { &truncated, &corrupt, &overlong };
+    const char *names[] = { "truncated", "corrupt", "overlong" };
+    for (int i = 0; i < 3; i++)
+    {
+        ComsStats_t before = *comsStats();
+        comsLinkReply(*bad[i]);
+        if (comsStats()->badFrames != before.badFrames + 1 || comsStats()->framesReceived != before.framesReceived)
+        {
+            printf("FAIL: a %s frame counted as %u bad frames and %u frames received\n", names[i],
+                comsStats()->badFrames - before.badFrames, comsStats()->framesReceived - before.framesReceived);
+            ComsLinkFailures++;
+        }
+        if (!comsLinkReply(good) || comsStats()->framesReceived != before.framesReceived + 1)
+        {
+            printf("FAIL: the frame after a %s frame wasn't received\n", names[i]);
+            ComsLinkFailures++;
+        }
+    }
+}
+
+// A full status written in three parts, the joystick reads each part before the next one is written
+void comsLinkCheckSplitReply()
+{
+    JoystickReplyMessage reply = JoystickReplyMessage_init_zero;
+    reply.which_message = JoystickReplyMessage_system_status_reply_tag;
+    SystemStatusReply *status = &reply.message.system_status_reply;
+    status->has_igniors_status = true;
+    status->igniors_status.aggregator_armed = true;
+    status->igniors_status.controllers_connected_count = IGNIOR_CONTROLLER_COUNT;
+    status->igniors_status.controllers_connected[0] = true;
+    status->igniors_status.controllers_connected[2] = true;
+    status->has_sequencer_status = true;
+    status->sequencer_status.controller_connected = true;
+    status->sequencer_status.sequence_count = 12;
+    status->sequencer_status.sequence_frame_count = 300;
+    status->visual_test_enabled = true;
+    std::vector<uint8_t> frame = comsLinkEncodeReply(&reply);
+
+    uint32_t framesReceived = comsStats()->framesReceived;
+    size_t parts[] = { 0, 3, frame.size() / 2, frame.size() };
+    for (int i = 0; i < 3; i++)
+    {
+        comsLinkWrite(std::vector<uint8_t>(frame.begin() + parts[i], frame.begin() + parts[i + 1]));
+        if (i < 2)
+        {
+            // Nothing to wait for, give the pty time to pass the part on
+            comsLinkUpdateUntil([]() { return false; }, COMS_LINK_SETTLE_STEPS);
+            if (comsStats()->framesReceived != framesReceived)
+            {
+                printf("FAIL: a reply was received from the first %zu of its %zu bytes\n", parts[i + 1], frame.size());
+                ComsLinkFailures++;
+            }
+        }
+    }
+    comsLinkUpdateUntil([&]() { return comsStats()->framesReceived != framesReceived; });
+
+    if (comsStats()->framesReceived != framesReceived + 1 || !ComsLinkStatus.isSoftwareArmed
+        || !ComsLinkStatus.ignitorControllersConnected[0] || ComsLinkStatus.ignitorControllersConnected[1]
+        || !ComsLinkStatus.ignitorControllersConnected[2] || !ComsLinkStatus.isSequencerConnected
+        || ComsLinkStatus.sequenceCount != 12 || ComsLinkStatus.sequenceFrameCount != 300 || !ComsLinkStatus.isVisualTestEnabled)
+    {
+        printf("FAIL: the status split across reads wasn't applied\n");
+        ComsLinkFailures++;
+    }
+}
+
+int main()
+{
+    int joystick;
+    char path[64];
+    if (openpty(&ComsLinkAggregator, &joystick, path, NULL, NULL) != 0)
+    {
+        printf("FAIL: no pty\n");
+        return 1;
+    }
+    fcntl(ComsLinkAggregator, F_SETFL, fcntl(ComsLinkAggregator, F_GETFL) | O_NONBLOCK);
+
+    ComsPort_t port;
+    if (!comsPosixOpen(path, &port))
+    {
+        printf("FAIL: comsPosixOpen() didn't open %s\n", path);
+        return 1;
+    }
+    close(joystick);
+    comsInit(&port);
+    faultLogClear();
+
+    comsLinkCheckSend();
+    comsLinkCheckLongFrames();
+    comsLinkCheckBadFrames();
+    comsLinkCheckSplitReply();
+
+    ComsStats_t *stats = comsStats();
+    printf("%u frames sent, %u received, %u bad\n", stats->framesSent, stats->framesReceived, stats->badFrames);
+    if (ComsLinkFailures > 0)
+    {
+        printf("%d failures\n", ComsLinkFailures);
+        return 1;
+    }
+    return 0;
+}
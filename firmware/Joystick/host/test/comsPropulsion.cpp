@@ -0,0 +1,183 @@
+// Propulsion cadence on the aggregator link
+// The sticks are moved every millisecond for 1s, then held still for 1s: the values must go out at the control rate
+// (COMS_PROPULSION_INTERVAL) and then as keepalives every COMS_PROPULSION_KEEPALIVE_INTERVAL. Then the main loop stalls
+// while the sticks move, the sends after it must not burst to catch up. Every update that wasn't sent counts as dropped
+
+#include "coms.h"
+#include "comsAggregator.h"
+#include <stdio.h>
+#include <vector>
+
+const uint32_t PROPULSION_MOVE_MILLIS = 1000;
+const uint32_t PROPULSION_STILL_MILLIS = 1000;
+const uint32_t PROPULSION_STALL_START_MILLIS = 100;
+const uint32_t PROPULSION_STALL_MILLIS = 70;
+
+SystemStatus_t PropulsionStatus = {};
+int PropulsionFailures = 0;
+
+// The SetPropulsion messages started by comsSendRequests() and when, and the values of the last one received
+std::vector<uint32_t> PropulsionSentMillis;
+std::vector<bool> PropulsionSentKeepalive;
+uint32_t PropulsionReceived = 0;
+uint32_t PropulsionLastLeft = 0;
+
+// Takes the frames the joystick finished writing, pings are answered right away so the connection stays up
+void propulsionTakeFrames()
+{
+    JoystickMessage message;
+    while (comsAggregatorNextMessage(&message))
+    {
+        if (message.which_message == JoystickMessage_set_propulsion_tag)
+        {
+            PropulsionReceived++;
+            PropulsionLastLeft = message.message.set_propulsion.left;
+        }
+        else if (message.which_message == JoystickMessage_get_ping_tag)
+        {
+            JoystickReplyMessage reply = JoystickReplyMessage_init_zero;
+            reply.which_message = JoystickReplyMessage_ping_reply_tag;
+            reply.message.ping_reply.iteration = message.message.get_ping.iteration;
+            comsAggregatorReply(&reply);
+        }
+    }
+}
+
+// One millisecond of the main loop, the UX moves the sticks first if they are moving
+void propulsionStep(uint32_t timeMillis, bool moving)
+{
+    if (moving)
+    {
+        PropulsionStatus.propulsionLeft++;
+        PropulsionStatus.propulsionUpdateCount++;
+        PropulsionStatus.propulsionUpdateRequested = true;
+    }
+
+    comsUpdate(&PropulsionStatus, timeMillis, timeMillis * 1000);
+    uint32_t sent = comsStats()->propulsionSent;
+    uint32_t keepalives = comsStats()->propulsionKeepalives;
+    comsSendRequests(&PropulsionStatus, timeMillis, timeMillis * 1000);
+    if (comsStats()->propulsionSent != sent)
+    {
+        PropulsionSentMillis.push_back(timeMillis);
+        PropulsionSentKeepalive.push_back(comsStats()->propulsionKeepalives != keepalives);
+    }
+    propulsionTakeFrames();
+}
+
+// Counts the sends from one millisecond to another
+void propulsionCount(uint32_t startMillis, uint32_t endMillis, int *updates, int *keepalives)
+{
+    *updates = 0;
+    *keepalives = 0;
+    for (size_t i = 0; i < PropulsionSentMillis.size(); i++)
+    {
+        if (PropulsionSentMillis[i] >= startMillis && PropulsionSentMillis[i] < endMillis)
+        {
+            (PropulsionSentKeepalive[i] ? *keepalives : *updates)++;
+        }
+    }
+}
+
+void propulsionCheckDropped(const char *when)
+{
+    const ComsStats_t *stats = comsStats();
+    uint32_t updatesSent = stats->propulsionSent - stats->propulsionKeepalives;
+    if (stats->propulsionDropped != PropulsionStatus.propulsionUpdateCount - updatesSent)
+    {
+        printf("FAIL: %s: %u dropped, %u updates and %u of them sent\n", when, stats->propulsionDropped,
+            PropulsionStatus.propulsionUpdateCount, updatesSent);
+        PropulsionFailures++;
+    }
+    if (PropulsionReceived != stats->propulsionSent || PropulsionLastLeft != PropulsionStatus.propulsionLeft)
+    {
+        printf("FAIL: %s: %u of %u SetPropulsion received, the last with %u instead of %u\n", when, PropulsionReceived,
+            stats->propulsionSent, PropulsionLastLeft, PropulsionStatus.propulsionLeft);
+        PropulsionFailures++;
+    }
+}
+
+int main()
+{
+    PropulsionStatus.isConnected = true;
+    comsAggregatorReset();
+    comsInit(&ComsAggregatorPort);
+
+    // The sticks move every millisecond, the control rate is what goes out
+    uint32_t startMillis = 10000;
+    uint32_t timeMillis = startMillis;
+    for (; timeMillis < startMillis + PROPULSION_MOVE_MILLIS; timeMillis++)
+    {
+        propulsionStep(timeMillis, true);
+    }
+    propulsionStep(timeMillis++, false);
+
+    int updates;
+    int keepalives;
+    int expected = PROPULSION_MOVE_MILLIS / COMS_PROPULSION_INTERVAL;
+    propulsionCount(startMillis, startMillis + PROPULSION_MOVE_MILLIS, &updates, &keepalives);
+    if (updates < expected - 1 || updates > expected + 1 || keepalives != 0
+        || comsStats()->propulsionRate + 1 < (uint32_t)expected || comsStats()->propulsionRate > (uint32_t)expected + 1)
+    {
+        printf("FAIL: moving: %d updates and %d keepalives sent in %ums, %u/s measured\n", updates, keepalives,
+            PROPULSION_MOVE_MILLIS, comsStats()->propulsionRate);
+        PropulsionFailures++;
+    }
+    propulsionCheckDropped("moving");
+
+    // Still sticks only send keepalives, the first one a keepalive interval after the last values
+    uint32_t stillMillis = timeMillis;
+    for (; timeMillis < stillMillis + PROPULSION_STILL_MILLIS; timeMillis++)
+    {
+        propulsionStep(timeMillis, false);
+    }
+    propulsionCount(stillMillis, timeMillis, &updates, &keepalives);
+    if (updates != 0 || keepalives != (int)(PROPULSION_STILL_MILLIS / COMS_PROPULSION_KEEPALIVE_INTERVAL))
+    {
+        printf("FAIL: still: %d updates and %d keepalives sent in %ums\n", updates, keepalives, PROPULSION_STILL_MILLIS);
+        PropulsionFailures++;
+    }
+    for (size_t i = 1; i < PropulsionSentMillis.size(); i++)
+    {
+        uint32_t interval = PropulsionSentMillis[i] - PropulsionSentMillis[i - 1];
+        if (PropulsionSentKeepalive[i] && (interval < COMS_PROPULSION_KEEPALIVE_INTERVAL
+            || interval > COMS_PROPULSION_KEEPALIVE_INTERVAL + 1))
+        {
+            printf("FAIL: still: keepalive %ums after the last send at %u\n", interval, PropulsionSentMillis[i]);
+            PropulsionFailures++;
+        }
+    }
+    propulsionCheckDropped("still");
+
+    // The sticks move again and the main loop stalls, what was late isn't made up for by sending faster
+    uint32_t stallMillis = timeMillis + PROPULSION_STALL_START_MILLIS;
+    for (; timeMillis < stallMillis + PROPULSION_STALL_MILLIS + PROPULSION_MOVE_MILLIS; timeMillis++)
+    {
+        if (timeMillis < stallMillis || timeMillis >= stallMillis + PROPULSION_STALL_MILLIS)
+        {
+            propulsionStep(timeMillis, true);
+        }
+    }
+    propulsionStep(timeMillis++, false);
+    for (size_t i = 1; i < PropulsionSentMillis.size(); i++)
+    {
+        uint32_t interval = PropulsionSentMillis[i] - PropulsionSentMillis[i - 1];
+        if (interval < COMS_PROPULSION_INTERVAL)
+        {
+            printf("FAIL: stalled: sent %ums after the last send at %u\n", interval, PropulsionSentMillis[i]);
+            PropulsionFailures++;
+        }
+    }
+    propulsionCheckDropped("stalled");
+
+    if (comsAggregatorBadFrames() > 0)
+    {
+        PropulsionFailures++;
+    }
+    if (PropulsionFailures > 0)
+    {
+        printf("%d failures\n", PropulsionFailures);
+        return 1;
+    }
+    return 0;
+}
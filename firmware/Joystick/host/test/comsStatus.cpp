@@ -0,0 +1,215 @@
+// The system status subscription and its deltas
+// A subscribe the aggregator never got must not be confirmed by the reply to a poll, the status is polled until a full
+// status says the subscription was taken up. Then polling stops, a delta from the current version is applied, one from
+// another version asks for the full status again and the deltas up to it are dropped, and once the full status stops
+// coming for COMS_STATUS_SNAPSHOT_TIMEOUT the status is polled again
+
+#include "coms.h"
+#include "comsAggregator.h"
+#include <stdio.h>
+
+SystemStatus_t StatusStatus = {};
+int StatusFailures = 0;
+
+// The aggregator end: its status version, whether subscribes get through and whether it pushes to the joystick
+uint32_t StatusVersion = 0;
+bool StatusArmed = false;
+bool StatusSubscribeLost = false;
+bool StatusSubscribed = false;
+bool StatusHoldReplies = false;
+
+// The status requests seen since the counts were cleared, and the ones held up
+int StatusPolls = 0;
+int StatusSubscribes = 0;
+int StatusHeldReplies = 0;
+
+void statusCheck(bool condition, const char *what)
+{
+    if (!condition)
+    {
+        printf("FAIL: %s\n", what);
+        StatusFailures++;
+    }
+}
+
+void statusReplySnapshot()
+{
+    JoystickReplyMessage reply = JoystickReplyMessage_init_zero;
+    reply.which_message = JoystickReplyMessage_system_status_reply_tag;
+    reply.message.system_status_reply.has_igniors_status = true;
+    reply.message.system_status_reply.igniors_status.aggregator_armed = StatusArmed;
+    reply.message.system_status_reply.has_sequencer_status = true;
+    reply.message.system_status_reply.version = StatusVersion;
+    reply.message.system_status_reply.subscribed = StatusSubscribed;
+    comsAggregatorReply(&reply);
+}
+
+void statusReplyDelta(uint32_t baseVersion, uint32_t version, bool armed)
+{
+    JoystickReplyMessage reply = JoystickReplyMessage_init_zero;
+    reply.which_message = JoystickReplyMessage_system_status_delta_tag;
+    reply.message.system_status_delta.base_version = baseVersion;
+    reply.message.system_status_delta.version = version;
+    reply.message.system_status_delta.has_aggregator_armed = true;
+    reply.message.system_status_delta.aggregator_armed = armed;
+    comsAggregatorReply(&reply);
+}
+
+// Answers the frames the joystick finished writing like the aggregator would
+void statusTakeFrames()
+{
+    JoystickMessage message;
+    while (comsAggregatorNextMessage(&message))
+    {
+        switch (message.which_message)
+        {
+            case JoystickMessage_get_ping_tag:
+            {
+                JoystickReplyMessage reply = JoystickReplyMessage_init_zero;
+                reply.which_message = JoystickReplyMessage_ping_reply_tag;
+                reply.message.ping_reply.iteration = message.message.get_ping.iteration;
+                comsAggregatorReply(&reply);
+                break;
+            }
+
+            case JoystickMessage_get_system_status_tag:
+                StatusPolls++;
+                if (StatusHoldReplies)
+                {
+                    StatusHeldReplies++;
+                }
+                else
+                {
+                    statusReplySnapshot();
+                }
+                break;
+
+            case JoystickMessage_subscribe_system_status_tag:
+                StatusSubscribes++;
+                if (!StatusSubscribeLost && message.message.subscribe_system_status.enable)
+                {
+                    StatusSubscribed = true;
+                    statusReplySnapshot();
+                }
+                break;
+
+            default:
+                break;
+        }
+    }
+}
+
+// Runs the main loop from one millisecond to another, the status requests are counted from the start
+void statusRun(uint32_t startMillis, uint32_t endMillis)
+{
+    StatusPolls = 0;
+    StatusSubscribes = 0;
+    for (uint32_t timeMillis = startMillis; timeMillis < endMillis; timeMillis++)
+    {
+        comsUpdate(&StatusStatus, timeMillis, timeMillis * 1000);
+        comsSendRequests(&StatusStatus, timeMillis, timeMillis * 1000);
+        statusTakeFrames();
+    }
+}
+
+int main()
+{
+    StatusStatus.isConnected = true;
+    comsAggregatorReset();
+    comsInit(&ComsAggregatorPort);
+
+    // The subscribes get lost: the polls go on and their replies, versioned but not subscribed, don't stop them
+    uint32_t timeMillis = 10000;
+    StatusVersion = 5;
+    StatusSubscribeLost = true;
+    statusRun(timeMillis, timeMillis + 2000);
+    timeMillis += 2000;
+    statusCheck(StatusSubscribes >= 2, "the subscribe isn't sent again while it isn't taken up");
+    statusCheck(StatusPolls >= (int)(2000 / COMS_STATUS_REQUEST_INTERVAL) - 1, "polling stopped after a subscribe that got lost");
+    statusCheck(comsStats()->statusSnapshots == (uint32_t)StatusPolls, "poll replies not applied");
+
+    // Nothing is pushed yet, a delta that comes anyway is dropped
+    statusReplyDelta(5, 6, true);
+    statusRun(timeMillis, timeMillis + 10);
+    timeMillis += 10;
+    statusCheck(comsStats()->statusDeltas == 0 && !StatusStatus.isSoftwareArmed, "delta applied before subscribing");
+
+    // The next subscribe gets through, its full status confirms it and the polls stop
+    StatusSubscribeLost = false;
+    statusRun(timeMillis, timeMillis + 2 * COMS_SUBSCRIBE_RETRY_INTERVAL);
+    timeMillis += 2 * COMS_SUBSCRIBE_RETRY_INTERVAL;
+    statusCheck(StatusSubscribed, "the subscribe isn't sent again after it got lost");
+    statusRun(timeMillis, timeMillis + COMS_STATUS_SNAPSHOT_INTERVAL - 100);
+    timeMillis += COMS_STATUS_SNAPSHOT_INTERVAL - 100;
+    if (StatusPolls != 0 || StatusSubscribes != 0)
+    {
+        printf("FAIL: %d polls and %d subscribes while subscribed\n", StatusPolls, StatusSubscribes);
+        StatusFailures++;
+    }
+
+    // A delta from the current version is applied
+    uint32_t snapshots = comsStats()->statusSnapshots;
+    StatusVersion = 6;
+    StatusArmed = true;
+    statusReplyDelta(5, 6, true);
+    statusRun(timeMillis, timeMillis + 10);
+    timeMillis += 10;
+    statusCheck(comsStats()->statusDeltas == 1 && StatusStatus.isSoftwareArmed, "delta from the current version not applied");
+
+    // A delta from another version (6 to 7 was missed) asks for the full status, the deltas until it comes are dropped
+    StatusHoldReplies = true;
+    StatusVersion = 8;
+    StatusArmed = false;
+    statusReplyDelta(7, 8, false);
+    statusRun(timeMillis, timeMillis + 10);
+    timeMillis += 10;
+    statusCheck(comsStats()->statusResyncs == 1, "delta from another version not counted as a resync");
+    statusCheck(StatusHeldReplies == 1, "full status not asked for again after a missed delta");
+    statusCheck(StatusStatus.isSoftwareArmed, "delta from another version applied");
+
+    StatusVersion = 9;
+    StatusArmed = true;
+    statusReplyDelta(8, 9, true);
+    statusRun(timeMillis, timeMillis + 10);
+    timeMillis += 10;
+    statusCheck(comsStats()->statusDeltas == 1 && comsStats()->statusResyncs == 1, "delta applied before the resync");
+
+    StatusHoldReplies = false;
+    StatusVersion = 10;
+    StatusArmed = false;
+    statusReplySnapshot();
+    uint32_t lastSnapshotMillis = timeMillis;
+    statusRun(timeMillis, timeMillis + 10);
+    timeMillis += 10;
+    statusCheck(comsStats()->statusSnapshots == snapshots + 1 && !StatusStatus.isSoftwareArmed, "resync not applied");
+
+    StatusVersion = 11;
+    StatusArmed = true;
+    statusReplyDelta(10, 11, true);
+    statusRun(timeMillis, timeMillis + 10);
+    timeMillis += 10;
+    statusCheck(comsStats()->statusDeltas == 2 && StatusStatus.isSoftwareArmed, "delta after the resync not applied");
+    statusCheck(StatusPolls == 0 && StatusSubscribes == 0, "status requested while subscribed");
+
+    // The aggregator restarts and stops pushing, the status is polled again once the full status is overdue
+    StatusSubscribed = false;
+    StatusSubscribeLost = true;
+    statusRun(timeMillis, lastSnapshotMillis + COMS_STATUS_SNAPSHOT_TIMEOUT);
+    timeMillis = lastSnapshotMillis + COMS_STATUS_SNAPSHOT_TIMEOUT;
+    statusCheck(StatusPolls == 0 && StatusSubscribes == 0, "status requested before the full status was overdue");
+    statusRun(timeMillis, timeMillis + 1000);
+    timeMillis += 1000;
+    statusCheck(StatusSubscribes >= 1, "not subscribed again after the full status stopped coming");
+    statusCheck(StatusPolls >= (int)(1000 / COMS_STATUS_REQUEST_INTERVAL), "not polling after the full status stopped coming");
+
+    if (comsAggregatorBadFrames() > 0)
+    {
+        StatusFailures++;
+    }
+    if (StatusFailures > 0)
+    {
+        printf("%d failures\n", StatusFailures);
+        return 1;
+    }
+    return 0;
+}
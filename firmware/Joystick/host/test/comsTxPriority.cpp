@@ -0,0 +1,290 @@
+// Transmit priorities of the aggregator link
+// First the sticks keep moving over a link so slow that propulsion is always due when it frees up: pings and status requests
+// must go ahead of propulsion once they waited COMS_TX_MAX_QUEUE_MICROS, and the queue times of their classes must match
+// the ones seen on the wire. Then a frame is held up while everything queues behind it and ages: an abort and the commands
+// must still go first, then the aged requests the oldest first, then propulsion
+
+#include "coms.h"
+#include "comsAggregator.h"
+#include <stdio.h>
+#include <vector>
+
+// The slow link takes a byte every 4ms
+const uint32_t TX_PRIORITY_BYTE_MILLIS = 4;
+const uint32_t TX_PRIORITY_SATURATED_MILLIS = 5000;
+const uint32_t TX_PRIORITY_HOLD_MILLIS = 80;
+
+// The requests with a fixed interval, due that long after they were last sent
+enum TxPriorityTimed
+{
+    TX_PRIORITY_PING,
+    TX_PRIORITY_SUBSCRIBE,
+    TX_PRIORITY_POLL,
+    TX_PRIORITY_TIMED_COUNT,
+};
+
+const pb_size_t TX_PRIORITY_TIMED_TAGS[TX_PRIORITY_TIMED_COUNT] =
+{
+    JoystickMessage_get_ping_tag,
+    JoystickMessage_subscribe_system_status_tag,
+    JoystickMessage_get_system_status_tag,
+};
+
+const uint32_t TX_PRIORITY_TIMED_INTERVALS[TX_PRIORITY_TIMED_COUNT] =
+{
+    COMS_PING_INTERVAL,
+    COMS_SUBSCRIBE_RETRY_INTERVAL,
+    COMS_STATUS_REQUEST_INTERVAL,
+};
+
+const ComsTxClass TX_PRIORITY_TIMED_CLASSES[TX_PRIORITY_TIMED_COUNT] =
+{
+    COMS_TX_CLASS_PING,
+    COMS_TX_CLASS_STATUS,
+    COMS_TX_CLASS_STATUS,
+};
+
+SystemStatus_t TxPriorityStatus = {};
+int TxPriorityFailures = 0;
+
+// The frames started by comsSendRequests(), in order, and when
+std::vector<uint32_t> TxPriorityStartMillis;
+std::vector<pb_size_t> TxPriorityTags;
+
+uint32_t txPrioritySent()
+{
+    uint32_t sent = 0;
+    for (const ComsTxClassStats_t &txClass : comsStats()->txClasses)
+    {
+        sent += txClass.sent;
+    }
+    return sent;
+}
+
+// Takes the frames the joystick finished writing, pings are answered right away so the connection stays up
+void txPriorityTakeFrames()
+{
+    JoystickMessage message;
+    while (comsAggregatorNextMessage(&message))
+    {
+        TxPriorityTags.push_back(message.which_message);
+        if (message.which_message == JoystickMessage_get_ping_tag)
+        {
+            JoystickReplyMessage reply = JoystickReplyMessage_init_zero;
+            reply.which_message = JoystickReplyMessage_ping_reply_tag;
+            reply.message.ping_reply.iteration = message.message.get_ping.iteration;
+            comsAggregatorReply(&reply);
+        }
+    }
+}
+
+// One millisecond of the main loop
+void txPriorityStep(uint32_t timeMillis)
+{
+    comsUpdate(&TxPriorityStatus, timeMillis, timeMillis * 1000);
+    uint32_t sent = txPrioritySent();
+    comsSendRequests(&TxPriorityStatus, timeMillis, timeMillis * 1000);
+    if (txPrioritySent() != sent)
+    {
+        TxPriorityStartMillis.push_back(timeMillis);
+    }
+    txPriorityTakeFrames();
+}
+
+void txPriorityStart()
+{
+    TxPriorityStatus = {};
+    TxPriorityStatus.isConnected = true;
+    TxPriorityStartMillis.clear();
+    TxPriorityTags.clear();
+    comsAggregatorReset();
+    comsInit(&ComsAggregatorPort);
+}
+
+void txPriorityCheckSaturated(uint32_t startMillis)
+{
+    txPriorityStart();
+    for (uint32_t timeMillis = startMillis; timeMillis < startMillis + TX_PRIORITY_SATURATED_MILLIS; timeMillis++)
+    {
+        if (timeMillis % TX_PRIORITY_BYTE_MILLIS == 0)
+        {
+            ComsAggregatorRoom = 1;
+        }
+        TxPriorityStatus.propulsionUpdateRequested = true;
+        TxPriorityStatus.propulsionUpdateCount++;
+        txPriorityStep(timeMillis);
+    }
+
+    // The frame still being written goes out, nothing more is sent
+    ComsAggregatorRoom = -1;
+    comsUpdate(&TxPriorityStatus, startMillis + TX_PRIORITY_SATURATED_MILLIS, (startMillis + TX_PRIORITY_SATURATED_MILLIS) * 1000);
+    txPriorityTakeFrames();
+
+    // Replay the frames against when each timed request became due (they were last sent before the start)
+    uint32_t lastSentMillis[TX_PRIORITY_TIMED_COUNT] = {};
+    ComsTxClassStats_t expected[COMS_TX_CLASS_COUNT] = {};
+    int propulsionAhead = 0;
+    for (size_t i = 0; i < TxPriorityTags.size(); i++)
+    {
+        uint32_t timeMillis = TxPriorityStartMillis[i];
+        for (int timed = 0; timed < TX_PRIORITY_TIMED_COUNT; timed++)
+        {
+            uint32_t dueMillis = lastSentMillis[timed] + TX_PRIORITY_TIMED_INTERVALS[timed];
+            if (dueMillis < startMillis)
+            {
+                dueMillis = startMillis;
+            }
+            uint32_t queueMicros = (timeMillis - dueMillis) * 1000;
+
+            if (TxPriorityTags[i] == TX_PRIORITY_TIMED_TAGS[timed])
+            {
+                ComsTxClassStats_t *txClass = &expected[TX_PRIORITY_TIMED_CLASSES[timed]];
+                txClass->sent++;
+                txClass->totalQueueMicros += queueMicros;
+                txClass->maxQueueMicros = queueMicros > txClass->maxQueueMicros ? queueMicros : txClass->maxQueueMicros;
+                txClass->aged += queueMicros >= COMS_TX_MAX_QUEUE_MICROS;
+                lastSentMillis[timed] = timeMillis;
+            }
+            else if (TxPriorityTags[i] == JoystickMessage_set_propulsion_tag && dueMillis <= timeMillis
+                && queueMicros >= COMS_TX_MAX_QUEUE_MICROS)
+            {
+                if (propulsionAhead++ == 0)
+                {
+                    printf("FAIL: propulsion sent at %ums ahead of message %d, due since %ums\n", timeMillis,
+                        TX_PRIORITY_TIMED_TAGS[timed], dueMillis);
+                }
+            }
+        }
+    }
+    if (propulsionAhead > 0)
+    {
+        printf("FAIL: propulsion went ahead of an aged request %d times\n", propulsionAhead);
+        TxPriorityFailures++;
+    }
+
+    ComsStats_t *stats = comsStats();
+    const char *names[COMS_TX_CLASS_COUNT] = { "abort", "command", "propulsion", "ping", "status" };
+    for (int txClass = 0; txClass < COMS_TX_CLASS_COUNT; txClass++)
+    {
+        const ComsTxClassStats_t *actual = &stats->txClasses[txClass];
+        printf("Saturated %-10s %4u sent, %3u aged, max queue %6uus\n", names[txClass], actual->sent, actual->aged,
+            actual->maxQueueMicros);
+    }
+    for (ComsTxClass txClass : { COMS_TX_CLASS_PING, COMS_TX_CLASS_STATUS })
+    {
+        const ComsTxClassStats_t *actual = &stats->txClasses[txClass];
+        const ComsTxClassStats_t *wanted = &expected[txClass];
+        if (actual->sent != wanted->sent || actual->totalQueueMicros != wanted->totalQueueMicros
+            || actual->maxQueueMicros != wanted->maxQueueMicros || actual->aged != wanted->aged)
+        {
+            printf("FAIL: %s counted %u sent, %u aged, %uus total and %uus max queue, the wire shows %u, %u, %uus and %uus\n",
+                names[txClass], actual->sent, actual->aged, actual->totalQueueMicros, actual->maxQueueMicros, wanted->sent,
+                wanted->aged, wanted->totalQueueMicros, wanted->maxQueueMicros);
+            TxPriorityFailures++;
+        }
+    }
+
+    // The link has to be saturated for this to show anything
+    if (stats->txClasses[COMS_TX_CLASS_PING].aged == 0 || stats->txClasses[COMS_TX_CLASS_PROPULSION].sent == 0)
+    {
+        printf("FAIL: the slow link didn't hold pings up behind propulsion\n");
+        TxPriorityFailures++;
+    }
+}
+
+void txPriorityCheckHeldUp(uint32_t startMillis)
+{
+    txPriorityStart();
+
+    // The first frame (propulsion) is stuck on the port while everything else queues up behind it and ages
+    ComsAggregatorRoom = 0;
+    TxPriorityStatus.propulsionUpdateRequested = true;
+    TxPriorityStatus.propulsionUpdateCount++;
+    uint32_t timeMillis = startMillis;
+    for (; timeMillis < startMillis + TX_PRIORITY_HOLD_MILLIS; timeMillis++)
+    {
+        txPriorityStep(timeMillis);
+        TxPriorityStatus.propulsionUpdateRequested = true;
+        TxPriorityStatus.propulsionUpdateCount++;
+    }
+
+    // Then an abort and the commands, the link frees up
+    TxPriorityStatus.sequenceAbortRequested = true;
+    TxPriorityStatus.sequenceTriggerRequested = true;
+    TxPriorityStatus.softwareArmUpdateRequested = true;
+    TxPriorityStatus.visualTestUpdateRequested = true;
+    ComsAggregatorRoom = -1;
+    for (int i = 0; i < 10; i++)
+    {
+        txPriorityStep(timeMillis);
+    }
+
+    const pb_size_t expected[] =
+    {
+        JoystickMessage_set_propulsion_tag, // Held up
+        JoystickMessage_abort_sequence_tag,
+        JoystickMessage_trigger_sequence_tag,
+        JoystickMessage_set_system_armed_tag,
+        JoystickMessage_set_visual_test_tag,
+        JoystickMessage_get_ping_tag, // Aged, all queued at the start so in priority order
+        JoystickMessage_subscribe_system_status_tag,
+        JoystickMessage_get_system_status_tag,
+        JoystickMessage_set_propulsion_tag,
+    };
+    const int expectedCount = sizeof(expected) / sizeof(expected[0]);
+    bool same = TxPriorityTags.size() == expectedCount;
+    for (int i = 0; same && i < expectedCount; i++)
+    {
+        same = TxPriorityTags[i] == expected[i];
+    }
+    if (!same)
+    {
+        printf("FAIL: held up requests sent in the order");
+        for (pb_size_t tag : TxPriorityTags)
+        {
+            printf(" %d", tag);
+        }
+        printf(", expected");
+        for (pb_size_t tag : expected)
+        {
+            printf(" %d", tag);
+        }
+        printf("\n");
+        TxPriorityFailures++;
+    }
+
+    // The aged ones waited the whole hold, the abort and the commands didn't wait
+    ComsStats_t *stats = comsStats();
+    const ComsTxClassStats_t *ping = &stats->txClasses[COMS_TX_CLASS_PING];
+    const ComsTxClassStats_t *status = &stats->txClasses[COMS_TX_CLASS_STATUS];
+    const ComsTxClassStats_t *abort = &stats->txClasses[COMS_TX_CLASS_ABORT];
+    const ComsTxClassStats_t *command = &stats->txClasses[COMS_TX_CLASS_COMMAND];
+    uint32_t holdMicros = TX_PRIORITY_HOLD_MILLIS * 1000;
+    if (ping->sent != 1 || ping->aged != 1 || ping->maxQueueMicros != holdMicros || status->sent != 2 || status->aged != 2
+        || status->maxQueueMicros != holdMicros || abort->sent != 1 || abort->maxQueueMicros != 0 || abort->aged != 0
+        || command->sent != 3 || command->maxQueueMicros != 0 || command->aged != 0)
+    {
+        printf("FAIL: held up queue times: ping %u/%u/%uus, status %u/%u/%uus, abort %u/%u/%uus, commands %u/%u/%uus"
+            " (sent/aged/max)\n", ping->sent, ping->aged, ping->maxQueueMicros, status->sent, status->aged,
+            status->maxQueueMicros, abort->sent, abort->aged, abort->maxQueueMicros, command->sent, command->aged,
+            command->maxQueueMicros);
+        TxPriorityFailures++;
+    }
+}
+
+int main()
+{
+    txPriorityCheckSaturated(10000);
+    txPriorityCheckHeldUp(20000);
+
+    if (comsAggregatorBadFrames() > 0)
+    {
+        TxPriorityFailures++;
+    }
+    if (TxPriorityFailures > 0)
+    {
+        printf("%d failures\n", TxPriorityFailures);
+        return 1;
+    }
+    return 0;
+}
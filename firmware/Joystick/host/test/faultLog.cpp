@@ -0,0 +1,227 @@
+// Fault history in fixed memory
+// Adds more faults than there are entries, fills the string pool with short texts and then 254 byte ones so it has to be
+// compacted and the oldest entries dropped, alternates faults so they collapse into their entries and shares a text
+// between the two sources, then checks a long run of random faults against a plain model of the history
+
+#include "faultLog.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string>
+#include <vector>
+
+// An entry of the model, the newest first
+struct FaultLogModelEntry_t
+{
+    FaultLogSource source;
+    std::string text;
+    uint16_t repeatCount;
+    uint32_t firstMillis;
+    uint32_t lastMillis;
+};
+
+const int FAULT_LOG_RANDOM_ADDS = 5000;
+
+std::vector<FaultLogModelEntry_t> FaultLogModel;
+uint32_t FaultLogModelTotal = 0;
+int FaultLogFailures = 0;
+
+// The pool bytes the texts of the model take once compacted
+int faultLogModelPoolUsed()
+{
+    std::vector<std::string> texts;
+    int used = 0;
+    for (const FaultLogModelEntry_t &entry : FaultLogModel)
+    {
+        bool stored = false;
+        for (const std::string &text : texts)
+        {
+            stored = stored || text == entry.text;
+        }
+        if (!stored)
+        {
+            texts.push_back(entry.text);
+            used += entry.text.size() + 1;
+        }
+    }
+    return used;
+}
+
+void faultLogModelAdd(FaultLogSource source, const std::string &fullText, uint32_t timeMillis)
+{
+    std::string text = fullText.substr(0, FAULT_LOG_MAX_LENGTH);
+    FaultLogModelTotal++;
+    for (size_t i = 0; i < FaultLogModel.size(); i++)
+    {
+        if (FaultLogModel[i].source == source && FaultLogModel[i].text == text)
+        {
+            FaultLogModelEntry_t entry = FaultLogModel[i];
+            FaultLogModel.erase(FaultLogModel.begin() + i);
+            if (entry.repeatCount < UINT16_MAX)
+            {
+                entry.repeatCount++;
+            }
+            entry.lastMillis = timeMillis;
+            FaultLogModel.insert(FaultLogModel.begin(), entry);
+            return;
+        }
+    }
+
+    if (FaultLogModel.size() == FAULT_LOG_ENTRY_COUNT)
+    {
+        FaultLogModel.pop_back();
+    }
+    bool shared = false;
+    for (const FaultLogModelEntry_t &entry : FaultLogModel)
+    {
+        shared = shared || entry.text == text;
+    }
+    while (!shared && !FaultLogModel.empty() && faultLogModelPoolUsed() + (int)text.size() + 1 > FAULT_LOG_POOL_SIZE)
+    {
+        FaultLogModel.pop_back();
+    }
+    FaultLogModel.insert(FaultLogModel.begin(), { source, text, 1, timeMillis, timeMillis });
+}
+
+void faultLogBothAdd(FaultLogSource source, const std::string &text, uint32_t timeMillis)
+{
+    faultLogAdd(source, text.c_str(), timeMillis);
+    faultLogModelAdd(source, text, timeMillis);
+}
+
+void faultLogBothClear()
+{
+    faultLogClear();
+    FaultLogModel.clear();
+}
+
+// Returns false if the history doesn't match the model
+bool faultLogCheck(const char *what)
+{
+    if (faultLogCount() != (int)FaultLogModel.size())
+    {
+        printf("FAIL: %s: %d entries, expected %zu\n", what, faultLogCount(), FaultLogModel.size());
+        FaultLogFailures++;
+        return false;
+    }
+    for (int index = 0; index < faultLogCount(); index++)
+    {
+        const FaultLogEntry_t *entry = faultLogGet(index);
+        const FaultLogModelEntry_t *expected = &FaultLogModel[index];
+        int length;
+        const char *text = faultLogText(entry, &length);
+        if (entry->source != expected->source || length != (int)expected->text.size() || expected->text != text
+            || entry->repeatCount != expected->repeatCount || entry->firstMillis != expected->firstMillis
+            || entry->lastMillis != expected->lastMillis)
+        {
+            printf("FAIL: %s: entry %d is %d \"%.20s\" (%d bytes) x%u, expected %d \"%.20s\" (%zu bytes) x%u\n", what, index,
+                entry->source, text, length, entry->repeatCount, expected->source, expected->text.c_str(),
+                expected->text.size(), expected->repeatCount);
+            FaultLogFailures++;
+            return false;
+        }
+    }
+    return true;
+}
+
+std::string faultLogNumbered(const char *prefix, int number, int length)
+{
+    std::string text = prefix + std::to_string(number);
+    text.resize(length, '.');
+    return text;
+}
+
+int main()
+{
+    // More faults than entries, the oldest are dropped
+    faultLogBothClear();
+    uint32_t totalBefore = faultLogTotal();
+    for (int i = 0; i < FAULT_LOG_ENTRY_COUNT + 4; i++)
+    {
+        faultLogBothAdd(FAULT_SOURCE_AGGREGATOR, "Fault " + std::to_string(i), 1000 + i);
+    }
+    faultLogCheck("more faults than entries");
+    if (faultLogTotal() - totalBefore != FAULT_LOG_ENTRY_COUNT + 4)
+    {
+        printf("FAIL: %u faults counted, %d were added\n", faultLogTotal() - totalBefore, FAULT_LOG_ENTRY_COUNT + 4);
+        FaultLogFailures++;
+    }
+
+    // A pool full of 30 byte texts only has room for the next one once the text of the entry it replaces is compacted away
+    faultLogBothClear();
+    for (int i = 0; i < FAULT_LOG_ENTRY_COUNT + 1; i++)
+    {
+        faultLogBothAdd(FAULT_SOURCE_LINK, faultLogNumbered("Short ", i, 30), 2000 + i);
+    }
+    faultLogCheck("compaction");
+    if (faultLogCount() != FAULT_LOG_ENTRY_COUNT)
+    {
+        printf("FAIL: compacting the pool dropped entries, %d left\n", faultLogCount());
+        FaultLogFailures++;
+    }
+
+    // The longest texts, the oldest entries are dropped until they fit
+    for (int i = 0; i < 4; i++)
+    {
+        faultLogBothAdd(FAULT_SOURCE_AGGREGATOR, faultLogNumbered("Long ", i, 300), 3000 + i);
+        faultLogCheck("254 byte texts");
+    }
+    int length;
+    faultLogText(faultLogGet(0), &length);
+    printf("254 byte texts: %d entries left, the newest is %d bytes long\n", faultLogCount(), length);
+    if (faultLogCount() != FAULT_LOG_POOL_SIZE / (FAULT_LOG_MAX_LENGTH + 1))
+    {
+        printf("FAIL: %d entries of 254 byte texts in a %d byte pool\n", faultLogCount(), FAULT_LOG_POOL_SIZE);
+        FaultLogFailures++;
+    }
+
+    // Faults that alternate collapse into their entries
+    faultLogBothClear();
+    faultLogBothAdd(FAULT_SOURCE_AGGREGATOR, "Ignitor 2 not responding", 4000);
+    faultLogBothAdd(FAULT_SOURCE_AGGREGATOR, "Sequencer disconnected", 4001);
+    faultLogBothAdd(FAULT_SOURCE_AGGREGATOR, "Ignitor 2 not responding", 4002);
+    faultLogBothAdd(FAULT_SOURCE_AGGREGATOR, "Sequencer disconnected", 4003);
+    faultLogBothAdd(FAULT_SOURCE_AGGREGATOR, "Ignitor 2 not responding", 4004);
+    faultLogCheck("alternating faults");
+    if (faultLogCount() != 2 || faultLogGet(0)->repeatCount != 3 || faultLogGet(1)->repeatCount != 2)
+    {
+        printf("FAIL: A/B/A/B/A didn't collapse into two entries repeated 3 and 2 times\n");
+        FaultLogFailures++;
+    }
+
+    // The same text from both sources is two entries that share the text
+    faultLogBothAdd(FAULT_SOURCE_LINK, "Sequencer disconnected", 4005);
+    faultLogCheck("shared text");
+    const FaultLogEntry_t *link = faultLogGet(0);
+    const FaultLogEntry_t *aggregator = faultLogGet(2);
+    int linkLength;
+    int aggregatorLength;
+    if (faultLogCount() != 3 || link->text != aggregator->text
+        || faultLogText(link, &linkLength) != faultLogText(aggregator, &aggregatorLength))
+    {
+        printf("FAIL: the same text from the link and the aggregator isn't stored once\n");
+        FaultLogFailures++;
+    }
+
+    // Random faults of every length from a few texts, so they repeat, share texts, compact and drop
+    faultLogBothClear();
+    srand(1);
+    for (int i = 0; i < FAULT_LOG_RANDOM_ADDS; i++)
+    {
+        int number = rand() % 24;
+        int textLength = number == 0 ? 0 : 1 + (number * 37) % 300;
+        FaultLogSource source = rand() % 4 == 0 ? FAULT_SOURCE_LINK : FAULT_SOURCE_AGGREGATOR;
+        faultLogBothAdd(source, faultLogNumbered("", number, textLength), 5000 + i);
+        if (!faultLogCheck("random faults"))
+        {
+            printf("After %d random faults\n", i + 1);
+            break;
+        }
+    }
+
+    if (FaultLogFailures > 0)
+    {
+        printf("%d failures\n", FaultLogFailures);
+        return 1;
+    }
+    return 0;
+}
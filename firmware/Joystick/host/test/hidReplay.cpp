@@ -0,0 +1,246 @@
+// Capture and replay of joystick reports
+// Plays a scripted session on two joysticks with the capture on, takes the capture records back out of the log, then
+// replays them with joystickHidBeginReplay() and checks the replay queues the same presses and releases at the same times
+// Records are then dropped from the middle of the capture the way the log drops them, and every report that is kept
+// (each joystick from its next keyframe on, as the log decoder does) must decode to what was captured
+
+#include "shim.h"
+#include "joystickHid.h"
+#include "hidCapture.h"
+#include "logger.h"
+#include <math.h>
+#include <vector>
+
+const uint32_t HID_REPLAY_STEP_MICROS = 1000;
+const int HID_REPLAY_STEPS = 1500;
+const int HID_REPLAY_DEVICES = 2;
+
+// The capture records lost from the middle of the capture
+const int HID_REPLAY_FIRST_DROPPED = 400;
+const int HID_REPLAY_DROPPED_COUNT = 300;
+
+struct HidReplayEdge_t
+{
+    JoystickEventType type;
+    uint32_t button;
+    uint8_t dpad;
+    uint32_t timeMicros; // Relative to the start of the session
+};
+
+JoystickHidData_t JoystickHidData;
+JoystickHidChanges_t JoystickHidChanges;
+int HidReplayFailures = 0;
+
+// The joystick reports of the session, every step
+void hidReplayScript(int step, int device, uint32_t *buttons, uint8_t *axes)
+{
+    *buttons = 0;
+    if (device == 0)
+    {
+        // Short taps, a long press held through the dropped records and a d-pad sweep
+        if (step % 90 < 20)
+        {
+            *buttons |= BUTTON_2;
+        }
+        if (step >= 300 && step < 900)
+        {
+            *buttons |= BUTTON_L_TRIGGER;
+        }
+        axes[AXIS_DPAD] = step >= 1000 && step < 1200 ? (step / 25) % 8 : DPAD_CENTER;
+    }
+    else
+    {
+        if (step % 130 >= 60 && step % 130 < 75)
+        {
+            *buttons |= BUTTON_3;
+        }
+    }
+    axes[AXIS_LEFT_STICK_X] = step < HID_REPLAY_STEPS - 50 ? (uint8_t)(128 + 100 * sin(step * 0.01 + device)) : AXIS_STICK_CENTER;
+    axes[AXIS_LEFT_STICK_Y] = AXIS_STICK_CENTER;
+    axes[AXIS_RIGHT_STICK_X] = AXIS_STICK_CENTER;
+    axes[AXIS_RIGHT_STICK_Y] = step < HID_REPLAY_STEPS - 50 ? (uint8_t)(128 + 60 * cos(step * 0.02)) : AXIS_STICK_CENTER;
+}
+
+// Takes the presses and releases queued since the last call, holds depend on when updates run so they are left out
+void hidReplayTakeEdges(std::vector<HidReplayEdge_t> *edges, uint32_t startMicros)
+{
+    JoystickEvent_t event;
+    while (joystickHidNextEvent(&event))
+    {
+        if (event.type != JOYSTICK_EVENT_HOLD)
+        {
+            edges->push_back({ event.type, event.button, event.dpad, event.timeMicros - startMicros });
+        }
+    }
+}
+
+// Splits the LOG_HID_CAPTURE records of the log back into capture records
+// Nothing else may be logged while capturing
+std::vector<std::vector<uint8_t>> hidReplayReadLog(const std::vector<uint8_t> &log)
+{
+    std::vector<std::vector<uint8_t>> records;
+    size_t position = 0;
+    while (position < log.size())
+    {
+        if (log.size() - position < 7 || log[position] != LOG_RECORD_START || log[position + 1] != LOG_HID_CAPTURE)
+        {
+            printf("FAIL: unexpected log record at byte %zu\n", position);
+            HidReplayFailures++;
+            break;
+        }
+        uint8_t length = log[position + 6];
+        records.emplace_back(log.begin() + position + 7, log.begin() + position + 7 + length);
+        position += 7 + length;
+    }
+    return records;
+}
+
+void hidReplayCompareEdges(const std::vector<HidReplayEdge_t> &captured, const std::vector<HidReplayEdge_t> &replayed)
+{
+    if (captured.size() != replayed.size())
+    {
+        printf("FAIL: %zu edges were captured but %zu replayed\n", captured.size(), replayed.size());
+        HidReplayFailures++;
+        return;
+    }
+    for (size_t i = 0; i < captured.size(); i++)
+    {
+        const HidReplayEdge_t *a = &captured[i];
+        const HidReplayEdge_t *b = &replayed[i];
+        if (a->type != b->type || a->button != b->button || a->dpad != b->dpad || a->timeMicros != b->timeMicros)
+        {
+            printf("FAIL: edge %zu was %d %x/%d at %uus, replayed as %d %x/%d at %uus\n", i, a->type, a->button, a->dpad,
+                a->timeMicros, b->type, b->button, b->dpad, b->timeMicros);
+            HidReplayFailures++;
+            return;
+        }
+    }
+}
+
+// Drops records from the middle of the capture, then skips each device's records until its next keyframe
+// Every record that is kept has to decode to the same report as it did from the whole capture
+void hidReplayCheckDroppedRecords(const std::vector<std::vector<uint8_t>> &records)
+{
+    HidCaptureState_t wholeState;
+    HidCaptureState_t lossyState;
+    hidCaptureReset(&wholeState);
+    hidCaptureReset(&lossyState);
+
+    bool synced[HID_CAPTURE_MAX_DEVICES] = {};
+    int keyframes = 0;
+    int kept = 0;
+    for (size_t i = 0; i < records.size(); i++)
+    {
+        const std::vector<uint8_t> &record = records[i];
+        HidCaptureReport_t wholeReport;
+        if (hidCaptureDecode(&wholeState, record.data(), record.size(), &wholeReport) != (int)record.size())
+        {
+            printf("FAIL: capture record %zu doesn't decode\n", i);
+            HidReplayFailures++;
+            return;
+        }
+
+        if (i >= HID_REPLAY_FIRST_DROPPED && i < HID_REPLAY_FIRST_DROPPED + HID_REPLAY_DROPPED_COUNT)
+        {
+            memset(synced, 0, sizeof(synced));
+            continue;
+        }
+        uint8_t device = hidCaptureDevice(record.data());
+        if (hidCaptureIsKeyframe(record.data()))
+        {
+            synced[device] = true;
+            keyframes++;
+        }
+        if (!synced[device])
+        {
+            continue;
+        }
+
+        HidCaptureReport_t lossyReport;
+        hidCaptureDecode(&lossyState, record.data(), record.size(), &lossyReport);
+        kept++;
+        if (lossyReport.timeMicros != wholeReport.timeMicros || lossyReport.buttons != wholeReport.buttons
+            || memcmp(lossyReport.axis, wholeReport.axis, sizeof(lossyReport.axis)) != 0)
+        {
+            printf("FAIL: capture record %zu decodes differently after dropped records\n", i);
+            HidReplayFailures++;
+            return;
+        }
+    }
+    int keptAfterDropped = kept - HID_REPLAY_FIRST_DROPPED;
+    printf("%zu capture records, %d keyframes, %d of the %zu after the dropped records kept\n", records.size(), keyframes,
+        keptAfterDropped, records.size() - HID_REPLAY_FIRST_DROPPED - HID_REPLAY_DROPPED_COUNT);
+    if (keptAfterDropped <= 0)
+    {
+        printf("FAIL: no keyframe after the dropped records\n");
+        HidReplayFailures++;
+    }
+}
+
+int main()
+{
+    shimSetMicros(1000000);
+    for (int device = 0; device < HID_REPLAY_DEVICES; device++)
+    {
+        shimJoystickConnect(device, true);
+    }
+    joystickHidInit();
+    joystickHidUpdate(&JoystickHidData, &JoystickHidChanges);
+    std::vector<HidReplayEdge_t> connectEdges;
+    hidReplayTakeEdges(&connectEdges, 0);
+
+    // Only the capture goes to the log from here on, and the serial port takes all of it
+    Serial.writeRoom = 1 << 20;
+    logDrain();
+    Serial.written.clear();
+
+    // Play the session with the capture on
+    std::vector<HidReplayEdge_t> captured;
+    uint32_t captureStartMicros = micros();
+    joystickHidSetCapture(true);
+    for (int step = 0; step < HID_REPLAY_STEPS; step++)
+    {
+        for (int device = 0; device < HID_REPLAY_DEVICES; device++)
+        {
+            uint32_t buttons;
+            uint8_t axes[JOYSTICK_AXIS_COUNT];
+            hidReplayScript(step, device, &buttons, axes);
+            shimJoystickReport(device, buttons, axes);
+        }
+        joystickHidUpdate(&JoystickHidData, &JoystickHidChanges);
+        hidReplayTakeEdges(&captured, captureStartMicros);
+        logDrain();
+        shimAdvanceMicros(HID_REPLAY_STEP_MICROS);
+    }
+    joystickHidSetCapture(false);
+
+    std::vector<std::vector<uint8_t>> records = hidReplayReadLog(Serial.written);
+    std::vector<uint8_t> capture;
+    for (const std::vector<uint8_t> &record : records)
+    {
+        capture.insert(capture.end(), record.begin(), record.end());
+    }
+
+    // Replay it in real time on the same update period
+    shimAdvanceMicros(1000000);
+    std::vector<HidReplayEdge_t> replayed;
+    uint32_t replayStartMicros = micros();
+    joystickHidBeginReplay(capture.data(), capture.size(), JOYSTICK_REPLAY_REALTIME);
+    while (joystickHidIsReplaying())
+    {
+        joystickHidUpdate(&JoystickHidData, &JoystickHidChanges);
+        hidReplayTakeEdges(&replayed, replayStartMicros);
+        shimAdvanceMicros(HID_REPLAY_STEP_MICROS);
+    }
+
+    printf("%zu edges captured, %zu replayed, capture %zu bytes\n", captured.size(), replayed.size(), capture.size());
+    hidReplayCompareEdges(captured, replayed);
+    hidReplayCheckDroppedRecords(records);
+
+    if (HidReplayFailures > 0)
+    {
+        printf("%d failures\n", HidReplayFailures);
+        return 1;
+    }
+    return 0;
+}
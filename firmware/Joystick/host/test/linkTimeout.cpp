@@ -0,0 +1,99 @@
+// Adaptive ping timeout of the aggregator link
+// Pings every COMS_PING_INTERVAL (100ms) over a link whose round trip steps up from 5ms to well past the timeout the
+// fast link settled on, the timeout has to back off and follow the new round trip without the connection being lost
+
+#include "linkStats.h"
+#include <stdio.h>
+
+const uint32_t LINK_TIMEOUT_PING_INTERVAL_MICROS = 100000;
+const uint32_t LINK_TIMEOUT_STEP_MICROS = 1000;
+
+struct LinkTimeoutPhase_t
+{
+    uint32_t rttMicros;
+    uint32_t durationMicros;
+};
+
+const LinkTimeoutPhase_t LINK_TIMEOUT_PHASES[] =
+{
+    { 5000, 3000000 },
+    { 35000, 3000000 },
+    { 150000, 3000000 },
+    { 5000, 3000000 },
+};
+
+int main()
+{
+    int failures = 0;
+    linkStatsReset();
+
+    uint32_t timeMicros = 0;
+    uint32_t iteration = 0;
+    uint32_t nextPingMicros = 0;
+
+    // Replies waiting to arrive, one per ping in flight at most
+    uint32_t replyIterations[LINK_STATS_MAX_IN_FLIGHT];
+    uint32_t replyMicros[LINK_STATS_MAX_IN_FLIGHT];
+    int replyCount = 0;
+
+    for (const LinkTimeoutPhase_t &phase : LINK_TIMEOUT_PHASES)
+    {
+        uint32_t endMicros = timeMicros + phase.durationMicros;
+        bool connectionLost = false;
+        for (; timeMicros < endMicros; timeMicros += LINK_TIMEOUT_STEP_MICROS)
+        {
+            for (int i = 0; i < replyCount; )
+            {
+                if (timeMicros >= replyMicros[i])
+                {
+                    linkStatsPingReplied(replyIterations[i], timeMicros);
+                    replyIterations[i] = replyIterations[replyCount - 1];
+                    replyMicros[i] = replyMicros[replyCount - 1];
+                    replyCount--;
+                }
+                else
+                {
+                    i++;
+                }
+            }
+
+            if (timeMicros >= nextPingMicros && replyCount < LINK_STATS_MAX_IN_FLIGHT)
+            {
+                iteration++;
+                linkStatsPingSent(iteration, timeMicros);
+                replyIterations[replyCount] = iteration;
+                replyMicros[replyCount] = timeMicros + phase.rttMicros;
+                replyCount++;
+                nextPingMicros = timeMicros + LINK_TIMEOUT_PING_INTERVAL_MICROS;
+            }
+
+            if (linkStatsUpdate(timeMicros))
+            {
+                connectionLost = true;
+                linkStatsClearInFlight();
+            }
+        }
+
+        LinkStats_t stats;
+        linkStatsGet(&stats);
+        printf("RTT %6uus: mean %6uus, timeout %6uus, %u lost, %u late\n", phase.rttMicros, stats.meanRtt, stats.timeout,
+            stats.lost, stats.late);
+        if (connectionLost)
+        {
+            printf("FAIL: the connection was lost with a %uus round trip\n", phase.rttMicros);
+            failures++;
+        }
+        if (stats.timeout <= phase.rttMicros)
+        {
+            printf("FAIL: the timeout settled at %uus, under the %uus round trip\n", stats.timeout, phase.rttMicros);
+            failures++;
+        }
+    }
+
+    if (failures > 0)
+    {
+        printf("%d failures\n", failures);
+        return 1;
+    }
+    return 0;
+}
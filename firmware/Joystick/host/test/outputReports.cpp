@@ -0,0 +1,129 @@
+// Joystick output report coalescing
+// Mashes the buttons of two joysticks for 2s (button feedback LEDs), sets and clears the status LEDs and rumbles them,
+// then prints how many output reports were requested and how many were sent
+// The reports sent must stay within JOYSTICK_OUTPUT_INTERVAL per joystick and JOYSTICK_OUTPUT_BUS_INTERVAL overall,
+// and once the joysticks are left alone nothing more is sent
+
+#include "shim.h"
+#include "joystickHid.h"
+#include "USBHost_t36.h"
+
+extern JoystickController joysticks[];
+
+const int OUTPUT_REPORTS_DEVICES = 2;
+const uint32_t OUTPUT_REPORTS_STEP_MICROS = 1000;
+const int OUTPUT_REPORTS_STEPS = 2000;
+const int OUTPUT_REPORTS_SETTLE_STEPS = 100;
+
+JoystickHidData_t JoystickHidData;
+JoystickHidChanges_t JoystickHidChanges;
+int OutputReportsFailures = 0;
+
+uint32_t outputReportsSent()
+{
+    uint32_t sent = 0;
+    for (int device = 0; device < OUTPUT_REPORTS_DEVICES; device++)
+    {
+        sent += joysticks[device].ledReports + joysticks[device].rumbleReports;
+    }
+    return sent;
+}
+
+void outputReportsStep()
+{
+    joystickHidUpdate(&JoystickHidData, &JoystickHidChanges);
+    JoystickEvent_t event;
+    while (joystickHidNextEvent(&event))
+    {
+    }
+    shimAdvanceMicros(OUTPUT_REPORTS_STEP_MICROS);
+}
+
+int main()
+{
+    shimSetMicros(1000000);
+    for (int device = 0; device < OUTPUT_REPORTS_DEVICES; device++)
+    {
+        shimJoystickConnect(device, true);
+    }
+    joystickHidInit();
+
+    const uint8_t axes[JOYSTICK_AXIS_COUNT] = { AXIS_STICK_CENTER, AXIS_STICK_CENTER, AXIS_STICK_CENTER, AXIS_STICK_CENTER, DPAD_CENTER };
+    const JoystickLeds_t statusLeds = { 255, 0, 0, 15 };
+    for (int step = 0; step < OUTPUT_REPORTS_STEPS; step++)
+    {
+        // The first joystick changes its buttons every 10ms and the second one every 7ms
+        if (step % 10 == 0)
+        {
+            shimJoystickReport(0, (step / 10) % 2 ? (step / 20) % 8 : 0, axes);
+        }
+        if (step % 7 == 0)
+        {
+            shimJoystickReport(1, (step / 7) % 2 ? BUTTON_1 : BUTTON_2, axes);
+        }
+
+        if (step == 500)
+        {
+            joystickHidSetStatusLeds(&statusLeds);
+        }
+        if (step == 502)
+        {
+            joystickHidRumble(-1, 255, 255, 255);
+        }
+        if (step == 1000)
+        {
+            joystickHidSetStatusLeds(NULL);
+        }
+        outputReportsStep();
+    }
+
+    JoystickOutputStats_t stats;
+    joystickHidGetOutputStats(&stats);
+    printf("Joystick outputs: %u requested, %u sent\n", stats.requested, stats.sent);
+    if (stats.sent != outputReportsSent())
+    {
+        printf("FAIL: %u output reports counted as sent, the joysticks got %u\n", stats.sent, outputReportsSent());
+        OutputReportsFailures++;
+    }
+
+    // Rate limits, plus one for the report each limit lets through at the start
+    uint32_t busLimit = OUTPUT_REPORTS_STEPS * OUTPUT_REPORTS_STEP_MICROS / JOYSTICK_OUTPUT_BUS_INTERVAL + 1;
+    uint32_t joystickLimit = OUTPUT_REPORTS_STEPS * OUTPUT_REPORTS_STEP_MICROS / JOYSTICK_OUTPUT_INTERVAL + 1;
+    if (stats.sent > busLimit)
+    {
+        printf("FAIL: %u output reports sent, more than the %u the bus interval allows\n", stats.sent, busLimit);
+        OutputReportsFailures++;
+    }
+    for (int device = 0; device < OUTPUT_REPORTS_DEVICES; device++)
+    {
+        uint32_t sent = joysticks[device].ledReports + joysticks[device].rumbleReports;
+        if (sent > joystickLimit)
+        {
+            printf("FAIL: joystick %d got %u output reports, more than the %u its interval allows\n", device, sent, joystickLimit);
+            OutputReportsFailures++;
+        }
+    }
+
+    // Left alone, the joysticks get what they are still owed and then nothing more
+    for (int step = 0; step < OUTPUT_REPORTS_SETTLE_STEPS; step++)
+    {
+        outputReportsStep();
+    }
+    uint32_t settledSent = outputReportsSent();
+    for (int step = 0; step < OUTPUT_REPORTS_SETTLE_STEPS; step++)
+    {
+        outputReportsStep();
+    }
+    if (outputReportsSent() != settledSent)
+    {
+        printf("FAIL: %u output reports sent to joysticks that were left alone\n", outputReportsSent() - settledSent);
+        OutputReportsFailures++;
+    }
+
+    if (OutputReportsFailures > 0)
+    {
+        printf("%d failures\n", OutputReportsFailures);
+        return 1;
+    }
+    return 0;
+}
@@ -0,0 +1,114 @@
+// Host build of examples/pcdbench
+// Draws the primitives the joystick UX uses (menu top bar, arm code boxes and notification frames) with the page-aligned
+// Adafruit_PCD8544 overrides and with the generic pixel-by-pixel Adafruit_GFX implementations, checks that both draw
+// the same pixels in every rotation, then times them
+// The times are for the host CPU, only the ratio between the two carries over to the Teensy
+
+#include "shim.h"
+#include <Adafruit_GFX.h>
+#include <Adafruit_PCD8544.h>
+#include <chrono>
+
+extern uint8_t pcd8544_buffer[];
+
+const int PCD_BENCH_ITERATIONS = 20000;
+const int PCD_BENCH_ROTATIONS = 4;
+
+// The same display drawn through the generic Adafruit_GFX primitives, which end up in drawPixel() one pixel at a time
+class PixelPCD8544 : public Adafruit_PCD8544
+{
+public:
+    PixelPCD8544(int8_t dcPin, int8_t csPin, int8_t rstPin) : Adafruit_PCD8544(dcPin, csPin, rstPin) {}
+
+    void drawFastVLine(int16_t x, int16_t y, int16_t h, uint16_t color) override { Adafruit_GFX::drawFastVLine(x, y, h, color); }
+    void drawFastHLine(int16_t x, int16_t y, int16_t w, uint16_t color) override { Adafruit_GFX::drawFastHLine(x, y, w, color); }
+    void fillRect(int16_t x, int16_t y, int16_t w, int16_t h, uint16_t color) override { Adafruit_GFX::fillRect(x, y, w, h, color); }
+    void fillScreen(uint16_t color) override { Adafruit_GFX::fillScreen(color); }
+};
+
+Adafruit_PCD8544 Display = Adafruit_PCD8544(5, 4, 3);
+PixelPCD8544 PixelDisplay = PixelPCD8544(5, 4, 3);
+
+struct PcdBenchScene_t
+{
+    const char *name;
+    void (*draw)(Adafruit_PCD8544 *display);
+};
+
+void drawTopBar(Adafruit_PCD8544 *display)
+{
+    display->fillRect(0, 0, 8, 9, BLACK);
+    display->fillTriangle(0, 4, 8, 0, 8, 8, WHITE);
+    display->fillTriangle(83, 4, 75, 0, 75, 8, BLACK);
+    display->drawLine(0, 10, 84, 10, BLACK);
+}
+
+void drawArmCodeBoxes(Adafruit_PCD8544 *display)
+{
+    for (int i = 0; i < 3; i++)
+    {
+        display->fillRect(10 + (18 * i), 23, 9, 11, BLACK);
+    }
+    display->drawRect(64, 23, 9, 11, BLACK);
+}
+
+void drawNotificationFrame(Adafruit_PCD8544 *display)
+{
+    display->drawRoundRect(0, 0, display->width(), display->height(), 5, BLACK);
+}
+
+const PcdBenchScene_t PCD_BENCH_SCENES[] =
+{
+    { "Menu top bar", drawTopBar },
+    { "Arm code boxes", drawArmCodeBoxes },
+    { "Notification frame", drawNotificationFrame },
+};
+
+// Draws a scene from a blank buffer and keeps the result
+void pcdBenchDraw(Adafruit_PCD8544 *display, const PcdBenchScene_t *scene, int rotation, uint8_t *frame)
+{
+    display->setRotation(rotation);
+    memset(pcd8544_buffer, 0, SHIM_LCD_RAM_SIZE);
+    scene->draw(display);
+    memcpy(frame, pcd8544_buffer, SHIM_LCD_RAM_SIZE);
+}
+
+double pcdBenchTime(Adafruit_PCD8544 *display, const PcdBenchScene_t *scene)
+{
+    display->setRotation(0);
+    auto start = std::chrono::steady_clock::now();
+    for (int i = 0; i < PCD_BENCH_ITERATIONS; i++)
+    {
+        scene->draw(display);
+    }
+    return std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - start).count() / PCD_BENCH_ITERATIONS;
+}
+
+int main()
+{
+    Display.begin();
+    PixelDisplay.begin();
+
+    int failures = 0;
+    for (const PcdBenchScene_t &scene : PCD_BENCH_SCENES)
+    {
+        for (int rotation = 0; rotation < PCD_BENCH_ROTATIONS; rotation++)
+        {
+            uint8_t fastFrame[SHIM_LCD_RAM_SIZE];
+            uint8_t pixelFrame[SHIM_LCD_RAM_SIZE];
+            pcdBenchDraw(&Display, &scene, rotation, fastFrame);
+            pcdBenchDraw(&PixelDisplay, &scene, rotation, pixelFrame);
+            if (memcmp(fastFrame, pixelFrame, SHIM_LCD_RAM_SIZE) != 0)
+            {
+                printf("FAIL: %s differs from the pixel path in rotation %d\n", scene.name, rotation);
+                failures++;
+            }
+        }
+
+        double fastMicros = pcdBenchTime(&Display, &scene);
+        double pixelMicros = pcdBenchTime(&PixelDisplay, &scene);
+        printf("%s: page-aligned %.3fus, pixel-by-pixel %.3fus, %.1fx faster\n", scene.name, fastMicros, pixelMicros,
+            pixelMicros / fastMicros);
+    }
+    return failures > 0 ? 1 : 0;
+}
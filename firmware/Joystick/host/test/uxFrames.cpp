@@ -0,0 +1,323 @@
+// Golden frame test of the joystick UX
+// Plays a scripted session through every menu (and the notifications) on the virtual clock, and compares the frames at
+// the checkpoints, as uxWriteFramePbm() exports them, with the images in frames/
+// Every frame is also checked against the display RAM the SPI traffic left behind, and the render time and SPI bytes of
+// every uxUpdate() are reported per menu, uxUpdate() must not allocate
+// Run with --update to write the images of the checkpoints instead, then look them over before committing them
+
+#include "shim.h"
+#include "status.h"
+#include "joystickHid.h"
+#include "faultLog.h"
+#include "ux.h"
+#include <chrono>
+#include <new>
+#include <string>
+
+extern uint8_t pcd8544_buffer[];
+extern int UxLayout;
+extern bool UxFlushPending;
+
+// The UX runs at its refresh rate, one update every step
+const uint32_t UX_FRAMES_STEP_MICROS = 40000;
+
+// Layouts as reported, the menus (see MenuHandlers in ux.cpp) then the notifications
+const int UX_FRAMES_LAYOUT_COUNT = 11;
+const char *UX_FRAMES_LAYOUT_NAMES[UX_FRAMES_LAYOUT_COUNT] =
+{
+    "Status", "Vis. Test", "Sequence", "Joysticks", "Ignition", "Fault", "Arm System", "Calibrate", "Loop", "Latency", "Notification",
+};
+
+struct UxFramesStats_t
+{
+    uint32_t frames;
+    double totalMicros;
+    double maxMicros;
+    uint32_t spiBytes;
+    uint32_t allocations;
+};
+
+SystemStatus_t SystemStatus;
+JoystickHidData_t JoystickHidData;
+JoystickHidChanges_t JoystickHidChanges;
+
+uint8_t UxFramesAxes[JOYSTICK_AXIS_COUNT] = { AXIS_STICK_CENTER, AXIS_STICK_CENTER, AXIS_STICK_CENTER, AXIS_STICK_CENTER, DPAD_CENTER };
+uint32_t UxFramesButtons = 0;
+uint32_t UxFramesStep = 0;
+UxFramesStats_t UxFramesStats[UX_FRAMES_LAYOUT_COUNT];
+bool UxFramesUpdate = false;
+int UxFramesFailures = 0;
+
+// Heap allocations made while counting, every operator new counts
+bool UxFramesCountAllocations = false;
+uint32_t UxFramesAllocations = 0;
+
+// Collects what is printed to it, for the PBM images
+class StringPrint : public Print
+{
+public:
+    size_t write(uint8_t c) override
+    {
+        text.push_back((char)c);
+        return 1;
+    }
+    using Print::write;
+
+    std::string text;
+};
+
+
+void *operator new(size_t size)
+{
+    if (UxFramesCountAllocations)
+    {
+        UxFramesAllocations++;
+    }
+    void *memory = malloc(size > 0 ? size : 1);
+    if (memory == NULL)
+    {
+        throw std::bad_alloc();
+    }
+    return memory;
+}
+
+void *operator new[](size_t size)
+{
+    return operator new(size);
+}
+
+void operator delete(void *memory) noexcept
+{
+    free(memory);
+}
+
+void operator delete[](void *memory) noexcept
+{
+    free(memory);
+}
+
+void operator delete(void *memory, size_t size) noexcept
+{
+    free(memory);
+}
+
+void operator delete[](void *memory, size_t size) noexcept
+{
+    free(memory);
+}
+
+void uxFramesCheckLcd()
+{
+    if (!UxFlushPending && memcmp(shimLcdRam(), pcd8544_buffer, SHIM_LCD_RAM_SIZE) != 0)
+    {
+        printf("FAIL: the display RAM doesn't match the frame at step %u\n", UxFramesStep);
+        UxFramesFailures++;
+    }
+}
+
+// Reads a joystick report and updates the UX, then moves the clock on to the next step
+// Part of the display update is left to be sent while the next frame is drawn, like the DMA on the Teensy
+void uxFramesRun(int steps)
+{
+    for (int i = 0; i < steps; i++)
+    {
+        shimJoystickReport(0, UxFramesButtons, UxFramesAxes);
+        joystickHidUpdate(&JoystickHidData, &JoystickHidChanges);
+        uxHandleInput(&SystemStatus, &JoystickHidData);
+
+        uint32_t spiBytes = shimSpiBytesSent();
+        UxFramesAllocations = 0;
+        UxFramesCountAllocations = true;
+        auto start = std::chrono::steady_clock::now();
+        uxUpdate(&SystemStatus, &JoystickHidData);
+        double renderMicros = std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - start).count();
+        UxFramesCountAllocations = false;
+
+        for (uint32_t transfer = 0; transfer < UxFramesStep % 4; transfer++)
+        {
+            shimSpiCompleteTransfer();
+        }
+
+        UxFramesStats_t *stats = &UxFramesStats[UxLayout >= 0 ? UxLayout : UX_FRAMES_LAYOUT_COUNT - 1];
+        stats->frames++;
+        stats->totalMicros += renderMicros;
+        stats->maxMicros = max(stats->maxMicros, renderMicros);
+        stats->spiBytes += shimSpiBytesSent() - spiBytes;
+        stats->allocations += UxFramesAllocations;
+        if (UxFramesAllocations > 0)
+        {
+            printf("FAIL: uxUpdate() allocated %u times at step %u\n", UxFramesAllocations, UxFramesStep);
+            UxFramesFailures++;
+        }
+
+        UxFramesStep++;
+        shimAdvanceMicros(UX_FRAMES_STEP_MICROS);
+    }
+}
+
+// Presses and releases buttons (or the d-pad), one step each
+void uxFramesPress(uint32_t buttons, uint8_t dpad = DPAD_CENTER)
+{
+    UxFramesButtons |= buttons;
+    UxFramesAxes[AXIS_DPAD] = dpad;
+    uxFramesRun(1);
+    UxFramesButtons &= ~buttons;
+    UxFramesAxes[AXIS_DPAD] = DPAD_CENTER;
+    uxFramesRun(1);
+}
+
+void uxFramesNextMenu()
+{
+    uxFramesPress(BUTTON_R_BUMPER);
+}
+
+// Sends the rest of the display update, then compares the frame with its image
+void uxFramesCheckpoint(const char *name)
+{
+    while (shimSpiCompleteTransfer())
+    {
+    }
+    uxFramesRun(1);
+    while (shimSpiCompleteTransfer())
+    {
+    }
+    uxFramesCheckLcd();
+
+    StringPrint frame;
+    uxWriteFramePbm(&frame);
+
+    std::string path = std::string(UX_FRAMES_DIR) + "/" + name + ".pbm";
+    if (UxFramesUpdate)
+    {
+        FILE *file = fopen(path.c_str(), "wb");
+        fwrite(frame.text.data(), 1, frame.text.size(), file);
+        fclose(file);
+        printf("Wrote %s\n", path.c_str());
+        return;
+    }
+
+    std::string expected;
+    FILE *file = fopen(path.c_str(), "rb");
+    if (file != NULL)
+    {
+        char buffer[256];
+        size_t count;
+        while ((count = fread(buffer, 1, sizeof(buffer), file)) > 0)
+        {
+            expected.append(buffer, count);
+        }
+        fclose(file);
+    }
+    if (frame.text != expected)
+    {
+        // Keep the frame that was drawn next to the test so it can be looked at
+        std::string actualPath = std::string(name) + ".actual.pbm";
+        FILE *actual = fopen(actualPath.c_str(), "wb");
+        fwrite(frame.text.data(), 1, frame.text.size(), actual);
+        fclose(actual);
+        printf("FAIL: frame %s doesn't match %s (drawn to %s)\n", name, path.c_str(), actualPath.c_str());
+        UxFramesFailures++;
+    }
+}
+
+void uxFramesPrintStats()
+{
+    printf("%-13s %7s %9s %9s %10s %7s\n", "Layout", "Frames", "Avg us", "Max us", "SPI B/frm", "Allocs");
+    for (int i = 0; i < UX_FRAMES_LAYOUT_COUNT; i++)
+    {
+        UxFramesStats_t *stats = &UxFramesStats[i];
+        if (stats->frames == 0)
+        {
+            continue;
+        }
+        printf("%-13s %7u %9.2f %9.2f %10.1f %7u\n", UX_FRAMES_LAYOUT_NAMES[i], stats->frames, stats->totalMicros / stats->frames,
+            stats->maxMicros, (double)stats->spiBytes / stats->frames, stats->allocations);
+    }
+}
+
+int main(int argc, char **argv)
+{
+    UxFramesUpdate = argc > 1 && strcmp(argv[1], "--update") == 0;
+
+    shimSetMicros(1000000);
+    shimSpiSetDeferred(true);
+    shimJoystickConnect(0, true);
+    joystickHidInit();
+    uxInit();
+
+    // Waiting for the aggregator
+    uxFramesRun(80);
+    uxFramesCheckpoint("status-connecting");
+
+    // Connected, which shows a notification first
+    SystemStatus.isConnected = true;
+    SystemStatus.lastMessageReceivedMillis = millis();
+    SystemStatus.notificationType = UX_NOTIFICATION_CONNECTED;
+    SystemStatus.notificationStartMillis = millis();
+    SystemStatus.areAllIgnitorsControllersConnected = true;
+    SystemStatus.isSequencerConnected = true;
+    uxFramesRun(5);
+    uxFramesCheckpoint("notification-connected");
+    uxFramesRun(60);
+    uxFramesCheckpoint("status");
+
+    // Every menu in turn
+    uxFramesNextMenu();
+    uxFramesPress(0, DPAD_DOWN);
+    uxFramesCheckpoint("visual-test");
+
+    uxFramesNextMenu();
+    uxFramesCheckpoint("sequence");
+
+    uxFramesNextMenu();
+    UxFramesAxes[AXIS_LEFT_STICK_X] = 40;
+    UxFramesAxes[AXIS_LEFT_STICK_Y] = 200;
+    uxFramesRun(10);
+    uxFramesCheckpoint("joysticks");
+    UxFramesAxes[AXIS_LEFT_STICK_X] = AXIS_STICK_CENTER;
+    UxFramesAxes[AXIS_LEFT_STICK_Y] = AXIS_STICK_CENTER;
+
+    uxFramesNextMenu();
+    uxFramesCheckpoint("ignition");
+
+    uxFramesNextMenu();
+    uxFramesCheckpoint("fault-none");
+    faultLogAdd(FAULT_SOURCE_AGGREGATOR, "Ignitor 2 lost", millis());
+    faultLogAdd(FAULT_SOURCE_LINK, "Aggregator connection lost", millis());
+    uxFramesRun(40);
+    uxFramesCheckpoint("fault-marquee");
+    uxFramesPress(0, DPAD_DOWN);
+    uxFramesCheckpoint("fault");
+
+    uxFramesNextMenu();
+    uxFramesRun(5);
+    uxFramesCheckpoint("arm-system");
+
+    uxFramesNextMenu();
+    uxFramesCheckpoint("calibrate");
+
+    uxFramesNextMenu();
+    uxFramesRun(20);
+    uxFramesCheckpoint("loop");
+
+    uxFramesNextMenu();
+    uxFramesRun(20);
+    uxFramesCheckpoint("latency");
+
+    // Holding both triggers asks to hold them until the sequence triggers
+    UxFramesButtons = BUTTON_L_TRIGGER | BUTTON_R_TRIGGER;
+    uxFramesRun(10);
+    uxFramesCheckpoint("notification-hold-to-trigger");
+    uxFramesRun(80);
+    uxFramesCheckpoint("notification-triggering");
+    UxFramesButtons = 0;
+    uxFramesRun(60);
+
+    uxFramesPrintStats();
+    if (UxFramesFailures > 0)
+    {
+        printf("%d failures\n", UxFramesFailures);
+        return 1;
+    }
+    return 0;
+}
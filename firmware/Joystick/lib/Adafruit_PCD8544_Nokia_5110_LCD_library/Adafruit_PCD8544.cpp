@@ -35,6 +35,10 @@
 #include "Arduino.h"
 #include <stdlib.h>
 
+// The classic font is private to Adafruit_GFX.cpp, include our own copy for
+// the column blit text renderer
+#include <glcdfont.c>
+
 /** the memory buffer for the LCD */
 uint8_t pcd8544_buffer[LCDWIDTH * LCDHEIGHT / 8] = {
     0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
@@ -81,8 +85,16 @@ uint8_t pcd8544_buffer[LCDWIDTH * LCDHEIGHT / 8] = {
     0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
 };
 
+#if defined(SPI_HAS_TRANSFER_ASYNC)
+/** the buffer streamed to the LCD by displayAsync(), drawing continues in
+ * pcd8544_buffer while it is sent */
+static uint8_t pcd8544_front_buffer[LCDWIDTH * LCDHEIGHT / 8];
+#endif
+
 /*!
-  @brief Update the bounding box for partial updates
+  @brief Mark a region as dirty for partial updates. The region is tracked as
+  a column span in every page it touches, so that display() only sends the
+  columns that changed in each page.
   @param xmin left
   @param ymin bottom
   @param xmax right
@@ -90,10 +102,88 @@ uint8_t pcd8544_buffer[LCDWIDTH * LCDHEIGHT / 8] = {
  */
 void Adafruit_PCD8544::updateBoundingBox(uint8_t xmin, uint8_t ymin,
                                          uint8_t xmax, uint8_t ymax) {
-  xUpdateMin = min(xUpdateMin, xmin);
-  xUpdateMax = max(xUpdateMax, xmax);
-  yUpdateMin = min(yUpdateMin, ymin);
-  yUpdateMax = max(yUpdateMax, ymax);
+  for (uint8_t page = ymin / 8; page <= ymax / 8; page++) {
+    uint8_t *start = damageStart[page];
+    uint8_t *end = damageEnd[page];
+    uint8_t count = damageCount[page];
+
+    // Find the first span that isn't entirely left of the new span
+    uint8_t i = 0;
+    while ((i < count) && (end[i] + PCD8544_DAMAGE_MERGE_GAP < xmin)) {
+      i++;
+    }
+
+    // Fast path, already dirty (the common case for pixel by pixel drawing)
+    if ((i < count) && (start[i] <= xmin) && (xmax <= end[i])) {
+      continue;
+    }
+
+    if ((i < count) && (start[i] <= xmax + PCD8544_DAMAGE_MERGE_GAP)) {
+      // Grow the span, then absorb any following spans it now reaches
+      start[i] = min(start[i], xmin);
+      end[i] = max(end[i], xmax);
+      uint8_t j = i + 1;
+      while ((j < count) && (start[j] <= end[i] + PCD8544_DAMAGE_MERGE_GAP)) {
+        end[i] = max(end[i], end[j]);
+        j++;
+      }
+      uint8_t k = i + 1;
+      for (; j < count; k++, j++) {
+        start[k] = start[j];
+        end[k] = end[j];
+      }
+      damageCount[page] = k;
+      continue;
+    }
+
+    if (count < PCD8544_DAMAGE_SPANS) {
+      // Insert a new span before span i
+      for (uint8_t k = count; k > i; k--) {
+        start[k] = start[k - 1];
+        end[k] = end[k - 1];
+      }
+      start[i] = xmin;
+      end[i] = xmax;
+      damageCount[page] = count + 1;
+      continue;
+    }
+
+    // Out of spans, insert the new span and merge the closest pair of
+    // neighbouring spans
+    uint8_t s[PCD8544_DAMAGE_SPANS + 1] = {}, e[PCD8544_DAMAGE_SPANS + 1] = {};
+    for (uint8_t k = 0, n = 0; k <= count; k++) {
+      if (k == i) {
+        s[k] = xmin;
+        e[k] = xmax;
+      } else {
+        s[k] = start[n];
+        e[k] = end[n];
+        n++;
+      }
+    }
+    uint8_t closest = 0;
+    for (uint8_t k = 1; k < count; k++) {
+      if (s[k + 1] - e[k] < s[closest + 1] - e[closest]) {
+        closest = k;
+      }
+    }
+    e[closest] = e[closest + 1];
+    for (uint8_t k = 0, n = 0; k <= count; k++) {
+      if (k == closest + 1) {
+        continue;
+      }
+      start[n] = s[k];
+      end[n] = e[k];
+      n++;
+    }
+  }
+}
+
+/*!
+  @brief Mark every page as clean
+ */
+void Adafruit_PCD8544::clearDamage(void) {
+  memset(damageCount, 0, sizeof(damageCount));
 }
 
 /*!
@@ -112,6 +202,7 @@ Adafruit_PCD8544::Adafruit_PCD8544(int8_t sclk_pin, int8_t din_pin,
 
   _dcpin = dc_pin;
   _rstpin = rst_pin;
+  clearDamage();
 }
 
 /*!
@@ -129,9 +220,16 @@ Adafruit_PCD8544::Adafruit_PCD8544(int8_t dc_pin, int8_t cs_pin, int8_t rst_pin,
     : Adafruit_GFX(LCDWIDTH, LCDHEIGHT) {
   spi_dev = new Adafruit_SPIDevice(cs_pin, 4000000, SPI_BITORDER_MSBFIRST,
                                    SPI_MODE0, theSPI);
+  _spi = theSPI;
 
   _dcpin = dc_pin;
   _rstpin = rst_pin;
+  clearDamage();
+
+#if defined(SPI_HAS_TRANSFER_ASYNC)
+  _flushEvent.setContext(this);
+  _flushEvent.attachImmediate(&Adafruit_PCD8544::flushEventHandler);
+#endif
 }
 
 /*!
@@ -182,6 +280,320 @@ void Adafruit_PCD8544::setPixel(int16_t x, int16_t y, bool color,
     buffer[x + (y / 8) * LCDWIDTH] &= ~(1 << (y % 8));
 }
 
+/*!
+  @brief Draw a vertical line directly into the main buffer
+  @param x     x coord
+  @param y     top y coord, negative heights extend upwards from here
+  @param h     height in pixels
+  @param color pixel color (BLACK or WHITE)
+ */
+void Adafruit_PCD8544::drawFastVLine(int16_t x, int16_t y, int16_t h,
+                                     uint16_t color) {
+  if (h < 0) { // Convert negative heights to positive equivalent
+    h *= -1;
+    y -= h - 1;
+  }
+  fillRect(x, y, 1, h, color);
+}
+
+/*!
+  @brief Draw a horizontal line directly into the main buffer
+  @param x     left x coord, negative widths extend to the left from here
+  @param y     y coord
+  @param w     width in pixels
+  @param color pixel color (BLACK or WHITE)
+ */
+void Adafruit_PCD8544::drawFastHLine(int16_t x, int16_t y, int16_t w,
+                                     uint16_t color) {
+  if (w < 0) { // Convert negative widths to positive equivalent
+    w *= -1;
+    x -= w - 1;
+  }
+  fillRect(x, y, w, 1, color);
+}
+
+/*!
+  @brief Fill a rectangle directly into the main buffer, a page (8 rows) at a
+  time instead of pixel by pixel
+  @param x     left x coord
+  @param y     top y coord
+  @param w     width in pixels
+  @param h     height in pixels
+  @param color pixel color (BLACK or WHITE)
+ */
+void Adafruit_PCD8544::fillRect(int16_t x, int16_t y, int16_t w, int16_t h,
+                                uint16_t color) {
+  if (w < 0) { // Convert negative widths to positive equivalent
+    w *= -1;
+    x -= w - 1;
+  }
+  if (h < 0) { // Convert negative heights to positive equivalent
+    h *= -1;
+    y -= h - 1;
+  }
+
+  // Clip to the (rotated) display
+  int16_t x1 = x + w - 1;
+  int16_t y1 = y + h - 1;
+  if (x < 0)
+    x = 0;
+  if (y < 0)
+    y = 0;
+  if (x1 >= _width)
+    x1 = _width - 1;
+  if (y1 >= _height)
+    y1 = _height - 1;
+  if ((x > x1) || (y > y1))
+    return;
+
+  // Rotate the corners into buffer coordinates, see setPixel()
+  int16_t t;
+  switch (rotation) {
+  case 1:
+    t = x;
+    x = y;
+    y = LCDHEIGHT - 1 - x1;
+    x1 = y1;
+    y1 = LCDHEIGHT - 1 - t;
+    break;
+  case 2:
+    t = x;
+    x = LCDWIDTH - 1 - x1;
+    x1 = LCDWIDTH - 1 - t;
+    t = y;
+    y = LCDHEIGHT - 1 - y1;
+    y1 = LCDHEIGHT - 1 - t;
+    break;
+  case 3:
+    t = x;
+    x = LCDWIDTH - 1 - y1;
+    y1 = x1;
+    x1 = LCDWIDTH - 1 - y;
+    y = t;
+    break;
+  }
+
+  fillRawRect(x, y, x1 - x + 1, y1 - y + 1, color);
+}
+
+/*!
+  @brief Fill the entire main buffer with one color
+  @param color pixel color (BLACK or WHITE)
+ */
+void Adafruit_PCD8544::fillScreen(uint16_t color) {
+  memset(pcd8544_buffer, color ? 0xFF : 0x00, LCDWIDTH * LCDHEIGHT / 8);
+  updateBoundingBox(0, 0, LCDWIDTH - 1, LCDHEIGHT - 1);
+}
+
+/*!
+  @brief Fill an unrotated, already clipped rectangle of the main buffer.
+  Every page the rectangle touches is a byte mask applied to each column.
+  @param x     left column
+  @param y     top row
+  @param w     width in pixels
+  @param h     height in pixels
+  @param color pixel color (BLACK or WHITE)
+ */
+void Adafruit_PCD8544::fillRawRect(uint8_t x, uint8_t y, uint8_t w, uint8_t h,
+                                   bool color) {
+  uint8_t y1 = y + h - 1;
+  updateBoundingBox(x, y, x + w - 1, y1);
+
+  for (uint8_t page = y / 8; page <= y1 / 8; page++) {
+    // Rows of this page covered by the rectangle
+    uint8_t mask = 0xFF;
+    if (page == y / 8)
+      mask &= 0xFF << (y % 8);
+    if (page == y1 / 8)
+      mask &= 0xFF >> (7 - (y1 % 8));
+
+    uint8_t *ptr = pcd8544_buffer + (page * LCDWIDTH) + x;
+    uint8_t *end = ptr + w;
+    if (color) {
+      while (ptr < end)
+        *ptr++ |= mask;
+    } else {
+      mask = ~mask;
+      while (ptr < end)
+        *ptr++ &= mask;
+    }
+  }
+}
+
+/*!
+  @brief Print one character at the cursor. The classic font at 1x size is
+  drawn with drawFastChar(), everything else goes through Adafruit_GFX.
+  @param c The 8-bit ascii character to write
+  @return Amount of characters written
+ */
+size_t Adafruit_PCD8544::write(uint8_t c) {
+  if (gfxFont || (textsize_x != 1) || (textsize_y != 1)) {
+    return Adafruit_GFX::write(c);
+  }
+
+  if (c == '\n') { // Newline?
+    cursor_x = 0;   // Reset x to zero,
+    cursor_y += 8;  // advance y one line
+  } else if (c != '\r') {                  // Ignore carriage returns
+    if (wrap && ((cursor_x + 6) > _width)) { // Off right?
+      cursor_x = 0;                          // Reset x to zero,
+      cursor_y += 8;                         // advance y one line
+    }
+    drawFastChar(cursor_x, cursor_y, c, textcolor, textbgcolor);
+    cursor_x += 6; // Advance x one char
+  }
+  return 1;
+}
+
+/*!
+  @brief Draw a single character of the classic font at 1x size. Every font
+  column is a vertical strip of 8 pixels, the same layout as a page byte, so
+  each column is written with one byte operation (two if y isn't page
+  aligned) instead of a pixel at a time.
+  @param x     top left x coord
+  @param y     top left y coord
+  @param c     The 8-bit font-indexed character (likely ascii)
+  @param color pixel color of the character (BLACK or WHITE)
+  @param bg    background color, same as color for no background
+ */
+void Adafruit_PCD8544::drawFastChar(int16_t x, int16_t y, unsigned char c,
+                                    uint16_t color, uint16_t bg) {
+  // Glyph columns only line up with page bytes when the display isn't rotated
+  if (rotation != 0) {
+    drawChar(x, y, c, color, bg, 1);
+    return;
+  }
+
+  if ((x >= LCDWIDTH) || (y >= LCDHEIGHT) || ((x + 5) < 0) || ((y + 7) < 0))
+    return;
+
+  if (!_cp437 && (c >= 176))
+    c++; // Handle 'classic' charset behavior
+
+  // The glyph covers bits [shift, shift + 8) of the page pair starting at page
+  int16_t page = (y < 0) ? -1 : (y / 8);
+  uint8_t shift = y - (page * 8);
+  bool opaque = (bg != color);
+
+  int16_t x0 = max(x, (int16_t)0);
+  int16_t x1 = min((int16_t)(x + (opaque ? 5 : 4)), (int16_t)(LCDWIDTH - 1));
+  if (x1 < x0)
+    return; // Only the transparent spacing column is on the display
+  updateBoundingBox(x0, max(y, (int16_t)0), x1,
+                    min((int16_t)(y + 7), (int16_t)(LCDHEIGHT - 1)));
+
+  for (int16_t col = x0; col <= x1; col++) {
+    // The sixth column is the (background only) spacing between characters
+    uint8_t i = col - x;
+    uint8_t bits = (i < 5) ? pgm_read_byte(&font[c * 5 + i]) : 0;
+    blitGlyphColumn(col, page, shift, bits, color, bg);
+  }
+}
+
+/*!
+  @brief Draw a single column of a classic font character straight into the
+  page buffer, used to reveal text one column at a time (e.g. a marquee).
+  Falls back to drawPixel() when the display is rotated.
+  @param x Display column to draw into
+  @param y Top of the character
+  @param c The character
+  @param column Column of the character, 0-4 for the glyph, 5 for the spacing
+  @param color Color of the glyph
+  @param bg Background color, the spacing column is only drawn if this
+  differs from color
+ */
+void Adafruit_PCD8544::drawFastCharColumn(int16_t x, int16_t y,
+                                          unsigned char c, uint8_t column,
+                                          uint16_t color, uint16_t bg) {
+  if ((x < 0) || (x >= _width) || (y >= _height) || ((y + 7) < 0) ||
+      (column > 5))
+    return;
+  bool opaque = (bg != color);
+  if ((column == 5) && !opaque)
+    return;
+
+  if (!_cp437 && (c >= 176))
+    c++; // Handle 'classic' charset behavior
+  uint8_t bits = (column < 5) ? pgm_read_byte(&font[c * 5 + column]) : 0;
+
+  if (rotation != 0) {
+    for (int8_t j = 0; j < 8; j++, bits >>= 1) {
+      if (bits & 1)
+        drawPixel(x, y + j, color);
+      else if (opaque)
+        drawPixel(x, y + j, bg);
+    }
+    return;
+  }
+
+  int16_t page = (y < 0) ? -1 : (y / 8);
+  uint8_t shift = y - (page * 8);
+  updateBoundingBox(x, max(y, (int16_t)0), x,
+                    min((int16_t)(y + 7), (int16_t)(LCDHEIGHT - 1)));
+  blitGlyphColumn(x, page, shift, bits, color, bg);
+}
+
+/*!
+  @brief Merge one 8 pixel glyph column into the page pair it straddles
+  @param col Display column, already clipped
+  @param page First page covered by the column, -1 if it starts above the
+  display
+  @param shift Row of the first page the column starts at
+  @param bits Glyph column, LSB on top
+  @param color Color of the glyph
+  @param bg Background color, only drawn if it differs from color
+ */
+void Adafruit_PCD8544::blitGlyphColumn(uint8_t col, int16_t page,
+                                       uint8_t shift, uint8_t bits,
+                                       uint16_t color, uint16_t bg) {
+  uint16_t mask = 0xFF << shift;
+  uint16_t shifted = (uint16_t)bits << shift;
+
+  // Pixels that end up black and pixels that end up white
+  uint16_t set = color ? shifted : 0;
+  uint16_t clear = color ? 0 : shifted;
+  if (bg != color) {
+    set |= bg ? (mask & ~shifted) : 0;
+    clear |= bg ? 0 : (mask & ~shifted);
+  }
+
+  if ((page >= 0) && (page < LCDPAGES)) {
+    uint8_t *ptr = pcd8544_buffer + (page * LCDWIDTH) + col;
+    *ptr = (*ptr & ~(uint8_t)clear) | (uint8_t)set;
+  }
+  if (shift && (page + 1 < LCDPAGES)) {
+    uint8_t *ptr = pcd8544_buffer + ((page + 1) * LCDWIDTH) + col;
+    *ptr = (*ptr & ~(uint8_t)(clear >> 8)) | (uint8_t)(set >> 8);
+  }
+}
+
+/*!
+  @brief Move a band of whole pages left in place, e.g. to step a marquee.
+  Works on the unrotated buffer; the columns exposed on the right keep their
+  old contents for the caller to redraw.
+  @param firstPage First page of the band
+  @param lastPage Last page of the band (inclusive)
+  @param x0 Leftmost column of the band
+  @param x1 Rightmost column of the band (inclusive)
+  @param columns Number of columns to shift by
+ */
+void Adafruit_PCD8544::shiftColumnsLeft(uint8_t firstPage, uint8_t lastPage,
+                                        uint8_t x0, uint8_t x1,
+                                        uint8_t columns) {
+  if ((lastPage >= LCDPAGES) || (firstPage > lastPage) || (x1 >= LCDWIDTH) ||
+      (x0 > x1) || (columns == 0))
+    return;
+  uint8_t w = x1 - x0 + 1;
+  if (columns >= w)
+    return; // Nothing survives the shift
+  updateBoundingBox(x0, firstPage * 8, x1 - columns, lastPage * 8 + 7);
+
+  for (uint8_t page = firstPage; page <= lastPage; page++) {
+    uint8_t *ptr = pcd8544_buffer + (page * LCDWIDTH) + x0;
+    memmove(ptr, ptr + columns, w - columns);
+  }
+}
+
 /*!
   @brief The most basic function, get a single pixel
   @param  x x coord
@@ -281,6 +693,7 @@ bool Adafruit_PCD8544::begin(uint8_t contrast, uint8_t bias) {
 void Adafruit_PCD8544::command(uint8_t c) {
   digitalWrite(_dcpin, LOW);
   spi_dev->write(&c, 1);
+  _bytes_sent++;
 }
 
 /*!
@@ -290,6 +703,7 @@ void Adafruit_PCD8544::command(uint8_t c) {
 void Adafruit_PCD8544::data(uint8_t c) {
   digitalWrite(_dcpin, HIGH);
   spi_dev->write(&c, 1);
+  _bytes_sent++;
 }
 
 /*!
@@ -347,9 +761,26 @@ void Adafruit_PCD8544::setReinitInterval(uint8_t val) {
 uint8_t Adafruit_PCD8544::getReinitInterval() { return _reinit_interval; }
 
 /*!
-  @brief Update the display
+  @brief  Get the number of bytes (commands and data) sent to the LCD so far,
+  useful for measuring how much each display update costs
+  @return Byte count, wraps around
+ */
+uint32_t Adafruit_PCD8544::getBytesSent() { return _bytes_sent; }
+
+/*!
+  @brief  Get the display buffer, e.g. to capture a frame
+  @return The page-major buffer, one byte per column of 8 rows with the top
+  row in the LSB
+ */
+uint8_t *Adafruit_PCD8544::getBuffer() { return pcd8544_buffer; }
+
+/*!
+  @brief Update the display, waits for any asynchronous update to finish first
  */
 void Adafruit_PCD8544::display(void) {
+  while (displayInProgress()) {
+  }
+
   if (_reinit_interval) {
     _display_count++;
     if (_display_count >= _reinit_interval) {
@@ -358,27 +789,158 @@ void Adafruit_PCD8544::display(void) {
     }
   }
 
-  for (uint8_t page = (yUpdateMin / 8); page < (yUpdateMax / 8) + 1; page++) {
-    command(PCD8544_SETYADDR | page);
+  bool sent = false;
+  for (uint8_t page = 0; page < LCDPAGES; page++) {
+    for (uint8_t span = 0; span < damageCount[page]; span++) {
+      uint8_t startcol = damageStart[page][span];
+      uint8_t endcol = damageEnd[page][span];
 
-    uint8_t startcol = xUpdateMin;
-    uint8_t endcol = xUpdateMax;
+      command(PCD8544_SETYADDR | page);
+      command(PCD8544_SETXADDR | startcol);
 
-    command(PCD8544_SETXADDR | startcol);
+      digitalWrite(_dcpin, HIGH);
+      spi_dev->write(pcd8544_buffer + (LCDWIDTH * page) + startcol,
+                     endcol - startcol + 1);
+      _bytes_sent += endcol - startcol + 1;
+      sent = true;
+    }
+  }
 
-    digitalWrite(_dcpin, HIGH);
-    spi_dev->write(pcd8544_buffer + (LCDWIDTH * page) + startcol,
-                   endcol - startcol + 1);
+  if (sent) {
+    command(PCD8544_SETYADDR); // no idea why this is necessary but it is to
+                               // finish the last byte?
+  }
+
+  clearDamage();
+}
+
+/*!
+  @brief Start updating the display without waiting for the data to be sent.
+  The dirty spans are copied into a front buffer and streamed to the LCD by
+  SPI DMA while drawing continues in the main buffer. No other commands may be
+  sent to the LCD until displayInProgress() returns false. Without DMA
+  capable hardware SPI this is the same as display().
+  @return False if the previous update is still in progress, nothing was
+  started and the damage is kept for the next call
+ */
+bool Adafruit_PCD8544::displayAsync(void) {
+#if defined(SPI_HAS_TRANSFER_ASYNC)
+  if (_spi == NULL) {
+    display();
+    return true;
+  }
+
+  if (displayInProgress()) {
+    return false;
+  }
+
+  if (_reinit_interval) {
+    _display_count++;
+    if (_display_count >= _reinit_interval) {
+      _display_count = 0;
+      initDisplay();
+    }
+  }
+
+  // Swap, copying the dirty spans to the front buffer
+  _flushCount = 0;
+  for (uint8_t page = 0; page < LCDPAGES; page++) {
+    for (uint8_t span = 0; span < damageCount[page]; span++) {
+      uint16_t offset = (LCDWIDTH * page) + damageStart[page][span];
+      memcpy(pcd8544_front_buffer + offset, pcd8544_buffer + offset,
+             damageEnd[page][span] - damageStart[page][span] + 1);
+
+      _flushPage[_flushCount] = page;
+      _flushStart[_flushCount] = damageStart[page][span];
+      _flushEnd[_flushCount] = damageEnd[page][span];
+      _flushCount++;
+
+      // Two address commands and the data, counted when the update is queued
+      _bytes_sent += 2 + damageEnd[page][span] - damageStart[page][span] + 1;
+    }
+  }
+  clearDamage();
+
+  if (_flushCount == 0) {
+    return true;
   }
 
-  command(PCD8544_SETYADDR); // no idea why this is necessary but it is to
-                             // finish the last byte?
+  _bytes_sent++; // The trailing SETYADDR
+  _flushIndex = 0;
+  _flushState = FLUSH_ADDRESS;
+  spi_dev->beginTransactionWithAssertingCS();
+  flushNext();
+  return true;
+#else
+  display();
+  return true;
+#endif
+}
+
+/*!
+  @brief Check whether an update started by displayAsync() is still being
+  sent, ending its SPI transaction once it is done
+  @return True if the update is still in progress
+ */
+bool Adafruit_PCD8544::displayInProgress(void) {
+#if defined(SPI_HAS_TRANSFER_ASYNC)
+  if (_flushState == FLUSH_DONE) {
+    spi_dev->endTransactionWithDeassertingCS();
+    _flushState = FLUSH_IDLE;
+  }
+  return _flushState != FLUSH_IDLE;
+#else
+  return false;
+#endif
+}
+
+#if defined(SPI_HAS_TRANSFER_ASYNC)
+/*!
+  @brief SPI DMA completion event, continues the asynchronous update
+  @param event The event, its context is the display
+ */
+void Adafruit_PCD8544::flushEventHandler(EventResponderRef event) {
+  ((Adafruit_PCD8544 *)event.getContext())->flushNext();
+}
 
-  xUpdateMin = LCDWIDTH - 1;
-  xUpdateMax = 0;
-  yUpdateMin = LCDHEIGHT - 1;
-  yUpdateMax = 0;
+/*!
+  @brief Start the next DMA transfer of an asynchronous update. D/C has to
+  change between the address commands and the data of every span, so each is
+  its own transfer.
+ */
+void Adafruit_PCD8544::flushNext(void) {
+  switch (_flushState) {
+  case FLUSH_ADDRESS:
+    digitalWrite(_dcpin, LOW);
+    if (_flushIndex == _flushCount) {
+      _flushCommand[0] = PCD8544_SETYADDR; // see display()
+      _flushState = FLUSH_FINISH;
+      _spi->transfer(_flushCommand, NULL, 1, _flushEvent);
+    } else {
+      _flushCommand[0] = PCD8544_SETYADDR | _flushPage[_flushIndex];
+      _flushCommand[1] = PCD8544_SETXADDR | _flushStart[_flushIndex];
+      _flushState = FLUSH_DATA;
+      _spi->transfer(_flushCommand, NULL, 2, _flushEvent);
+    }
+    break;
+  case FLUSH_DATA: {
+    uint8_t i = _flushIndex;
+    _flushIndex = i + 1;
+    _flushState = FLUSH_ADDRESS;
+    digitalWrite(_dcpin, HIGH);
+    _spi->transfer(pcd8544_front_buffer + (LCDWIDTH * _flushPage[i]) +
+                       _flushStart[i],
+                   NULL, _flushEnd[i] - _flushStart[i] + 1, _flushEvent);
+    break;
+  }
+  case FLUSH_FINISH:
+    _flushState = FLUSH_DONE;
+    break;
+  default:
+    break;
+  }
 }
+#endif
 
 /*!
   @brief Clear the entire display
@@ -400,33 +962,63 @@ void Adafruit_PCD8544::invertDisplay(bool i) {
 }
 
 /*!
-  @brief Scroll the display by creating a new buffer and moving each pixel
+  @brief Scroll the display, wrapping around at the edges. Whole page bytes
+  are rotated for the horizontal part and each column's 48 bits for the
+  vertical part.
   @param xpixels The x offset, can be negative to scroll backwards
   @param ypixels The y offset, can be negative to scroll updwards
  */
 void Adafruit_PCD8544::scroll(int8_t xpixels, int8_t ypixels) {
-  uint8_t new_buffer[LCDWIDTH * LCDHEIGHT / 8];
-  memset(new_buffer, 0, LCDWIDTH * LCDHEIGHT / 8);
+  // Map the offset in rotated coordinates onto the unrotated buffer
+  int16_t dx, dy;
+  switch (rotation) {
+  case 1:
+    dx = ypixels;
+    dy = -xpixels;
+    break;
+  case 2:
+    dx = -xpixels;
+    dy = -ypixels;
+    break;
+  case 3:
+    dx = -ypixels;
+    dy = xpixels;
+    break;
+  default:
+    dx = xpixels;
+    dy = ypixels;
+    break;
+  }
 
   // negative pixels wrap around
-  while (ypixels < 0) {
-    ypixels += height();
-  }
-  ypixels %= height();
-  while (xpixels < 0) {
-    xpixels += width();
+  dx %= LCDWIDTH;
+  if (dx < 0)
+    dx += LCDWIDTH;
+  dy %= LCDHEIGHT;
+  if (dy < 0)
+    dy += LCDHEIGHT;
+
+  if (dx) {
+    uint8_t wrapped[LCDWIDTH];
+    for (uint8_t page = 0; page < LCDPAGES; page++) {
+      uint8_t *row = pcd8544_buffer + (page * LCDWIDTH);
+      memcpy(wrapped, row + LCDWIDTH - dx, dx);
+      memmove(row + dx, row, LCDWIDTH - dx);
+      memcpy(row, wrapped, dx);
+    }
   }
-  xpixels %= width();
 
-  for (int x = 0; x < width(); x++) {
-    for (int y = 0; y < height(); y++) {
-      if (getPixel(x, y, pcd8544_buffer)) {
-        int new_x = (x + xpixels) % _width;
-        int new_y = (y + ypixels) % _height;
-        setPixel(new_x, new_y, true, new_buffer);
-      }
+  if (dy) {
+    const uint64_t columnMask = (1ULL << LCDHEIGHT) - 1;
+    for (uint8_t x = 0; x < LCDWIDTH; x++) {
+      uint64_t column = 0;
+      for (uint8_t page = 0; page < LCDPAGES; page++)
+        column |= (uint64_t)pcd8544_buffer[(page * LCDWIDTH) + x] << (page * 8);
+      column = ((column << dy) | (column >> (LCDHEIGHT - dy))) & columnMask;
+      for (uint8_t page = 0; page < LCDPAGES; page++)
+        pcd8544_buffer[(page * LCDWIDTH) + x] = column >> (page * 8);
     }
   }
-  memcpy(pcd8544_buffer, new_buffer, LCDWIDTH * LCDHEIGHT / 8);
+
   updateBoundingBox(0, 0, LCDWIDTH - 1, LCDHEIGHT - 1);
 }
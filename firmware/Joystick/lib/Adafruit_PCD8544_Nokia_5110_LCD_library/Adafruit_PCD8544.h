@@ -27,11 +27,21 @@
 #include <Adafruit_SPIDevice.h>
 #include <SPI.h>
 
+#if defined(SPI_HAS_TRANSFER_ASYNC)
+#include <EventResponder.h>
+#endif
+
 #define BLACK 1 ///< Black pixel
 #define WHITE 0 ///< White pixel
 
 #define LCDWIDTH 84  ///< LCD is 84 pixels wide
 #define LCDHEIGHT 48 ///< 48 pixels high
+#define LCDPAGES (LCDHEIGHT / 8) ///< 6 pages of 8 pixel rows
+
+#define PCD8544_DAMAGE_SPANS 3 ///< Max dirty column spans tracked per page
+#define PCD8544_DAMAGE_MERGE_GAP                                               \
+  4 ///< Dirty spans closer than this are merged, resending the columns in
+    ///< between costs less than addressing another span
 
 #define PCD8544_POWERDOWN 0x04 ///< Function set, Power down mode
 #define PCD8544_ENTRYMODE 0x02 ///< Function set, Entry mode
@@ -81,22 +91,41 @@ public:
 
   void clearDisplay(void);
   void display();
+  bool displayAsync(void);
+  bool displayInProgress(void);
   void updateBoundingBox(uint8_t xmin, uint8_t ymin, uint8_t xmax,
                          uint8_t ymax);
 
   void setReinitInterval(uint8_t val);
   uint8_t getReinitInterval(void);
 
+  uint32_t getBytesSent(void);
+  uint8_t *getBuffer(void);
+
   void drawPixel(int16_t x, int16_t y, uint16_t color);
+  void drawFastVLine(int16_t x, int16_t y, int16_t h, uint16_t color);
+  void drawFastHLine(int16_t x, int16_t y, int16_t w, uint16_t color);
+  void fillRect(int16_t x, int16_t y, int16_t w, int16_t h, uint16_t color);
+  void fillScreen(uint16_t color);
+
+  using Adafruit_GFX::write;
+  size_t write(uint8_t c);
+  void drawFastChar(int16_t x, int16_t y, unsigned char c, uint16_t color,
+                    uint16_t bg);
+  void drawFastCharColumn(int16_t x, int16_t y, unsigned char c,
+                          uint8_t column, uint16_t color, uint16_t bg);
+  void shiftColumnsLeft(uint8_t firstPage, uint8_t lastPage, uint8_t x0,
+                        uint8_t x1, uint8_t columns);
   void setPixel(int16_t x, int16_t y, bool color, uint8_t *buffer);
   bool getPixel(int16_t x, int16_t y, uint8_t *buffer);
 
   void initDisplay();
   void invertDisplay(bool i);
-  void scroll(int8_t vpixels, int8_t hpixels);
+  void scroll(int8_t xpixels, int8_t ypixels);
 
 private:
   Adafruit_SPIDevice *spi_dev = NULL;
+  SPIClass *_spi = NULL; ///< Hardware SPI used for DMA flushes, NULL if none
   int8_t _rstpin = -1, _dcpin = -1;
 
   uint8_t _contrast;        ///< Contrast level, Vop
@@ -104,8 +133,40 @@ private:
   uint8_t _reinit_interval; ///< Reinitialize the display after this many calls
                             ///< to display()
   uint8_t _display_count;   ///< Count for reinit interval
-
-  uint8_t xUpdateMin, xUpdateMax, yUpdateMin, yUpdateMax;
+  uint32_t _bytes_sent = 0; ///< Bytes sent to the LCD, see getBytesSent()
+
+  void clearDamage(void);
+  void fillRawRect(uint8_t x, uint8_t y, uint8_t w, uint8_t h, bool color);
+  void blitGlyphColumn(uint8_t col, int16_t page, uint8_t shift, uint8_t bits,
+                       uint16_t color, uint16_t bg);
+
+  /// Dirty column spans of each page, sorted and non-overlapping
+  uint8_t damageStart[LCDPAGES][PCD8544_DAMAGE_SPANS];
+  uint8_t damageEnd[LCDPAGES][PCD8544_DAMAGE_SPANS]; ///< Inclusive span ends
+  uint8_t damageCount[LCDPAGES]; ///< Number of dirty spans in each page
+
+#if defined(SPI_HAS_TRANSFER_ASYNC)
+  /// Steps of an asynchronous flush, advanced by the SPI DMA completion event
+  enum FlushState {
+    FLUSH_IDLE,    ///< No flush in progress
+    FLUSH_ADDRESS, ///< Send the address of the next span (or finish)
+    FLUSH_DATA,    ///< Send the data of the current span
+    FLUSH_FINISH,  ///< The final command is being sent
+    FLUSH_DONE     ///< Everything was sent, the transaction needs to end
+  };
+
+  static void flushEventHandler(EventResponderRef event);
+  void flushNext(void);
+
+  EventResponder _flushEvent;
+  uint8_t _flushCommand[2]; ///< Command bytes of the current DMA transfer
+  uint8_t _flushPage[LCDPAGES * PCD8544_DAMAGE_SPANS]; ///< Spans being sent
+  uint8_t _flushStart[LCDPAGES * PCD8544_DAMAGE_SPANS];
+  uint8_t _flushEnd[LCDPAGES * PCD8544_DAMAGE_SPANS];
+  uint8_t _flushCount;                 ///< Number of spans being sent
+  volatile uint8_t _flushIndex;        ///< Next span to send
+  volatile FlushState _flushState = FLUSH_IDLE;
+#endif
 };
 
 #endif
@@ -0,0 +1,99 @@
+/*********************************************************************
+This is a benchmark sketch for the page-aligned fill and line primitives
+of the PCD8544 library.
+
+It times the primitives used by the joystick UX (menu top bar, arm code
+boxes and notification frames) against the generic pixel-by-pixel
+Adafruit_GFX implementations and prints the results to Serial.
+
+BSD license, check license.txt for more information
+*********************************************************************/
+
+#include <SPI.h>
+#include <Adafruit_GFX.h>
+#include <Adafruit_PCD8544.h>
+
+// Hardware SPI, same pins as the joystick
+// pin 5 - Data/Command select (D/C)
+// pin 4 - LCD chip select (CS)
+// pin 3 - LCD reset (RST)
+Adafruit_PCD8544 display = Adafruit_PCD8544(5, 4, 3);
+
+// The same display drawn through the generic Adafruit_GFX primitives, which
+// end up in drawPixel() one pixel at a time
+class PixelPCD8544 : public Adafruit_PCD8544 {
+public:
+  PixelPCD8544(int8_t dc_pin, int8_t cs_pin, int8_t rst_pin)
+      : Adafruit_PCD8544(dc_pin, cs_pin, rst_pin) {}
+
+  void drawFastVLine(int16_t x, int16_t y, int16_t h, uint16_t color) {
+    Adafruit_GFX::drawFastVLine(x, y, h, color);
+  }
+  void drawFastHLine(int16_t x, int16_t y, int16_t w, uint16_t color) {
+    Adafruit_GFX::drawFastHLine(x, y, w, color);
+  }
+  void fillRect(int16_t x, int16_t y, int16_t w, int16_t h, uint16_t color) {
+    Adafruit_GFX::fillRect(x, y, w, h, color);
+  }
+  void fillScreen(uint16_t color) { Adafruit_GFX::fillScreen(color); }
+};
+PixelPCD8544 pixelDisplay = PixelPCD8544(5, 4, 3);
+
+#define ITERATIONS 1000
+
+void drawTopBar(Adafruit_PCD8544 &d) {
+  d.fillRect(0, 0, 8, 9, BLACK);
+  d.fillTriangle(0, 4, 8, 0, 8, 8, WHITE);
+  d.fillTriangle(83, 4, 75, 0, 75, 8, BLACK);
+  d.drawLine(0, 10, 84, 10, BLACK);
+}
+
+void drawArmCodeBoxes(Adafruit_PCD8544 &d) {
+  for (uint8_t i = 0; i < 3; i++) {
+    d.fillRect(10 + (18 * i), 23, 9, 11, BLACK);
+  }
+  d.drawRect(64, 23, 9, 11, BLACK);
+}
+
+void drawNotificationFrame(Adafruit_PCD8544 &d) {
+  d.drawRoundRect(0, 0, d.width(), d.height(), 5, BLACK);
+}
+
+uint32_t timeDrawing(Adafruit_PCD8544 &d, void (*draw)(Adafruit_PCD8544 &)) {
+  uint32_t start = micros();
+  for (uint16_t i = 0; i < ITERATIONS; i++) {
+    draw(d);
+  }
+  return micros() - start;
+}
+
+void report(const char *name, void (*draw)(Adafruit_PCD8544 &)) {
+  uint32_t fast = timeDrawing(display, draw);
+  uint32_t pixel = timeDrawing(pixelDisplay, draw);
+
+  Serial.print(name);
+  Serial.print(": page-aligned ");
+  Serial.print((float)fast / ITERATIONS);
+  Serial.print("us, pixel-by-pixel ");
+  Serial.print((float)pixel / ITERATIONS);
+  Serial.print("us, ");
+  Serial.print((float)pixel / fast);
+  Serial.println("x faster");
+}
+
+void setup() {
+  Serial.begin(9600);
+  while (!Serial)
+    ;
+
+  display.begin();
+  display.clearDisplay();
+
+  report("Menu top bar", drawTopBar);
+  report("Arm code boxes", drawArmCodeBoxes);
+  report("Notification frame", drawNotificationFrame);
+
+  display.display();
+}
+
+void loop() {}
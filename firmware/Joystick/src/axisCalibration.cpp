@@ -0,0 +1,64 @@
+#include "axisCalibration.h"
+#include <EEPROM.h>
+
+// Where the calibrations are stored in EEPROM, and the marker that shows they were saved by this version of the firmware
+const int AXIS_CALIBRATION_EEPROM_ADDRESS = 0;
+const uint32_t AXIS_CALIBRATION_EEPROM_MAGIC = 0x43414C31; // "CAL1"
+
+struct AxisCalibrationStorage_t
+{
+    uint32_t magic;
+    AxisCalibration_t calibrations[CALIBRATED_AXIS_COUNT];
+};
+
+void axisCalibrationBuildTable(const AxisCalibration_t *calibration, uint8_t *table)
+{
+    float expo = calibration->expo / 255.0f;
+    for (int raw = 0; raw < 256; raw++)
+    {
+        // Scale the distance from the center (past the deadzone) to the extent on that side, from -1 to 1
+        int offset = raw - calibration->center;
+        int range = offset < 0 ? calibration->center - calibration->minimum : calibration->maximum - calibration->center;
+        float position = 0.0f;
+        if (abs(offset) > calibration->deadzone && range > calibration->deadzone)
+        {
+            position = (float)(abs(offset) - calibration->deadzone) / (range - calibration->deadzone);
+            position = min(position, 1.0f);
+            position = offset < 0 ? -position : position;
+        }
+
+        // Apply the response curve, blending between linear and cubic
+        position = ((1.0f - expo) * position) + (expo * position * position * position);
+        if (calibration->inverted)
+        {
+            position = -position;
+        }
+
+        // Conditioned values reach 0 at one extent and 255 at the other
+        int conditioned = position < 0.0f
+            ? AXIS_CONDITIONED_CENTER + (int)lroundf(position * AXIS_CONDITIONED_CENTER)
+            : AXIS_CONDITIONED_CENTER + (int)lroundf(position * (255 - AXIS_CONDITIONED_CENTER));
+        table[raw] = constrain(conditioned, 0, 255);
+    }
+}
+
+bool axisCalibrationLoad(AxisCalibration_t *calibrations)
+{
+    AxisCalibrationStorage_t storage;
+    EEPROM.get(AXIS_CALIBRATION_EEPROM_ADDRESS, storage);
+    if (storage.magic != AXIS_CALIBRATION_EEPROM_MAGIC)
+    {
+        return false;
+    }
+
+    memcpy(calibrations, storage.calibrations, sizeof(storage.calibrations));
+    return true;
+}
+
+void axisCalibrationSave(const AxisCalibration_t *calibrations)
+{
+    AxisCalibrationStorage_t storage;
+    storage.magic = AXIS_CALIBRATION_EEPROM_MAGIC;
+    memcpy(storage.calibrations, calibrations, sizeof(storage.calibrations));
+    EEPROM.put(AXIS_CALIBRATION_EEPROM_ADDRESS, storage);
+}
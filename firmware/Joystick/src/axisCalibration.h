@@ -0,0 +1,46 @@
+#ifndef _AXIS_CALIBRATION_H_
+#define _AXIS_CALIBRATION_H_
+
+#include <Arduino.h>
+
+// The number of joystick axes that are calibrated (the sticks, the d-pad is a direction and is passed through)
+const int CALIBRATED_AXIS_COUNT = 4;
+
+// The conditioned value of a centered stick, conditioned values run from 0 to 255 around it
+const uint8_t AXIS_CONDITIONED_CENTER = 128;
+
+// The default number of raw counts on either side of the center that still read as centered
+const uint8_t AXIS_DEFAULT_DEADZONE = 5;
+
+// How a raw stick axis maps to its conditioned value
+struct AxisCalibration_t
+{
+    // The raw values at the stick's extents and at rest
+    uint8_t minimum;
+    uint8_t center;
+    uint8_t maximum;
+
+    // Raw counts on either side of the center that read as centered
+    uint8_t deadzone;
+
+    // Response curve, 0 is linear and 255 is fully cubic (finer control around the center)
+    uint8_t expo;
+
+    // Whether or not the axis is flipped
+    bool inverted;
+};
+
+const AxisCalibration_t AXIS_DEFAULT_CALIBRATION = { 0, 128, 255, AXIS_DEFAULT_DEADZONE, 0, false };
+
+// Builds the 256 entry lookup table that maps every raw value of an axis to its conditioned value
+void axisCalibrationBuildTable(const AxisCalibration_t *calibration, uint8_t *table);
+
+// Loads the calibration of every calibrated axis from EEPROM
+// Returns true if a saved calibration was found; false otherwise (the calibrations are left unchanged)
+bool axisCalibrationLoad(AxisCalibration_t *calibrations);
+
+// Saves the calibration of every calibrated axis to EEPROM
+void axisCalibrationSave(const AxisCalibration_t *calibrations);
+
+
+#endif // end _AXIS_CALIBRATION_H_
@@ -0,0 +1,763 @@
+#include "coms.h"
+#include "faultLog.h"
+#include <string.h>
+#include <stdio.h>
+#include "pb_encode.h"
+#include "pb_decode.h"
+
+const uint8_t COMS_FRAME_DELIMITER = 0;
+
+const ComsPort_t *ComsPort = NULL;
+ComsStats_t ComsStats;
+
+// The frame being written
+uint8_t ComsTxMessage[JoystickMessage_size];
+uint8_t ComsTxFrame[COMS_MAX_TX_FRAME_SIZE];
+int ComsTxLength = 0; // 0 when no frame is being written
+int ComsTxPosition = 0;
+pb_size_t ComsTxMessageTag = 0;
+uint32_t ComsTxTraceId = 0;
+
+// The frame being received, decoded one byte at a time as it comes in
+uint8_t ComsRxMessage[COMS_MAX_RX_MESSAGE_SIZE];
+int ComsRxLength = 0;
+uint8_t ComsRxBlockRemaining = 0; // Bytes left in the current COBS block, 0 when the next byte is a block code
+bool ComsRxZeroPending = false; // Whether or not the current block ends with a 0 (every block but the last and full blocks)
+bool ComsRxStarted = false; // Whether or not a block code was received since the last delimiter
+bool ComsRxOverflow = false;
+JoystickReplyMessage ComsReply;
+
+uint32_t ComsLastStatusRequestMillis = 0;
+
+// The messages the link sends, in priority order (each belongs to a class, see COMS_TX_KIND_CLASSES)
+enum ComsTxKind
+{
+    COMS_TX_ABORT_SEQUENCE = 0,
+    COMS_TX_TRIGGER_SEQUENCE,
+    COMS_TX_SET_ARMED,
+    COMS_TX_SET_VISUAL_TEST,
+    COMS_TX_SET_PROPULSION,
+    COMS_TX_PING,
+    COMS_TX_STATUS_RESYNC,
+    COMS_TX_SUBSCRIBE,
+    COMS_TX_STATUS_POLL,
+    COMS_TX_KIND_COUNT,
+};
+
+const ComsTxClass COMS_TX_KIND_CLASSES[COMS_TX_KIND_COUNT] =
+{
+    COMS_TX_CLASS_ABORT,      // COMS_TX_ABORT_SEQUENCE
+    COMS_TX_CLASS_COMMAND,    // COMS_TX_TRIGGER_SEQUENCE
+    COMS_TX_CLASS_COMMAND,    // COMS_TX_SET_ARMED
+    COMS_TX_CLASS_COMMAND,    // COMS_TX_SET_VISUAL_TEST
+    COMS_TX_CLASS_PROPULSION, // COMS_TX_SET_PROPULSION
+    COMS_TX_CLASS_PING,       // COMS_TX_PING
+    COMS_TX_CLASS_STATUS,     // COMS_TX_STATUS_RESYNC
+    COMS_TX_CLASS_STATUS,     // COMS_TX_SUBSCRIBE
+    COMS_TX_CLASS_STATUS,     // COMS_TX_STATUS_POLL
+};
+
+// The transmit queue, one entry per kind of message so a request made again while it is queued is merged into it
+struct ComsTxEntry_t
+{
+    bool queued;
+    uint32_t queuedMicros; // When the request was first due
+};
+
+ComsTxEntry_t ComsTxQueue[COMS_TX_KIND_COUNT];
+
+// The status subscription, the status is polled until a full status says the aggregator took the subscription up
+bool ComsStatusSubscribed = false;
+bool ComsStatusResyncRequested = false;
+bool ComsStatusResyncPending = false; // Until the full status comes in, deltas are dropped
+uint32_t ComsStatusVersion = 0;
+uint32_t ComsLastSubscribeMillis = 0;
+uint32_t ComsLastStatusSnapshotMillis = 0;
+
+// The propulsion update count of the last values sent, and the achieved rate window
+uint32_t ComsPropulsionSentUpdateCount = 0;
+uint32_t ComsPropulsionWindowStartMillis = 0;
+uint32_t ComsPropulsionWindowSent = 0;
+
+void comsWrite();
+void comsReceiveByte(uint8_t data, SystemStatus_t *systemStatus, uint32_t timeMillis, uint32_t timeMicros, bool *updated);
+bool comsApplyReply(SystemStatus_t *systemStatus, const JoystickReplyMessage *reply, uint32_t timeMillis, uint32_t timeMicros);
+void comsApplySystemStatus(SystemStatus_t *systemStatus, const SystemStatusReply *reply, uint32_t timeMillis);
+void comsApplyStatusDelta(SystemStatus_t *systemStatus, const SystemStatusDelta *delta, uint32_t timeMillis);
+void comsNotify(SystemStatus_t *systemStatus, UxNotificationType type, uint32_t timeMillis);
+bool comsPropulsionDue(SystemStatus_t *systemStatus, uint32_t timeMillis, bool *keepalive);
+int comsTxNext(uint32_t timeMicros);
+bool comsTxDue(ComsTxKind kind, SystemStatus_t *systemStatus, uint32_t timeMillis);
+void comsTxBuild(ComsTxKind kind, SystemStatus_t *systemStatus, JoystickMessage *message, uint32_t *traceId);
+void comsTxSent(ComsTxKind kind, SystemStatus_t *systemStatus, const JoystickMessage *message, uint32_t timeMillis, uint32_t timeMicros);
+void comsPropulsionSent(SystemStatus_t *systemStatus, uint32_t timeMillis, bool keepalive);
+
+
+void comsInit(const ComsPort_t *port)
+{
+    ComsPort = port;
+    ComsTxLength = 0;
+    ComsTxPosition = 0;
+    ComsRxLength = 0;
+    ComsRxBlockRemaining = 0;
+    ComsRxZeroPending = false;
+    ComsRxStarted = false;
+    ComsRxOverflow = false;
+    ComsPropulsionSentUpdateCount = 0;
+    ComsPropulsionWindowStartMillis = 0;
+    ComsPropulsionWindowSent = 0;
+    ComsStatusSubscribed = false;
+    ComsStatusResyncRequested = false;
+    ComsStatusResyncPending = false;
+    memset(ComsTxQueue, 0, sizeof(ComsTxQueue));
+    memset(&ComsStats, 0, sizeof(ComsStats));
+    linkStatsReset();
+}
+
+bool comsSend(const JoystickMessage *message, uint32_t traceId)
+{
+    if (ComsTxLength != 0)
+    {
+        return false;
+    }
+
+    pb_ostream_t stream = pb_ostream_from_buffer(ComsTxMessage, sizeof(ComsTxMessage));
+    if (!pb_encode(&stream, JoystickMessage_fields, message))
+    {
+        return false;
+    }
+
+    // COBS: every block is a code byte (the distance to the next 0, or 0xFF for 254 bytes without one) and the bytes up to it
+    int codeIndex = 0;
+    uint8_t code = 1;
+    int length = 1;
+    for (size_t i = 0; i < stream.bytes_written; i++)
+    {
+        if (ComsTxMessage[i] == 0)
+        {
+            ComsTxFrame[codeIndex] = code;
+            codeIndex = length++;
+            code = 1;
+            continue;
+        }
+
+        ComsTxFrame[length++] = ComsTxMessage[i];
+        code++;
+        if (code == 0xFF)
+        {
+            ComsTxFrame[codeIndex] = code;
+            codeIndex = length++;
+            code = 1;
+        }
+    }
+    ComsTxFrame[codeIndex] = code;
+    ComsTxFrame[length++] = COMS_FRAME_DELIMITER;
+
+    ComsTxLength = length;
+    ComsTxPosition = 0;
+    ComsTxMessageTag = message->which_message;
+    ComsTxTraceId = traceId;
+    if (traceId != 0 && ComsPort->traced != NULL)
+    {
+        ComsPort->traced(ComsTxMessageTag, traceId, false);
+    }
+
+    // Start writing right away, the rest goes out in the next updates
+    comsWrite();
+    return true;
+}
+
+bool comsIsSending()
+{
+    return ComsTxLength != 0;
+}
+
+void comsWrite()
+{
+    if (ComsTxLength == 0)
+    {
+        return;
+    }
+
+    int written = ComsPort->write(ComsTxFrame + ComsTxPosition, ComsTxLength - ComsTxPosition);
+    if (written > 0)
+    {
+        ComsTxPosition += written;
+    }
+    if (ComsTxPosition < ComsTxLength)
+    {
+        return;
+    }
+
+    ComsTxLength = 0;
+    ComsStats.framesSent++;
+    if (ComsTxTraceId != 0 && ComsPort->traced != NULL)
+    {
+        ComsPort->traced(ComsTxMessageTag, ComsTxTraceId, true);
+    }
+}
+
+bool comsUpdate(SystemStatus_t *systemStatus, uint32_t timeMillis, uint32_t timeMicros)
+{
+    comsWrite();
+
+    bool updated = false;
+    uint8_t data[COMS_MAX_READ_PER_UPDATE];
+    int length = ComsPort->read(data, sizeof(data));
+    for (int i = 0; i < length; i++)
+    {
+        comsReceiveByte(data[i], systemStatus, timeMillis, timeMicros, &updated);
+    }
+
+    // The connection is lost once the aggregator stops replying to pings, the pings still out never will be
+    if (systemStatus->isConnected && linkStatsUpdate(timeMicros))
+    {
+        linkStatsClearInFlight();
+        ComsStatusSubscribed = false;
+        systemStatus->isConnected = false;
+        systemStatus->isConnectionLost = true;
+        faultLogAdd(FAULT_SOURCE_LINK, "Aggregator connection lost", timeMillis);
+        comsNotify(systemStatus, UX_NOTIFICATION_CONNECTION_LOST, timeMillis);
+        updated = true;
+    }
+
+    // Without the periodic full status the subscription is gone (the aggregator restarted), go back to polling
+    if (ComsStatusSubscribed && timeMillis - ComsLastStatusSnapshotMillis >= COMS_STATUS_SNAPSHOT_TIMEOUT)
+    {
+        ComsStatusSubscribed = false;
+    }
+    return updated;
+}
+
+void comsReceiveByte(uint8_t data, SystemStatus_t *systemStatus, uint32_t timeMillis, uint32_t timeMicros, bool *updated)
+{
+    // A delimiter ends the frame, which is only complete if its last block is
+    if (data == COMS_FRAME_DELIMITER)
+    {
+        if (ComsRxStarted)
+        {
+            pb_istream_t stream = pb_istream_from_buffer(ComsRxMessage, ComsRxLength);
+            if (ComsRxOverflow || ComsRxBlockRemaining != 0 || !pb_decode(&stream, JoystickReplyMessage_fields, &ComsReply))
+            {
+                ComsStats.badFrames++;
+            }
+            else
+            {
+                ComsStats.framesReceived++;
+                *updated |= comsApplyReply(systemStatus, &ComsReply, timeMillis, timeMicros);
+            }
+        }
+        ComsRxLength = 0;
+        ComsRxBlockRemaining = 0;
+        ComsRxZeroPending = false;
+        ComsRxStarted = false;
+        ComsRxOverflow = false;
+        return;
+    }
+
+    // Otherwise the byte is either the code of the next block, which puts back the 0 the last block ended with, or data
+    bool append = true;
+    if (ComsRxBlockRemaining == 0)
+    {
+        append = ComsRxZeroPending;
+        ComsRxZeroPending = data != 0xFF;
+        ComsRxBlockRemaining = data - 1;
+        ComsRxStarted = true;
+        data = 0;
+    }
+    else
+    {
+        ComsRxBlockRemaining--;
+    }
+
+    if (append)
+    {
+        if (ComsRxLength < COMS_MAX_RX_MESSAGE_SIZE)
+        {
+            ComsRxMessage[ComsRxLength++] = data;
+        }
+        else
+        {
+            ComsRxOverflow = true;
+        }
+    }
+}
+
+bool comsApplyReply(SystemStatus_t *systemStatus, const JoystickReplyMessage *reply, uint32_t timeMillis, uint32_t timeMicros)
+{
+    // Any parsable reply means the aggregator is there
+    systemStatus->lastMessageReceivedMillis = timeMillis;
+    if (!systemStatus->isConnected)
+    {
+        systemStatus->isConnected = true;
+        systemStatus->isConnectionLost = false;
+        comsNotify(systemStatus, UX_NOTIFICATION_CONNECTED, timeMillis);
+    }
+
+    switch (reply->which_message)
+    {
+        case JoystickReplyMessage_ping_reply_tag:
+        {
+            // Replies to pings that are no longer in flight don't have a round trip
+            uint32_t roundtripMicros = linkStatsPingReplied(reply->message.ping_reply.iteration, timeMicros);
+            if (roundtripMicros != 0)
+            {
+                systemStatus->lastPingRoundtripMillis = (roundtripMicros + 500) / 1000;
+            }
+            break;
+        }
+
+        case JoystickReplyMessage_system_status_reply_tag:
+            comsApplySystemStatus(systemStatus, &reply->message.system_status_reply, timeMillis);
+            break;
+
+        case JoystickReplyMessage_system_status_delta_tag:
+            // Only the fields that changed are applied, a delta that doesn't start from the current version means one was missed
+            // Deltas before the next full status are dropped, that status brings everything up to date
+            if (!ComsStatusSubscribed || ComsStatusResyncPending)
+            {
+                break;
+            }
+            if (reply->message.system_status_delta.base_version != ComsStatusVersion)
+            {
+                ComsStatusResyncRequested = true;
+                ComsStatusResyncPending = true;
+                ComsStats.statusResyncs++;
+                break;
+            }
+            comsApplyStatusDelta(systemStatus, &reply->message.system_status_delta, timeMillis);
+            ComsStatusVersion = reply->message.system_status_delta.version;
+            ComsStats.statusDeltas++;
+            break;
+
+        case JoystickReplyMessage_fault_event_tag:
+            faultLogAdd(FAULT_SOURCE_AGGREGATOR, reply->message.fault_event.fault_message, timeMillis);
+            comsNotify(systemStatus, UX_NOTIFICATION_FAULT, timeMillis);
+            break;
+
+        default:
+            // Ignition events aren't shown yet
+            break;
+    }
+    return true;
+}
+
+void comsApplySystemStatus(SystemStatus_t *systemStatus, const SystemStatusReply *reply, uint32_t timeMillis)
+{
+    // A full status is applied as a delta that carries every field
+    SystemStatusDelta delta = SystemStatusDelta_init_zero;
+    const IgnitorSystemStatus *ignitors = &reply->igniors_status;
+    delta.has_aggregator_armed = true;
+    delta.aggregator_armed = ignitors->aggregator_armed;
+    delta.has_aggregator_physically_armed = true;
+    delta.aggregator_physically_armed = ignitors->aggregator_physically_armed;
+    delta.has_controllers_connected = true;
+    delta.has_controllers_physically_armed = true;
+    for (int i = 0; i < IGNIOR_CONTROLLER_COUNT; i++)
+    {
+        if (i < ignitors->controllers_connected_count && ignitors->controllers_connected[i])
+        {
+            delta.controllers_connected |= 1 << i;
+        }
+        if (i < ignitors->controllers_physically_armed_count && ignitors->controllers_physically_armed[i])
+        {
+            delta.controllers_physically_armed |= 1 << i;
+        }
+    }
+
+    const SequencerSystemStatus *sequencer = &reply->sequencer_status;
+    delta.has_sequencer_connected = true;
+    delta.sequencer_connected = sequencer->controller_connected;
+    delta.has_sequence_running = true;
+    delta.sequence_running = sequencer->sequence_running;
+    delta.has_sequence_abort = true;
+    delta.sequence_abort = sequencer->sequence_abort;
+    delta.has_sequence_count = true;
+    delta.sequence_count = sequencer->sequence_count;
+    delta.has_sequence_id = true;
+    delta.sequence_id = sequencer->sequence_id;
+    delta.has_sequence_frame = true;
+    delta.sequence_frame = sequencer->sequence_frame;
+    delta.has_sequence_frame_count = true;
+    delta.sequence_frame_count = sequencer->sequence_frame_count;
+
+    delta.has_visual_test_enabled = true;
+    delta.visual_test_enabled = reply->visual_test_enabled;
+    comsApplyStatusDelta(systemStatus, &delta, timeMillis);
+
+    // Only the aggregator knows whether the subscribe arrived, a reply to a poll sent before it says not yet
+    // The deltas it pushes start from this version
+    ComsStats.statusSnapshots++;
+    ComsStatusVersion = reply->version;
+    ComsStatusSubscribed = reply->subscribed && reply->version != 0;
+    ComsStatusResyncPending = false;
+    ComsLastStatusSnapshotMillis = timeMillis;
+}
+
+void comsApplyStatusDelta(SystemStatus_t *systemStatus, const SystemStatusDelta *delta, uint32_t timeMillis)
+{
+    // Ignitors
+    bool wasSoftwareArmed = systemStatus->isSoftwareArmed;
+    if (delta->has_aggregator_armed)
+    {
+        systemStatus->isSoftwareArmed = delta->aggregator_armed;
+    }
+    if (delta->has_aggregator_physically_armed)
+    {
+        systemStatus->isPhysicallyArmed = delta->aggregator_physically_armed;
+    }
+    systemStatus->areAllIgnitorsControllersConnected = true;
+    systemStatus->areAnyIgnitorsControllersLost = false;
+    systemStatus->areAllIgnitorsPhysicallyArmed = true;
+    for (int i = 0; i < IGNIOR_CONTROLLER_COUNT; i++)
+    {
+        if (delta->has_controllers_connected)
+        {
+            bool connected = (delta->controllers_connected >> i) & 1;
+            if (systemStatus->ignitorControllersConnected[i] != connected)
+            {
+                systemStatus->ignitorControllersLostConnection[i] = !connected;
+            }
+            systemStatus->ignitorControllersConnected[i] = connected;
+        }
+        if (delta->has_controllers_physically_armed)
+        {
+            systemStatus->ignitorControllersPhysicallyArmed[i] = (delta->controllers_physically_armed >> i) & 1;
+        }
+
+        bool connected = systemStatus->ignitorControllersConnected[i];
+        systemStatus->areAllIgnitorsControllersConnected &= connected;
+        systemStatus->areAnyIgnitorsControllersLost |= systemStatus->ignitorControllersLostConnection[i];
+        systemStatus->areAllIgnitorsPhysicallyArmed &= connected && systemStatus->ignitorControllersPhysicallyArmed[i];
+    }
+    systemStatus->isFullyArmed = systemStatus->isSoftwareArmed && systemStatus->isPhysicallyArmed
+        && systemStatus->areAllIgnitorsPhysicallyArmed;
+    if (systemStatus->isSoftwareArmed != wasSoftwareArmed)
+    {
+        comsNotify(systemStatus, systemStatus->isSoftwareArmed ? UX_NOTIFICATION_ARMED : UX_NOTIFICATION_DISARMED, timeMillis);
+    }
+
+    // Sequencer
+    bool wasSequenceRunning = systemStatus->isSequenceRunning;
+    bool wasSequenceAborted = systemStatus->isSequenceAborted;
+    if (delta->has_sequencer_connected)
+    {
+        if (systemStatus->isSequencerConnected != delta->sequencer_connected)
+        {
+            systemStatus->isSequencerConnectionLost = !delta->sequencer_connected;
+        }
+        systemStatus->isSequencerConnected = delta->sequencer_connected;
+    }
+    if (delta->has_sequence_running)
+    {
+        systemStatus->isSequenceRunning = delta->sequence_running;
+    }
+    if (delta->has_sequence_abort)
+    {
+        systemStatus->isSequenceAborted = delta->sequence_abort;
+    }
+    if (delta->has_sequence_count)
+    {
+        systemStatus->sequenceCount = delta->sequence_count;
+    }
+    if (delta->has_sequence_id)
+    {
+        systemStatus->sequenceId = delta->sequence_id;
+    }
+    if (delta->has_sequence_frame)
+    {
+        systemStatus->sequenceFrame = delta->sequence_frame;
+    }
+    if (delta->has_sequence_frame_count)
+    {
+        systemStatus->sequenceFrameCount = delta->sequence_frame_count;
+    }
+    if (systemStatus->isSequenceAborted && !wasSequenceAborted)
+    {
+        comsNotify(systemStatus, UX_NOTIFICATION_SEQUENCE_ABORTED, timeMillis);
+    }
+    else if (systemStatus->isSequenceRunning && !wasSequenceRunning)
+    {
+        comsNotify(systemStatus, UX_NOTIFICATION_SEQUENCE_TRIGGERED, timeMillis);
+    }
+
+    // A visual test change the UX hasn't sent yet isn't undone by an older status
+    if (delta->has_visual_test_enabled && !systemStatus->visualTestUpdateRequested)
+    {
+        systemStatus->isVisualTestEnabled = delta->visual_test_enabled;
+    }
+}
+
+void comsNotify(SystemStatus_t *systemStatus, UxNotificationType type, uint32_t timeMillis)
+{
+    // The hold to trigger notification stays up while the trigger buttons are held
+    if (systemStatus->notificationType == UX_NOTIFICATION_HOLD_TO_TRIGGER)
+    {
+        return;
+    }
+    systemStatus->notificationType = type;
+    systemStatus->notificationStartMillis = timeMillis;
+}
+
+void comsSendRequests(SystemStatus_t *systemStatus, uint32_t timeMillis, uint32_t timeMicros)
+{
+    uint32_t windowMillis = timeMillis - ComsPropulsionWindowStartMillis;
+    if (windowMillis >= COMS_PROPULSION_RATE_WINDOW)
+    {
+        ComsStats.propulsionRate = ComsPropulsionWindowSent * 1000 / windowMillis;
+        ComsPropulsionWindowStartMillis = timeMillis;
+        ComsPropulsionWindowSent = 0;
+    }
+
+    // Requests that became due join the queue, a request that is already queued keeps its place (and its queue time)
+    for (int kind = 0; kind < COMS_TX_KIND_COUNT; kind++)
+    {
+        ComsTxEntry_t *entry = &ComsTxQueue[kind];
+        bool due = comsTxDue((ComsTxKind)kind, systemStatus, timeMillis);
+        if (due && !entry->queued)
+        {
+            entry->queuedMicros = timeMicros;
+        }
+        entry->queued = due;
+    }
+
+    if (comsIsSending())
+    {
+        return;
+    }
+
+    int kind = comsTxNext(timeMicros);
+    if (kind < 0)
+    {
+        return;
+    }
+
+    // The message is built when it is sent so it carries the latest values
+    JoystickMessage message = JoystickMessage_init_zero;
+    uint32_t traceId = 0;
+    comsTxBuild((ComsTxKind)kind, systemStatus, &message, &traceId);
+    if (!comsSend(&message, traceId))
+    {
+        return;
+    }
+
+    ComsTxEntry_t *entry = &ComsTxQueue[kind];
+    ComsTxClassStats_t *classStats = &ComsStats.txClasses[COMS_TX_KIND_CLASSES[kind]];
+    uint32_t queueMicros = timeMicros - entry->queuedMicros;
+    classStats->sent++;
+    classStats->totalQueueMicros += queueMicros;
+    if (queueMicros > classStats->maxQueueMicros)
+    {
+        classStats->maxQueueMicros = queueMicros;
+    }
+    if (queueMicros >= COMS_TX_MAX_QUEUE_MICROS)
+    {
+        classStats->aged++;
+    }
+    entry->queued = false;
+    comsTxSent((ComsTxKind)kind, systemStatus, &message, timeMillis, timeMicros);
+}
+
+int comsTxNext(uint32_t timeMicros)
+{
+    // Aborts and then commands never wait behind anything else, the kinds are in priority order
+    for (int kind = 0; kind < COMS_TX_KIND_COUNT && COMS_TX_KIND_CLASSES[kind] <= COMS_TX_CLASS_COMMAND; kind++)
+    {
+        if (ComsTxQueue[kind].queued)
+        {
+            return kind;
+        }
+    }
+
+    // Then pings and status requests that waited past the bound (the oldest first) go ahead of propulsion,
+    // which is always due while the sticks are moving and would otherwise hold them up for good
+    int next = -1;
+    uint32_t longestMicros = 0;
+    for (int kind = 0; kind < COMS_TX_KIND_COUNT; kind++)
+    {
+        uint32_t queueMicros = timeMicros - ComsTxQueue[kind].queuedMicros;
+        if (ComsTxQueue[kind].queued && COMS_TX_KIND_CLASSES[kind] > COMS_TX_CLASS_PROPULSION && queueMicros >= COMS_TX_MAX_QUEUE_MICROS
+            && (next < 0 || queueMicros > longestMicros))
+        {
+            next = kind;
+            longestMicros = queueMicros;
+        }
+    }
+    if (next >= 0)
+    {
+        return next;
+    }
+
+    // Otherwise strict priority, the kinds are in priority order
+    for (int kind = 0; kind < COMS_TX_KIND_COUNT; kind++)
+    {
+        if (ComsTxQueue[kind].queued)
+        {
+            return kind;
+        }
+    }
+    return -1;
+}
+
+bool comsTxDue(ComsTxKind kind, SystemStatus_t *systemStatus, uint32_t timeMillis)
+{
+    bool keepalive;
+    switch (kind)
+    {
+        case COMS_TX_ABORT_SEQUENCE:
+            return systemStatus->sequenceAbortRequested;
+        case COMS_TX_TRIGGER_SEQUENCE:
+            return systemStatus->sequenceTriggerRequested;
+        case COMS_TX_SET_ARMED:
+            return systemStatus->softwareArmUpdateRequested;
+        case COMS_TX_SET_VISUAL_TEST:
+            return systemStatus->visualTestUpdateRequested;
+        case COMS_TX_SET_PROPULSION:
+            return comsPropulsionDue(systemStatus, timeMillis, &keepalive);
+        case COMS_TX_PING:
+            return systemStatus->isConnected && timeMillis - systemStatus->lastPingSentMillis >= COMS_PING_INTERVAL;
+        case COMS_TX_STATUS_RESYNC:
+            return ComsStatusResyncRequested;
+        case COMS_TX_SUBSCRIBE:
+            return systemStatus->isConnected && !ComsStatusSubscribed && timeMillis - ComsLastSubscribeMillis >= COMS_SUBSCRIBE_RETRY_INTERVAL;
+        case COMS_TX_STATUS_POLL:
+            return !ComsStatusSubscribed && timeMillis - ComsLastStatusRequestMillis >= COMS_STATUS_REQUEST_INTERVAL;
+        default:
+            return false;
+    }
+}
+
+void comsTxBuild(ComsTxKind kind, SystemStatus_t *systemStatus, JoystickMessage *message, uint32_t *traceId)
+{
+    switch (kind)
+    {
+        case COMS_TX_ABORT_SEQUENCE:
+            message->which_message = JoystickMessage_abort_sequence_tag;
+            break;
+
+        case COMS_TX_TRIGGER_SEQUENCE:
+            message->which_message = JoystickMessage_trigger_sequence_tag;
+            snprintf(message->message.trigger_sequence.id, sizeof(message->message.trigger_sequence.id), "%lu", (unsigned long)systemStatus->sequenceId);
+            message->message.trigger_sequence.frame = systemStatus->sequenceFrame;
+            *traceId = systemStatus->sequenceTriggerTraceId;
+            break;
+
+        case COMS_TX_SET_ARMED:
+            message->which_message = JoystickMessage_set_system_armed_tag;
+            message->message.set_system_armed.armed = systemStatus->requestedArmState;
+            break;
+
+        case COMS_TX_SET_VISUAL_TEST:
+            message->which_message = JoystickMessage_set_visual_test_tag;
+            message->message.set_visual_test.enable = systemStatus->isVisualTestEnabled;
+            message->message.set_visual_test.type = (VisualTestType)systemStatus->visualTestType;
+            break;
+
+        case COMS_TX_SET_PROPULSION:
+            // Keepalives don't carry a trace
+            message->which_message = JoystickMessage_set_propulsion_tag;
+            message->message.set_propulsion.left = systemStatus->propulsionLeft;
+            message->message.set_propulsion.right = systemStatus->propulsionRight;
+            *traceId = systemStatus->propulsionUpdateRequested ? systemStatus->propulsionTraceId : 0;
+            break;
+
+        case COMS_TX_PING:
+            message->which_message = JoystickMessage_get_ping_tag;
+            message->message.get_ping.iteration = systemStatus->pingItteration + 1;
+            break;
+
+        case COMS_TX_SUBSCRIBE:
+            message->which_message = JoystickMessage_subscribe_system_status_tag;
+            message->message.subscribe_system_status.enable = true;
+            message->message.subscribe_system_status.snapshot_interval_ms = COMS_STATUS_SNAPSHOT_INTERVAL;
+            break;
+
+        default:
+            // A resync and a poll are both a status request
+            message->which_message = JoystickMessage_get_system_status_tag;
+            break;
+    }
+}
+
+void comsTxSent(ComsTxKind kind, SystemStatus_t *systemStatus, const JoystickMessage *message, uint32_t timeMillis, uint32_t timeMicros)
+{
+    switch (kind)
+    {
+        case COMS_TX_ABORT_SEQUENCE:
+            systemStatus->sequenceAbortRequested = false;
+            break;
+        case COMS_TX_TRIGGER_SEQUENCE:
+            systemStatus->sequenceTriggerRequested = false;
+            break;
+        case COMS_TX_SET_ARMED:
+            systemStatus->softwareArmUpdateRequested = false;
+            break;
+        case COMS_TX_SET_VISUAL_TEST:
+            systemStatus->visualTestUpdateRequested = false;
+            break;
+
+        case COMS_TX_SET_PROPULSION:
+        {
+            bool keepalive = !systemStatus->propulsionUpdateRequested;
+            systemStatus->propulsionUpdateRequested = false;
+            comsPropulsionSent(systemStatus, timeMillis, keepalive);
+            break;
+        }
+
+        case COMS_TX_PING:
+            systemStatus->pingItteration = message->message.get_ping.iteration;
+            systemStatus->lastPingSentMillis = timeMillis;
+            linkStatsPingSent(systemStatus->pingItteration, timeMicros);
+            break;
+
+        case COMS_TX_STATUS_RESYNC:
+            ComsStatusResyncRequested = false;
+            break;
+        case COMS_TX_SUBSCRIBE:
+            ComsLastSubscribeMillis = timeMillis;
+            break;
+        case COMS_TX_STATUS_POLL:
+            ComsLastStatusRequestMillis = timeMillis;
+            break;
+        default:
+            break;
+    }
+}
+
+bool comsPropulsionDue(SystemStatus_t *systemStatus, uint32_t timeMillis, bool *keepalive)
+{
+    uint32_t elapsed = timeMillis - systemStatus->lastPropulsionMessageSentMillis;
+    *keepalive = !systemStatus->propulsionUpdateRequested;
+    return elapsed >= (*keepalive ? COMS_PROPULSION_KEEPALIVE_INTERVAL : COMS_PROPULSION_INTERVAL);
+}
+
+void comsPropulsionSent(SystemStatus_t *systemStatus, uint32_t timeMillis, bool keepalive)
+{
+    // Stay on the control rate grid while the sticks keep moving, a late send (or the first after the sticks were still)
+    // starts a new grid so it isn't followed by a burst that catches up
+    uint32_t elapsed = timeMillis - systemStatus->lastPropulsionMessageSentMillis;
+    if (!keepalive && elapsed < 2 * COMS_PROPULSION_INTERVAL)
+    {
+        systemStatus->lastPropulsionMessageSentMillis += COMS_PROPULSION_INTERVAL;
+    }
+    else
+    {
+        systemStatus->lastPropulsionMessageSentMillis = timeMillis;
+    }
+
+    // Every update since the last values sent but the one that went out now was replaced before it could be sent
+    if (!keepalive)
+    {
+        ComsStats.propulsionDropped += systemStatus->propulsionUpdateCount - ComsPropulsionSentUpdateCount - 1;
+    }
+    ComsPropulsionSentUpdateCount = systemStatus->propulsionUpdateCount;
+
+    ComsStats.propulsionSent++;
+    ComsStats.propulsionKeepalives += keepalive;
+    ComsPropulsionWindowSent++;
+}
+
+ComsStats_t *comsStats()
+{
+    return &ComsStats;
+}
@@ -0,0 +1,127 @@
+#ifndef _COMS_H_
+#define _COMS_H_
+
+#include <stdint.h>
+#include "status.h"
+#include "linkStats.h"
+#include "Joystick.pb.h"
+
+// Link to the aggregator: JoystickMessage frames out and JoystickReplyMessage frames in
+// Every frame is a COBS encoded message followed by a 0 delimiter (the framing PacketSerial uses)
+// This file only depends on nanopb and the status so it also builds on a host, talking to a pty (see comsPosixOpen())
+
+// The largest frames, a COBS encoded message is at most one byte longer for every 254 bytes plus the delimiter
+const int COMS_MAX_TX_FRAME_SIZE = JoystickMessage_size + JoystickMessage_size / 254 + 2;
+const int COMS_MAX_RX_MESSAGE_SIZE = JoystickReplyMessage_size;
+
+// The most bytes read from the port in one update, so a burst of replies can't hold up the main loop
+const int COMS_MAX_READ_PER_UPDATE = 64;
+
+// How often the system status is asked for until the aggregator pushes it
+const uint32_t COMS_STATUS_REQUEST_INTERVAL = 250;
+
+// Status subscription: the aggregator pushes the fields that change and a full status every snapshot interval
+// The subscription is asked for again if it isn't taken up, or if the full status stops coming
+const uint32_t COMS_SUBSCRIBE_RETRY_INTERVAL = 1000;
+const uint32_t COMS_STATUS_SNAPSHOT_INTERVAL = 1000;
+const uint32_t COMS_STATUS_SNAPSHOT_TIMEOUT = 3 * COMS_STATUS_SNAPSHOT_INTERVAL;
+
+// How often the aggregator is pinged while it is connected
+// The connection is lost once enough pings in a row go without a reply (see linkStats.h for the adaptive timeout)
+const uint32_t COMS_PING_INTERVAL = 100;
+
+// Propulsion control rate (50Hz), the latest stick values are sent at most once per interval and values they replaced are dropped
+// While the sticks are still the values are sent again as a keepalive so the aggregator can stop the motors if the joystick goes away
+const uint32_t COMS_PROPULSION_INTERVAL = 20;
+const uint32_t COMS_PROPULSION_KEEPALIVE_INTERVAL = 200;
+
+// The window the achieved propulsion rate is measured over
+const uint32_t COMS_PROPULSION_RATE_WINDOW = 1000;
+
+// Transmit priority classes, the highest first
+// A frame that is being written is never cut short, so an abort waits for at most the one frame ahead of it
+enum ComsTxClass
+{
+    COMS_TX_CLASS_ABORT = 0,
+    COMS_TX_CLASS_COMMAND,    // Trigger, arm and visual test
+    COMS_TX_CLASS_PROPULSION,
+    COMS_TX_CLASS_PING,
+    COMS_TX_CLASS_STATUS,     // Status polls, resyncs and subscriptions
+    COMS_TX_CLASS_COUNT,
+};
+
+// A ping or status request that waited this long goes ahead of propulsion, which is sent continuously and would otherwise
+// hold them up for good. Ageing never reorders the classes above propulsion, aborts and commands always go first
+const uint32_t COMS_TX_MAX_QUEUE_MICROS = 50000;
+
+// The time the requests of a class spent queued, from when they were first due until they were sent
+struct ComsTxClassStats_t
+{
+    uint32_t sent;
+    uint32_t totalQueueMicros;
+    uint32_t maxQueueMicros;
+    uint32_t aged; // Sent after waiting past COMS_TX_MAX_QUEUE_MICROS
+};
+
+// The byte stream the link runs over, both functions must return right away
+struct ComsPort_t
+{
+    // Reads up to length bytes that were already received, returns the number of bytes read
+    int (*read)(uint8_t *data, int length);
+
+    // Writes up to length bytes, returns the number of bytes the port took
+    int (*write)(const uint8_t *data, int length);
+
+    // Called when a message sent with a latency trace id was encoded, and again when its last byte was written (can be NULL)
+    void (*traced)(pb_size_t messageTag, uint32_t traceId, bool written);
+};
+
+// Link statistics
+struct ComsStats_t
+{
+    uint32_t framesSent;
+    uint32_t framesReceived;
+    uint32_t badFrames; // Frames that were too long or didn't decode
+
+    uint32_t statusSnapshots; // Full system status replies
+    uint32_t statusDeltas; // System status deltas applied
+    uint32_t statusResyncs; // Deltas that didn't start from the current version, the full status was asked for again
+
+    uint32_t propulsionSent; // SetPropulsion messages, keepalives included
+    uint32_t propulsionKeepalives;
+    uint32_t propulsionDropped; // Propulsion values replaced by newer ones before they were sent
+    uint32_t propulsionRate; // SetPropulsion messages per second over the last rate window
+
+    ComsTxClassStats_t txClasses[COMS_TX_CLASS_COUNT];
+};
+
+// Starts the link over a port, the port must stay valid
+void comsInit(const ComsPort_t *port);
+
+// Encodes a message and starts writing it
+// Returns false if the previous message is still being written or the message doesn't encode; true otherwise
+bool comsSend(const JoystickMessage *message, uint32_t traceId = 0);
+
+// Whether or not a message is still being written
+bool comsIsSending();
+
+// Writes as much of the message being sent as the port takes, then reads and applies the replies that came in
+// The time is also given in microseconds for the ping round trips
+// Returns true if the system status changed; false otherwise
+bool comsUpdate(SystemStatus_t *systemStatus, uint32_t timeMillis, uint32_t timeMicros);
+
+// Queues the requests that are due and sends the most urgent one once the link is free (one at a time):
+// an abort, then the UX commands, the propulsion values or a keepalive, a ping and the system status requests
+void comsSendRequests(SystemStatus_t *systemStatus, uint32_t timeMillis, uint32_t timeMicros);
+
+// Gets the link statistics
+ComsStats_t *comsStats();
+
+#ifdef COMS_POSIX
+// Opens a serial device or pty (non-blocking, raw) as a port for a host build (COMS_POSIX is defined by host/CMakeLists.txt)
+// Returns false if the device couldn't be opened; true otherwise
+bool comsPosixOpen(const char *path, ComsPort_t *port);
+#endif
+
+
+#endif // end _COMS_H_
@@ -0,0 +1,43 @@
+#ifdef COMS_POSIX
+#include "coms.h"
+#include <fcntl.h>
+#include <termios.h>
+#include <unistd.h>
+
+// Host build port, so the link can be run against a pty (or a USB serial adapter) from a desktop
+int ComsPosixFile = -1;
+
+int comsPosixRead(uint8_t *data, int length)
+{
+    ssize_t count = read(ComsPosixFile, data, length);
+    return count > 0 ? count : 0;
+}
+
+int comsPosixWrite(const uint8_t *data, int length)
+{
+    ssize_t count = write(ComsPosixFile, data, length);
+    return count > 0 ? count : 0;
+}
+
+bool comsPosixOpen(const char *path, ComsPort_t *port)
+{
+    ComsPosixFile = open(path, O_RDWR | O_NOCTTY | O_NONBLOCK);
+    if (ComsPosixFile < 0)
+    {
+        return false;
+    }
+
+    // Raw bytes, no echo or line handling
+    struct termios settings;
+    if (tcgetattr(ComsPosixFile, &settings) == 0)
+    {
+        cfmakeraw(&settings);
+        tcsetattr(ComsPosixFile, TCSANOW, &settings);
+    }
+
+    port->read = comsPosixRead;
+    port->write = comsPosixWrite;
+    port->traced = NULL;
+    return true;
+}
+#endif
@@ -0,0 +1,200 @@
+#include "faultLog.h"
+#include <string.h>
+
+// A text in the string pool, null terminated, free once no entry references it
+// There are never more texts in use than entries, so every entry can have its own slot
+struct FaultLogString_t
+{
+    uint16_t offset;
+    uint8_t length;
+    uint8_t references;
+};
+
+char FaultLogPool[FAULT_LOG_POOL_SIZE];
+int FaultLogPoolUsed = 0;
+FaultLogString_t FaultLogStrings[FAULT_LOG_ENTRY_COUNT];
+
+// The entries, a ring that ends with the newest entry
+FaultLogEntry_t FaultLogEntries[FAULT_LOG_ENTRY_COUNT];
+int FaultLogNewest = FAULT_LOG_ENTRY_COUNT - 1;
+int FaultLogEntryCount = 0;
+uint32_t FaultLogTotal = 0;
+
+bool faultLogTextEquals(int slot, const char *text, int length);
+int faultLogStore(const char *text, int length);
+void faultLogDropOldest();
+void faultLogMoveToNewest(int index);
+void faultLogCompact();
+
+
+void faultLogAdd(FaultLogSource source, const char *text, uint32_t timeMillis)
+{
+    int length = strnlen(text, FAULT_LOG_MAX_LENGTH);
+    FaultLogTotal++;
+
+    // A fault already in the history is collapsed into its entry, which becomes the newest
+    // so faults that alternate don't push everything else out of the history
+    for (int index = 0; index < FaultLogEntryCount; index++)
+    {
+        const FaultLogEntry_t *entry = faultLogGet(index);
+        if (entry->source == source && faultLogTextEquals(entry->text, text, length))
+        {
+            faultLogMoveToNewest(index);
+            FaultLogEntry_t *newest = &FaultLogEntries[FaultLogNewest];
+            if (newest->repeatCount < UINT16_MAX)
+            {
+                newest->repeatCount++;
+            }
+            newest->lastMillis = timeMillis;
+            return;
+        }
+    }
+
+    if (FaultLogEntryCount == FAULT_LOG_ENTRY_COUNT)
+    {
+        faultLogDropOldest();
+    }
+
+    // Earlier entries with the same text share it
+    int slot = -1;
+    for (int i = 0; i < FAULT_LOG_ENTRY_COUNT && slot < 0; i++)
+    {
+        if (FaultLogStrings[i].references > 0 && faultLogTextEquals(i, text, length))
+        {
+            slot = i;
+            FaultLogStrings[i].references++;
+        }
+    }
+    if (slot < 0)
+    {
+        slot = faultLogStore(text, length);
+    }
+
+    FaultLogNewest = (FaultLogNewest + 1) % FAULT_LOG_ENTRY_COUNT;
+    FaultLogEntryCount++;
+    FaultLogEntry_t *newest = &FaultLogEntries[FaultLogNewest];
+    newest->text = slot;
+    newest->source = source;
+    newest->repeatCount = 1;
+    newest->firstMillis = timeMillis;
+    newest->lastMillis = timeMillis;
+}
+
+int faultLogCount()
+{
+    return FaultLogEntryCount;
+}
+
+const FaultLogEntry_t *faultLogGet(int index)
+{
+    if (index < 0 || index >= FaultLogEntryCount)
+    {
+        return NULL;
+    }
+    return &FaultLogEntries[(FaultLogNewest - index + FAULT_LOG_ENTRY_COUNT) % FAULT_LOG_ENTRY_COUNT];
+}
+
+const char *faultLogText(const FaultLogEntry_t *entry, int *length)
+{
+    const FaultLogString_t *string = &FaultLogStrings[entry->text];
+    *length = string->length;
+    return &FaultLogPool[string->offset];
+}
+
+uint32_t faultLogTotal()
+{
+    return FaultLogTotal;
+}
+
+void faultLogClear()
+{
+    memset(FaultLogStrings, 0, sizeof(FaultLogStrings));
+    FaultLogPoolUsed = 0;
+    FaultLogNewest = FAULT_LOG_ENTRY_COUNT - 1;
+    FaultLogEntryCount = 0;
+    FaultLogTotal++;
+}
+
+bool faultLogTextEquals(int slot, const char *text, int length)
+{
+    const FaultLogString_t *string = &FaultLogStrings[slot];
+    return string->length == length && memcmp(&FaultLogPool[string->offset], text, length) == 0;
+}
+
+int faultLogStore(const char *text, int length)
+{
+    // Make room at the end of the pool, first by closing the gaps texts that are no longer used left behind,
+    // then by dropping the oldest entries
+    while (FaultLogPoolUsed + length + 1 > FAULT_LOG_POOL_SIZE)
+    {
+        faultLogCompact();
+        if (FaultLogPoolUsed + length + 1 <= FAULT_LOG_POOL_SIZE || FaultLogEntryCount == 0)
+        {
+            break;
+        }
+        faultLogDropOldest();
+    }
+
+    // There is always a free slot, the new entry doesn't have one yet
+    int slot = 0;
+    while (FaultLogStrings[slot].references > 0)
+    {
+        slot++;
+    }
+
+    FaultLogString_t *string = &FaultLogStrings[slot];
+    string->offset = FaultLogPoolUsed;
+    string->length = length;
+    string->references = 1;
+    memcpy(&FaultLogPool[FaultLogPoolUsed], text, length);
+    FaultLogPool[FaultLogPoolUsed + length] = '\0';
+    FaultLogPoolUsed += length + 1;
+    return slot;
+}
+
+void faultLogDropOldest()
+{
+    const FaultLogEntry_t *oldest = faultLogGet(FaultLogEntryCount - 1);
+    FaultLogStrings[oldest->text].references--;
+    FaultLogEntryCount--;
+}
+
+void faultLogMoveToNewest(int index)
+{
+    // The entries newer than it each move one place older
+    FaultLogEntry_t entry = *faultLogGet(index);
+    for (int i = index; i > 0; i--)
+    {
+        FaultLogEntries[(FaultLogNewest - i + FAULT_LOG_ENTRY_COUNT) % FAULT_LOG_ENTRY_COUNT] = *faultLogGet(i - 1);
+    }
+    FaultLogEntries[FaultLogNewest] = entry;
+}
+
+void faultLogCompact()
+{
+    // Move the texts still in use down to the start of the pool in the order they are stored in,
+    // each one only moves down so it never overwrites a text that wasn't moved yet
+    int used = 0;
+    while (true)
+    {
+        int next = -1;
+        for (int i = 0; i < FAULT_LOG_ENTRY_COUNT; i++)
+        {
+            FaultLogString_t *string = &FaultLogStrings[i];
+            if (string->references > 0 && string->offset >= used && (next < 0 || string->offset < FaultLogStrings[next].offset))
+            {
+                next = i;
+            }
+        }
+        if (next < 0)
+        {
+            break;
+        }
+
+        FaultLogString_t *string = &FaultLogStrings[next];
+        memmove(&FaultLogPool[used], &FaultLogPool[string->offset], string->length + 1);
+        string->offset = used;
+        used += string->length + 1;
+    }
+    FaultLogPoolUsed = used;
+}
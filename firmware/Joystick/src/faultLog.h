@@ -0,0 +1,57 @@
+#ifndef _FAULT_LOG_H_
+#define _FAULT_LOG_H_
+
+#include <stdint.h>
+
+// History of the faults reported to the joystick, in fixed memory
+// Every fault text is stored once in a string pool and the entries of the history reference it,
+// a fault that repeats an entry (same source and text) bumps its repeat count and moves it to the newest place
+// This file doesn't depend on Arduino so it builds on a host with the link (see coms.h)
+
+// The number of entries kept, the oldest is dropped once it is full
+const int FAULT_LOG_ENTRY_COUNT = 16;
+
+// The size of the string pool, the oldest entries are dropped when a new text doesn't fit
+const int FAULT_LOG_POOL_SIZE = 512;
+
+// Longer texts are cut short
+const int FAULT_LOG_MAX_LENGTH = 254;
+
+// Where a fault came from
+enum FaultLogSource : uint8_t
+{
+    FAULT_SOURCE_AGGREGATOR, // A FaultEvent from the aggregator
+    FAULT_SOURCE_LINK,       // Detected by the joystick on its link to the aggregator
+    FAULT_SOURCE_COUNT,
+};
+
+struct FaultLogEntry_t
+{
+    uint8_t text; // The string pool slot of the text
+    FaultLogSource source;
+    uint16_t repeatCount; // 1 for a fault that didn't repeat
+    uint32_t firstMillis;
+    uint32_t lastMillis;
+};
+
+// Adds a fault to the history
+void faultLogAdd(FaultLogSource source, const char *text, uint32_t timeMillis);
+
+// Gets the number of entries in the history
+int faultLogCount();
+
+// Gets an entry of the history, 0 is the newest
+// Returns NULL if there is no such entry
+const FaultLogEntry_t *faultLogGet(int index);
+
+// Gets the text of an entry, which stays valid until the next fault is added
+const char *faultLogText(const FaultLogEntry_t *entry, int *length);
+
+// Gets the number of faults added (repeats included), it changes whenever the history does
+uint32_t faultLogTotal();
+
+// Clears the history
+void faultLogClear();
+
+
+#endif // end _FAULT_LOG_H_
@@ -0,0 +1,178 @@
+#include "hidCapture.h"
+
+void hidCaptureReset(HidCaptureState_t *state)
+{
+    state->started = false;
+    state->startMicros = 0;
+    for (int device = 0; device < HID_CAPTURE_MAX_DEVICES; device++)
+    {
+        state->keyframed[device] = false;
+        state->timeMicros[device] = 0;
+        state->keyframeMicros[device] = 0;
+        state->buttons[device] = 0;
+        for (int i = 0; i < JOYSTICK_AXIS_COUNT; i++)
+        {
+            state->axis[device][i] = AXIS_STICK_CENTER;
+        }
+        state->axis[device][AXIS_DPAD] = DPAD_CENTER;
+    }
+}
+
+int hidCaptureEncode(HidCaptureState_t *state, uint8_t device, uint32_t buttons, const uint8_t *axis, uint32_t reportMicros, uint8_t *buffer)
+{
+    if (device >= HID_CAPTURE_MAX_DEVICES)
+    {
+        device = HID_CAPTURE_MAX_DEVICES - 1;
+    }
+
+    // The first record starts the capture's clock
+    if (!state->started)
+    {
+        state->started = true;
+        state->startMicros = reportMicros;
+    }
+    uint32_t timeMicros = reportMicros - state->startMicros;
+
+    // Keyframes hold the whole state and their time from the start, the other records only what changed
+    bool keyframe = !state->keyframed[device] || timeMicros - state->keyframeMicros[device] >= HID_CAPTURE_KEYFRAME_INTERVAL_MICROS;
+    uint32_t elapsedMicros = keyframe ? timeMicros : timeMicros - state->timeMicros[device];
+    state->timeMicros[device] = timeMicros;
+    if (keyframe)
+    {
+        state->keyframed[device] = true;
+        state->keyframeMicros[device] = timeMicros;
+    }
+
+    // Find what changed since the device's previous report
+    bool buttonsChanged = keyframe || buttons != state->buttons[device];
+    uint8_t axesChanged = 0;
+    for (int i = 0; i < JOYSTICK_AXIS_COUNT; i++)
+    {
+        if (keyframe || axis[i] != state->axis[device][i])
+        {
+            axesChanged |= 1 << i;
+        }
+    }
+
+    int length = 0;
+    buffer[length++] = device | (keyframe ? HID_CAPTURE_KEYFRAME : 0) | (buttonsChanged ? HID_CAPTURE_BUTTONS : 0)
+        | (axesChanged != 0 ? HID_CAPTURE_AXES : 0);
+    do
+    {
+        uint8_t bits = elapsedMicros & 0x7F;
+        elapsedMicros >>= 7;
+        buffer[length++] = bits | (elapsedMicros != 0 ? 0x80 : 0);
+    } while (elapsedMicros != 0);
+
+    if (buttonsChanged)
+    {
+        for (int i = 0; i < 4; i++)
+        {
+            buffer[length++] = (buttons >> (8 * i)) & 0xFF;
+        }
+        state->buttons[device] = buttons;
+    }
+
+    if (axesChanged != 0)
+    {
+        buffer[length++] = axesChanged;
+        for (int i = 0; i < JOYSTICK_AXIS_COUNT; i++)
+        {
+            if (axesChanged & (1 << i))
+            {
+                buffer[length++] = axis[i];
+                state->axis[device][i] = axis[i];
+            }
+        }
+    }
+    return length;
+}
+
+bool hidCaptureIsKeyframe(const uint8_t *record)
+{
+    return (record[0] & HID_CAPTURE_KEYFRAME) != 0;
+}
+
+uint8_t hidCaptureDevice(const uint8_t *record)
+{
+    return record[0] & HID_CAPTURE_DEVICE_MASK;
+}
+
+int hidCaptureDecode(HidCaptureState_t *state, const uint8_t *data, uint32_t length, HidCaptureReport_t *report)
+{
+    uint32_t position = 0;
+    if (length < 2)
+    {
+        return 0;
+    }
+
+    uint8_t flags = data[position++];
+    uint8_t device = flags & HID_CAPTURE_DEVICE_MASK;
+    if (device >= HID_CAPTURE_MAX_DEVICES)
+    {
+        return 0;
+    }
+
+    // Read the time since the device's previous record (or the start of the capture)
+    uint32_t elapsedMicros = 0;
+    for (int shift = 0; ; shift += 7)
+    {
+        if (position >= length || shift > 28)
+        {
+            return 0;
+        }
+        uint8_t bits = data[position++];
+        elapsedMicros |= (uint32_t)(bits & 0x7F) << shift;
+        if (!(bits & 0x80))
+        {
+            break;
+        }
+    }
+
+    // Read the changes, but only apply them to the state once the whole record is known to be there
+    uint32_t buttons = state->buttons[device];
+    if (flags & HID_CAPTURE_BUTTONS)
+    {
+        if (position + 4 > length)
+        {
+            return 0;
+        }
+        buttons = 0;
+        for (int i = 0; i < 4; i++)
+        {
+            buttons |= (uint32_t)data[position++] << (8 * i);
+        }
+    }
+
+    uint8_t axis[JOYSTICK_AXIS_COUNT];
+    memcpy(axis, state->axis[device], sizeof(axis));
+    if (flags & HID_CAPTURE_AXES)
+    {
+        if (position >= length)
+        {
+            return 0;
+        }
+        uint8_t axesChanged = data[position++];
+        for (int i = 0; i < JOYSTICK_AXIS_COUNT; i++)
+        {
+            if (axesChanged & (1 << i))
+            {
+                if (position >= length)
+                {
+                    return 0;
+                }
+                axis[i] = data[position++];
+            }
+        }
+    }
+
+    state->timeMicros[device] = (flags & HID_CAPTURE_KEYFRAME) ? elapsedMicros : state->timeMicros[device] + elapsedMicros;
+    state->buttons[device] = buttons;
+    memcpy(state->axis[device], axis, sizeof(axis));
+
+    report->timeMicros = state->timeMicros[device];
+    report->device = device;
+    report->buttons = buttons;
+    memcpy(report->axis, axis, sizeof(axis));
+    return position;
+}
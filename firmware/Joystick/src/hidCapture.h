@@ -0,0 +1,81 @@
+#ifndef _HID_CAPTURE_H_
+#define _HID_CAPTURE_H_
+
+#include <Arduino.h>
+#include "joystickHid.h"
+
+// The number of joysticks a capture can tell apart
+const int HID_CAPTURE_MAX_DEVICES = JOYSTICK_SLOT_COUNT;
+
+// The largest capture record (flags, a 5 byte time, the buttons, the axis mask and every axis)
+const int HID_CAPTURE_MAX_RECORD_SIZE = 1 + 5 + 4 + 1 + JOYSTICK_AXIS_COUNT;
+
+// How often each device gets a keyframe, a record with its whole state
+const uint32_t HID_CAPTURE_KEYFRAME_INTERVAL_MICROS = 100000;
+
+// Capture record flags, the low bits of the flags byte are the device index
+const uint8_t HID_CAPTURE_DEVICE_MASK = 0x0F;
+const uint8_t HID_CAPTURE_BUTTONS = 0x10;
+const uint8_t HID_CAPTURE_AXES = 0x20;
+const uint8_t HID_CAPTURE_KEYFRAME = 0x40;
+
+//
+// A capture is a sequence of records, one for every joystick report:
+//   1 byte     flags (the device index, whether the record is a keyframe and what it holds)
+//   1-5 bytes  microseconds since the device's previous record, or since the start of the capture for keyframes
+//              (7 bits per byte, least significant first, high bit set on all but the last byte)
+//   4 bytes    the buttons (little endian), if HID_CAPTURE_BUTTONS
+//   1 byte     mask of the axes that follow, then the raw value of each of them, if HID_CAPTURE_AXES
+// Records only hold what changed since the device's previous record, so the encoder and the decoder both keep the state
+// of every device. The first record of every device, then one every HID_CAPTURE_KEYFRAME_INTERVAL_MICROS, is a keyframe
+// with all of it, so a capture that lost records (the log drops them when it is full) picks each device up again at its
+// next keyframe: skip the device's records until then
+//
+
+// A joystick report, with the raw (uncalibrated) axis values
+struct HidCaptureReport_t
+{
+    // When the report was read, relative to the first record of the capture
+    uint32_t timeMicros;
+
+    uint8_t device;
+    uint32_t buttons;
+    uint8_t axis[JOYSTICK_AXIS_COUNT];
+};
+
+// The state of a capture that is being encoded or decoded
+struct HidCaptureState_t
+{
+    // Whether or not the first record has been encoded, the first record's time is the start of the capture
+    bool started;
+
+    // When the capture started (for encoding)
+    uint32_t startMicros;
+
+    // Whether or not each device has had a keyframe, and the times of its previous record and keyframe (relative to the start)
+    bool keyframed[HID_CAPTURE_MAX_DEVICES];
+    uint32_t timeMicros[HID_CAPTURE_MAX_DEVICES];
+    uint32_t keyframeMicros[HID_CAPTURE_MAX_DEVICES];
+
+    // The previous report of every device, devices start released and centered
+    uint32_t buttons[HID_CAPTURE_MAX_DEVICES];
+    uint8_t axis[HID_CAPTURE_MAX_DEVICES][JOYSTICK_AXIS_COUNT];
+};
+
+// Starts a new capture
+void hidCaptureReset(HidCaptureState_t *state);
+
+// Encodes a report read at reportMicros (the micros() clock) into the buffer, which must hold HID_CAPTURE_MAX_RECORD_SIZE bytes
+// Returns the length of the record
+int hidCaptureEncode(HidCaptureState_t *state, uint8_t device, uint32_t buttons, const uint8_t *axis, uint32_t reportMicros, uint8_t *buffer);
+
+// Gets whether or not a record is a keyframe, and the device it is for
+bool hidCaptureIsKeyframe(const uint8_t *record);
+uint8_t hidCaptureDevice(const uint8_t *record);
+
+// Decodes the next record of a capture into a full report
+// Returns the length of the record, or 0 if the data is too short to hold the record or the record is invalid
+int hidCaptureDecode(HidCaptureState_t *state, const uint8_t *data, uint32_t length, HidCaptureReport_t *report);
+
+
+#endif // end _HID_CAPTURE_H_
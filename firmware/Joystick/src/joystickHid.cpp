@@ -1,14 +1,15 @@
 #include "joystickHid.h"
+#include "logger.h"
+#include "axisCalibration.h"
+#include "hidCapture.h"
 #include "USBHost_t36.h"
 
 USBHost myusb;
 USBHub hub1(myusb);
 USBHIDParser hid1(myusb);
 
-#define COUNT_JOYSTICKS 4
-JoystickController joysticks[COUNT_JOYSTICKS] = {JoystickController(myusb), JoystickController(myusb), JoystickController(myusb), JoystickController(myusb)};
+JoystickController joysticks[JOYSTICK_SLOT_COUNT] = {JoystickController(myusb), JoystickController(myusb), JoystickController(myusb), JoystickController(myusb)};
 int user_axis[64];
-uint32_t buttons_prev = 0;
 
 USBDriver *drivers[] = {&hub1, &joysticks[0], &joysticks[1], &joysticks[2], &joysticks[3], &hid1};
 #define CNT_DEVICES (sizeof(drivers) / sizeof(drivers[0]))
@@ -20,9 +21,95 @@ USBHIDInput *hiddrivers[] = {&joysticks[0], &joysticks[1], &joysticks[2], &joyst
 #define CNT_HIDDEVICES (sizeof(hiddrivers) / sizeof(hiddrivers[0]))
 const char *hid_driver_names[CNT_DEVICES] = {"joystick[0H]", "joystick[1H]", "joystick[2H]", "joystick[3H]"};
 bool hid_driver_active[CNT_DEVICES] = {false};
-bool show_changed_only = false;
 
-int psAxis[64];
+// The state of every joystick, merged into the single control view by the merge policy
+struct JoystickSlot_t
+{
+    // Whether or not the joystick has reported since it was connected, and when it did (in activation order)
+    bool active;
+    uint32_t activation;
+
+    // Whether or not the joystick's USB driver is connected
+    bool connected;
+
+    // Whether or not every axis is read from the next report, instead of only the axes that changed
+    bool fullReadNeeded;
+
+    uint32_t buttons;
+    uint8_t rawAxis[JOYSTICK_AXIS_COUNT];
+};
+JoystickSlot_t JoystickSlots[JOYSTICK_SLOT_COUNT];
+uint32_t JoystickActivations = 0;
+JoystickMergePolicy JoystickMerge = JOYSTICK_MERGE_PRIMARY;
+int JoystickPrimarySlot = 0;
+int JoystickSecondarySlot = 1;
+
+// The latest (merged) joystick state read from the reports, and the snapshot of it last reported to the caller
+JoystickHidData_t JoystickHidLatest;
+JoystickHidData_t JoystickHidReported;
+LatencyTraceStart_t JoystickHidReportTrace; // The trace of the report being read, the id is 0 outside of joystickHidReadReport()
+LatencyTraceStart_t JoystickHidLatestTrace; // The trace of the report the latest state was merged from
+uint8_t JoystickAxisEpsilon = JOYSTICK_DEFAULT_AXIS_EPSILON;
+
+// Stick conditioning, every raw stick value is mapped through its axis' lookup table
+// The tables are only rebuilt when the calibration changes
+const int AXIS_MINIMUM_CALIBRATION_RANGE = 32; // Captured extents closer than this to the center are ignored (the stick wasn't moved that way)
+AxisCalibration_t AxisCalibrations[CALIBRATED_AXIS_COUNT];
+uint8_t AxisTables[CALIBRATED_AXIS_COUNT][256];
+uint8_t JoystickHidRawAxis[JOYSTICK_AXIS_COUNT]; // The latest raw value of each merged axis
+bool JoystickHidCalibrating = false;
+uint8_t CalibrationMinimum[CALIBRATED_AXIS_COUNT];
+uint8_t CalibrationMaximum[CALIBRATED_AXIS_COUNT];
+
+// Input events waiting for the UX, and the state they leave the buttons and the d-pad in
+JoystickEvent_t JoystickEventQueue[JOYSTICK_EVENT_QUEUE_SIZE];
+int JoystickEventHead = 0; // The oldest event in the queue
+int JoystickEventCount = 0;
+uint32_t JoystickEventsDropped = 0; // Events dropped since the last one that fit in the queue
+bool JoystickEventsQueued = false; // Whether or not events were queued during this update
+uint32_t JoystickEventButtons = 0;
+uint8_t JoystickEventDpad = DPAD_CENTER;
+
+// The buttons (and whether or not the d-pad direction) whose press was queued but whose release hasn't been yet
+// The queue always keeps a slot free for each of their releases
+uint32_t JoystickEventReleasesOwed = 0;
+bool JoystickEventDpadReleaseOwed = false;
+uint32_t ButtonPressMicros[32]; // When each button went down
+uint32_t ButtonHoldMicros[32]; // When each button last sent a hold event
+uint32_t DpadPressMicros = 0;
+
+// Capturing and replaying reports
+bool JoystickHidCapturing = false;
+HidCaptureState_t JoystickHidCapture;
+const uint8_t *ReplayCapture = NULL; // NULL when no capture is being replayed
+uint32_t ReplayLength = 0;
+uint32_t ReplayPosition = 0;
+JoystickReplaySpeed ReplaySpeed = JOYSTICK_REPLAY_REALTIME;
+uint32_t ReplayStartMicros = 0;
+HidCaptureState_t ReplayState;
+HidCaptureReport_t ReplayReport;
+bool ReplayReportPending = false; // Whether or not ReplayReport has been decoded but not read yet
+
+// Output reports, every joystick keeps the LEDs and rumble it should have and the LEDs it was last sent
+// Only the latest state is sent, at most once every JOYSTICK_OUTPUT_INTERVAL per joystick
+struct JoystickOutput_t
+{
+    JoystickLeds_t buttonLeds; // The button feedback, shown while there are no status LEDs
+    JoystickLeds_t sentLeds; // A joystick that connects is taken to have its LEDs off
+
+    bool rumblePending;
+    uint8_t rumbleLeft;
+    uint8_t rumbleRight;
+    uint8_t rumbleTimeout;
+
+    uint32_t lastSentMicros;
+};
+JoystickOutput_t JoystickOutputs[JOYSTICK_SLOT_COUNT];
+JoystickLeds_t JoystickStatusLeds;
+bool JoystickStatusLedsSet = false;
+uint32_t JoystickOutputBusMicros = 0; // When an output report was last sent to any joystick
+int JoystickOutputNext = 0; // The joystick that is looked at first, so every joystick gets its turn
+JoystickOutputStats_t JoystickOutputStats;
 
 #define NUMFLAKES 10
 #define XPOS 0
@@ -33,125 +120,747 @@ int psAxis[64];
 #define LOGO16_GLCD_WIDTH 16
 
 
-void PrintDeviceListChanges();
+bool PrintDeviceListChanges();
+void joystickHidQueueEdges(uint32_t buttons, uint8_t dpad, uint32_t timeMicros);
+void joystickHidQueueHolds(uint32_t timeMicros);
+bool joystickHidNextHold(uint32_t *holdMicros);
+void joystickHidReadReport(uint8_t device, uint32_t buttons, const uint8_t *rawAxis, uint32_t reportMicros);
+uint32_t joystickHidReplayReports(uint32_t updateMicros);
+void joystickHidMerge(uint32_t timeMicros);
+bool joystickHidIsConnected(int slot);
+void joystickHidSetButtonLeds(int slot, uint32_t buttons);
+void joystickHidSendOutputs(uint32_t timeMicros);
 
 
 
 void joystickHidInit()
 {
     myusb.begin();
+
+    // Until a joystick reports in, the sticks are centered and the d-pad isn't pressed
+    memset(&JoystickHidLatest, 0, sizeof(JoystickHidLatest));
+    for (int i = 0; i < JOYSTICK_AXIS_COUNT; i++)
+    {
+        JoystickHidLatest.axis[i] = AXIS_STICK_CENTER;
+    }
+    JoystickHidLatest.axis[AXIS_DPAD] = DPAD_CENTER;
+    JoystickHidReported = JoystickHidLatest;
+    memcpy(JoystickHidRawAxis, JoystickHidLatest.axis, sizeof(JoystickHidRawAxis));
+    for (int slot = 0; slot < JOYSTICK_SLOT_COUNT; slot++)
+    {
+        memset(&JoystickSlots[slot], 0, sizeof(JoystickSlot_t));
+        memcpy(JoystickSlots[slot].rawAxis, JoystickHidLatest.axis, sizeof(JoystickSlots[slot].rawAxis));
+        JoystickSlots[slot].fullReadNeeded = true;
+    }
+
+    // Condition the sticks with the saved calibration, if there is one
+    for (int i = 0; i < CALIBRATED_AXIS_COUNT; i++)
+    {
+        AxisCalibrations[i] = AXIS_DEFAULT_CALIBRATION;
+    }
+    axisCalibrationLoad(AxisCalibrations);
+    for (int i = 0; i < CALIBRATED_AXIS_COUNT; i++)
+    {
+        axisCalibrationBuildTable(&AxisCalibrations[i], AxisTables[i]);
+    }
+}
+
+void joystickHidApplyCalibration(int axis)
+{
+    // Rebuild the axis' table and recondition its latest value so the change shows up right away
+    axisCalibrationBuildTable(&AxisCalibrations[axis], AxisTables[axis]);
+    JoystickHidLatest.axis[axis] = AxisTables[axis][JoystickHidRawAxis[axis]];
+}
+
+void joystickHidSetAxisResponse(int axis, uint8_t deadzone, uint8_t expo, bool inverted)
+{
+    if (axis < 0 || axis >= CALIBRATED_AXIS_COUNT)
+    {
+        return;
+    }
+
+    AxisCalibrations[axis].deadzone = deadzone;
+    AxisCalibrations[axis].expo = expo;
+    AxisCalibrations[axis].inverted = inverted;
+    joystickHidApplyCalibration(axis);
+}
+
+void joystickHidBeginCalibration()
+{
+    // The sticks are at rest, so their centers are the current raw values
+    for (int i = 0; i < CALIBRATED_AXIS_COUNT; i++)
+    {
+        AxisCalibrations[i].center = JoystickHidRawAxis[i];
+        CalibrationMinimum[i] = JoystickHidRawAxis[i];
+        CalibrationMaximum[i] = JoystickHidRawAxis[i];
+    }
+    JoystickHidCalibrating = true;
+}
+
+void joystickHidEndCalibration()
+{
+    JoystickHidCalibrating = false;
+    for (int i = 0; i < CALIBRATED_AXIS_COUNT; i++)
+    {
+        AxisCalibration_t *calibration = &AxisCalibrations[i];
+        if (calibration->center - CalibrationMinimum[i] >= AXIS_MINIMUM_CALIBRATION_RANGE)
+        {
+            calibration->minimum = CalibrationMinimum[i];
+        }
+        if (CalibrationMaximum[i] - calibration->center >= AXIS_MINIMUM_CALIBRATION_RANGE)
+        {
+            calibration->maximum = CalibrationMaximum[i];
+        }
+        calibration->minimum = min(calibration->minimum, calibration->center);
+        calibration->maximum = max(calibration->maximum, calibration->center);
+        joystickHidApplyCalibration(i);
+    }
+    axisCalibrationSave(AxisCalibrations);
+}
+
+bool joystickHidIsCalibrating()
+{
+    return JoystickHidCalibrating;
+}
+
+void joystickHidSetCapture(bool enabled)
+{
+    // Every capture starts over, so the first record of each device is a keyframe
+    if (enabled && !JoystickHidCapturing)
+    {
+        hidCaptureReset(&JoystickHidCapture);
+    }
+    JoystickHidCapturing = enabled;
+}
+
+void joystickHidSetStatusLeds(const JoystickLeds_t *leds)
+{
+    bool set = leds != NULL;
+    if (set == JoystickStatusLedsSet && (!set || memcmp(leds, &JoystickStatusLeds, sizeof(JoystickLeds_t)) == 0))
+    {
+        return;
+    }
+
+    JoystickStatusLedsSet = set;
+    if (set)
+    {
+        JoystickStatusLeds = *leds;
+    }
+    for (int slot = 0; slot < JOYSTICK_SLOT_COUNT; slot++)
+    {
+        if (joystickHidIsConnected(slot))
+        {
+            JoystickOutputStats.requested++;
+        }
+    }
+}
+
+void joystickHidRumble(int slot, uint8_t left, uint8_t right, uint8_t timeoutMillis)
+{
+    for (int i = 0; i < JOYSTICK_SLOT_COUNT; i++)
+    {
+        if ((slot == -1 || slot == i) && joystickHidIsConnected(i))
+        {
+            JoystickOutput_t *output = &JoystickOutputs[i];
+            output->rumblePending = true;
+            output->rumbleLeft = left;
+            output->rumbleRight = right;
+            output->rumbleTimeout = timeoutMillis;
+            JoystickOutputStats.requested++;
+        }
+    }
 }
 
-bool joystickHidUpdate(JoystickHidData_t *joystickHidData)
+void joystickHidGetOutputStats(JoystickOutputStats_t *stats)
+{
+    *stats = JoystickOutputStats;
+}
+
+void joystickHidResetOutputStats()
+{
+    memset(&JoystickOutputStats, 0, sizeof(JoystickOutputStats));
+}
+
+void joystickHidSetMergePolicy(JoystickMergePolicy policy, int primarySlot, int secondarySlot)
+{
+    JoystickMerge = policy;
+    JoystickPrimarySlot = constrain(primarySlot, 0, JOYSTICK_SLOT_COUNT - 1);
+    JoystickSecondarySlot = constrain(secondarySlot, 0, JOYSTICK_SLOT_COUNT - 1);
+    joystickHidMerge(micros());
+}
+
+bool joystickHidGetSlot(int slot, JoystickHidData_t *joystickHidData)
+{
+    if (slot < 0 || slot >= JOYSTICK_SLOT_COUNT)
+    {
+        return false;
+    }
+
+    JoystickSlot_t *joystick = &JoystickSlots[slot];
+    joystickHidData->buttons = joystick->buttons;
+    for (int axis = 0; axis < JOYSTICK_AXIS_COUNT; axis++)
+    {
+        uint8_t raw = joystick->rawAxis[axis];
+        joystickHidData->axis[axis] = axis < CALIBRATED_AXIS_COUNT ? AxisTables[axis][raw] : raw;
+    }
+    return joystick->active;
+}
+
+void joystickHidDeactivateSlots()
+{
+    for (int slot = 0; slot < JOYSTICK_SLOT_COUNT; slot++)
+    {
+        JoystickSlots[slot].active = false;
+        JoystickSlots[slot].fullReadNeeded = true;
+    }
+}
+
+void joystickHidBeginReplay(const uint8_t *capture, uint32_t length, JoystickReplaySpeed speed)
+{
+    // The replayed joysticks take the place of the USB joysticks, which become active again once they next report
+    joystickHidDeactivateSlots();
+
+    ReplayCapture = capture;
+    ReplayLength = length;
+    ReplayPosition = 0;
+    ReplaySpeed = speed;
+    ReplayStartMicros = micros();
+    ReplayReportPending = false;
+    ReplayReport.timeMicros = 0;
+    hidCaptureReset(&ReplayState);
+}
+
+void joystickHidEndReplay()
+{
+    if (ReplayCapture != NULL)
+    {
+        ReplayCapture = NULL;
+        joystickHidDeactivateSlots();
+        joystickHidMerge(micros());
+    }
+}
+
+bool joystickHidIsReplaying()
+{
+    return ReplayCapture != NULL;
+}
+
+void joystickHidSetAxisEpsilon(uint8_t epsilon)
+{
+    JoystickAxisEpsilon = epsilon;
+}
+
+bool joystickHidNextEvent(JoystickEvent_t *event)
+{
+    if (JoystickEventCount == 0)
+    {
+        return false;
+    }
+
+    *event = JoystickEventQueue[JoystickEventHead];
+    JoystickEventHead = (JoystickEventHead + 1) % JOYSTICK_EVENT_QUEUE_SIZE;
+    JoystickEventCount--;
+    return true;
+}
+
+bool joystickHidUpdate(JoystickHidData_t *joystickHidData, JoystickHidChanges_t *joystickHidChanges)
 {
     myusb.Task();
-    PrintDeviceListChanges();
+    bool devicesChanged = PrintDeviceListChanges();
+    JoystickEventsQueued = false;
+
+    // Reports are read into the latest joystick state, which is then compared against the last reported snapshot
+    // While a capture is replayed, its reports are read instead of the reports of the USB joysticks
+    JoystickHidData_t *latest = &JoystickHidLatest;
+    uint32_t updateMicros = micros();
+    if (ReplayCapture != NULL)
+    {
+        updateMicros = joystickHidReplayReports(updateMicros);
+    }
 
-    for (int joystick_index = 0; joystick_index < COUNT_JOYSTICKS; joystick_index++)
+    for (int joystick_index = 0; joystick_index < JOYSTICK_SLOT_COUNT && ReplayCapture == NULL; joystick_index++)
     {
+        JoystickSlot_t *slot = &JoystickSlots[joystick_index];
+
+        // A joystick that was disconnected stops taking part in the control view until it reports again
+        bool connected = joystickHidIsConnected(joystick_index);
+        if (slot->connected && !connected && slot->active)
+        {
+            slot->active = false;
+            slot->fullReadNeeded = true;
+            joystickHidMerge(updateMicros);
+        }
+        slot->connected = connected;
+
         if (joysticks[joystick_index].available())
         {
+            uint32_t reportMicros = micros();
             uint64_t axis_mask = joysticks[joystick_index].axisMask();
-            uint64_t axis_changed_mask = joysticks[joystick_index].axisChangedMask();
+            uint64_t axis_changed_mask = slot->fullReadNeeded ? axis_mask : joysticks[joystick_index].axisChangedMask();
             uint32_t buttons = joysticks[joystick_index].getButtons();
-            joystickHidData->buttons = buttons;
+            bool buttonsChanged = buttons != slot->buttons;
 
-            Serial.printf("Joystick(%d): buttons = %x", joystick_index, buttons);
-            
-            if (show_changed_only)
+            // Only the axes that moved are read, the others keep their last value
+            // The first axes in the report's axis mask are the joystick axes (see AXIS_LEFT_STICK_X...)
+            uint8_t rawAxis[JOYSTICK_AXIS_COUNT];
+            memcpy(rawAxis, slot->rawAxis, sizeof(rawAxis));
+            int axis = 0;
+            for (uint8_t i = 0; axis_mask != 0 && axis < JOYSTICK_AXIS_COUNT; i++, axis_mask >>= 1, axis_changed_mask >>= 1)
             {
-                for (uint8_t i = 0; axis_changed_mask != 0; i++, axis_changed_mask >>= 1)
+                if (axis_mask & 1)
                 {
                     if (axis_changed_mask & 1)
                     {
-                        Serial.printf(" %d:%d", i, joysticks[joystick_index].getAxis(i));
+                        rawAxis[axis] = joysticks[joystick_index].getAxis(i);
+                        LOG_DEBUG(LOG_JOYSTICK_AXIS_CHANGED, joystick_index, i, rawAxis[axis]);
                     }
+                    axis++;
                 }
             }
+            slot->fullReadNeeded = false;
+            joystickHidReadReport(joystick_index, buttons, rawAxis, reportMicros);
+
+            if (buttonsChanged)
+            {
+                joystickHidSetButtonLeds(joystick_index, buttons);
+            }
+
+            joysticks[joystick_index].joystickDataClear();
+        }
+    }
+
+    // LED and rumble changes are sent after the reports are read, and only when the joysticks are due for one
+    joystickHidSendOutputs(micros());
+
+    // Buttons that are still down send hold events, even when there are no new reports
+    joystickHidQueueHolds(updateMicros);
+
+    // Find what changed since the last reported snapshot
+    JoystickHidData_t *reported = &JoystickHidReported;
+    joystickHidChanges->buttonsPressed = latest->buttons & ~reported->buttons;
+    joystickHidChanges->buttonsReleased = reported->buttons & ~latest->buttons;
+    joystickHidChanges->axesChanged = 0;
+    joystickHidChanges->devicesChanged = devicesChanged;
+    joystickHidChanges->eventsQueued = JoystickEventsQueued;
+    reported->buttons = latest->buttons;
+    for (int i = 0; i < JOYSTICK_AXIS_COUNT; i++)
+    {
+        // The d-pad is a direction rather than a position, so every change counts
+        int movement = abs((int)latest->axis[i] - (int)reported->axis[i]);
+        if (movement != 0 && (i == AXIS_DPAD || movement >= JoystickAxisEpsilon))
+        {
+            joystickHidChanges->axesChanged |= 1 << i;
+            reported->axis[i] = latest->axis[i];
+        }
+    }
+    if (joystickHidChanges->buttonsPressed != 0 || joystickHidChanges->buttonsReleased != 0 || joystickHidChanges->axesChanged != 0)
+    {
+        reported->trace = JoystickHidLatestTrace;
+        reported->trace.updatedMicros = micros();
+    }
+    *joystickHidData = *reported;
+
+    return joystickHidChanges->buttonsPressed != 0 || joystickHidChanges->buttonsReleased != 0
+        || joystickHidChanges->axesChanged != 0 || joystickHidChanges->devicesChanged || joystickHidChanges->eventsQueued;
+}
+
+bool joystickHidIsConnected(int slot)
+{
+    // Joysticks are connected through their own driver (XBox, PS4...) or through the HID parser
+    USBDriver *driver = &joysticks[slot];
+    USBHIDInput *hidInput = &joysticks[slot];
+    return *driver || *hidInput;
+}
+
+void joystickHidSetButtonLeds(int slot, uint32_t buttons)
+{
+    // The first face buttons light the LEDs, PS3 joysticks light a player LED instead
+    JoystickLeds_t *leds = &JoystickOutputs[slot].buttonLeds;
+    leds->playerLeds = 0;
+    if (buttons & 0x8000)
+        leds->playerLeds = 1; // Srq
+    if (buttons & 0x2000)
+        leds->playerLeds = 2; // Cir
+    if (buttons & 0x1000)
+        leds->playerLeds = 4; // Tri
+    if (buttons & 0x4000)
+        leds->playerLeds = 8; // X  //Tri
+    leds->red = (buttons & 1) ? 0xff : 0;
+    leds->green = (buttons & 2) ? 0xff : 0;
+    leds->blue = (buttons & 4) ? 0xff : 0;
+    JoystickOutputStats.requested++;
+}
+
+void joystickHidSendOutputs(uint32_t timeMicros)
+{
+    // At most one output report is sent every JOYSTICK_OUTPUT_BUS_INTERVAL, so input reports always have room
+    if (timeMicros - JoystickOutputBusMicros < JOYSTICK_OUTPUT_BUS_INTERVAL)
+    {
+        return;
+    }
+
+    for (int i = 0; i < JOYSTICK_SLOT_COUNT; i++)
+    {
+        int slot = (JoystickOutputNext + i) % JOYSTICK_SLOT_COUNT;
+        JoystickOutput_t *output = &JoystickOutputs[slot];
+        if (!joystickHidIsConnected(slot))
+        {
+            memset(&output->sentLeds, 0, sizeof(JoystickLeds_t));
+            output->rumblePending = false;
+            continue;
+        }
+        if (timeMicros - output->lastSentMicros < JOYSTICK_OUTPUT_INTERVAL)
+        {
+            continue;
+        }
+
+        // Rumble goes first since it is the most noticeable, the LEDs go in the joystick's next report
+        // A report the joystick couldn't take (its last one is still being sent) is tried again in its next interval
+        const JoystickLeds_t *leds = JoystickStatusLedsSet ? &JoystickStatusLeds : &output->buttonLeds;
+        bool sent;
+        if (output->rumblePending)
+        {
+            sent = joysticks[slot].setRumble(output->rumbleLeft, output->rumbleRight, output->rumbleTimeout);
+            output->rumblePending = !sent;
+        }
+        else if (memcmp(leds, &output->sentLeds, sizeof(JoystickLeds_t)) != 0)
+        {
+            if (joysticks[slot].joystickType() == JoystickController::PS3)
+            {
+                sent = joysticks[slot].setLEDs(leds->playerLeds);
+            }
             else
             {
-                int axis = 0;
-                for (uint8_t i = 0; axis_mask != 0; i++, axis_mask >>= 1)
-                {
-                    if (axis_mask & 1)
-                    {
-                        Serial.printf(" %d:%d", i, joysticks[joystick_index].getAxis(i));
-                        joystickHidData->axis[axis] = joysticks[joystick_index].getAxis(i);
-                        axis++;
-                    }
-                }
+                sent = joysticks[slot].setLEDs(leds->red, leds->green, leds->blue);
             }
-            uint8_t ltv;
-            uint8_t rtv;
+            if (sent)
+            {
+                output->sentLeds = *leds;
+            }
+        }
+        else
+        {
+            continue;
+        }
+
+        if (sent)
+        {
+            JoystickOutputStats.sent++;
+        }
+        output->lastSentMicros = timeMicros;
+        JoystickOutputBusMicros = timeMicros;
+        JoystickOutputNext = (slot + 1) % JOYSTICK_SLOT_COUNT;
+        return;
+    }
+}
+
+void joystickHidReadReport(uint8_t device, uint32_t buttons, const uint8_t *rawAxis, uint32_t reportMicros)
+{
+    // Captures hold the raw report, so replays go through the current calibration
+    if (JoystickHidCapturing)
+    {
+        uint8_t record[HID_CAPTURE_MAX_RECORD_SIZE];
+        int length = hidCaptureEncode(&JoystickHidCapture, device, buttons, rawAxis, reportMicros, record);
+        logWrite(LOG_HID_CAPTURE, LogBytes_t { record, length });
+    }
+
+    JoystickSlot_t *slot = &JoystickSlots[device];
+    if (!slot->active)
+    {
+        slot->active = true;
+        slot->activation = ++JoystickActivations;
+    }
+    slot->buttons = buttons;
+    memcpy(slot->rawAxis, rawAxis, sizeof(slot->rawAxis));
+    LOG_DEBUG(LOG_JOYSTICK_REPORT, device, buttons, rawAxis[0], rawAxis[1], rawAxis[2], rawAxis[3], rawAxis[4]);
+
+    // Every report starts a latency trace, which goes with the edges it has and the data it changes
+    JoystickHidReportTrace.id = latencyTraceNewId();
+    JoystickHidReportTrace.reportMicros = reportMicros;
+    joystickHidMerge(reportMicros);
+    JoystickHidReportTrace.id = 0;
+}
+
+int joystickHidControlSlot(bool sticks)
+{
+    // With a role split the sticks and the buttons each belong to one joystick, active or not
+    if (JoystickMerge == JOYSTICK_MERGE_ROLE_SPLIT)
+    {
+        int slot = sticks ? JoystickPrimarySlot : JoystickSecondarySlot;
+        return JoystickSlots[slot].active ? slot : -1;
+    }
+
+    if (JoystickMerge == JOYSTICK_MERGE_PRIMARY && JoystickSlots[JoystickPrimarySlot].active)
+    {
+        return JoystickPrimarySlot;
+    }
+
+    // Otherwise the active joystick in the lowest slot (primary) or the one that became active first is in control
+    int control = -1;
+    for (int slot = 0; slot < JOYSTICK_SLOT_COUNT; slot++)
+    {
+        if (JoystickSlots[slot].active && (control == -1
+            || (JoystickMerge == JOYSTICK_MERGE_FIRST_ACTIVE && JoystickSlots[slot].activation < JoystickSlots[control].activation)))
+        {
+            control = slot;
+        }
+    }
+    return control;
+}
+
+void joystickHidMerge(uint32_t timeMicros)
+{
+    // Without a joystick in control, the buttons are released and the sticks are centered
+    int stickSlot = joystickHidControlSlot(true);
+    int buttonSlot = joystickHidControlSlot(false);
+    uint8_t rawAxis[JOYSTICK_AXIS_COUNT];
+    memset(rawAxis, AXIS_STICK_CENTER, sizeof(rawAxis));
+    if (stickSlot != -1)
+    {
+        memcpy(rawAxis, JoystickSlots[stickSlot].rawAxis, CALIBRATED_AXIS_COUNT);
+    }
+    rawAxis[AXIS_DPAD] = buttonSlot != -1 ? JoystickSlots[buttonSlot].rawAxis[AXIS_DPAD] : DPAD_CENTER;
 
-            for (uint8_t i = 0; i < 64; i++)
+    JoystickHidData_t *latest = &JoystickHidLatest;
+    JoystickHidLatestTrace = JoystickHidReportTrace;
+    latest->buttons = buttonSlot != -1 ? JoystickSlots[buttonSlot].buttons : 0;
+    for (int axis = 0; axis < JOYSTICK_AXIS_COUNT; axis++)
+    {
+        uint8_t raw = rawAxis[axis];
+        JoystickHidRawAxis[axis] = raw;
+        if (axis < CALIBRATED_AXIS_COUNT)
+        {
+            latest->axis[axis] = AxisTables[axis][raw];
+            if (JoystickHidCalibrating)
             {
-                psAxis[i] = joysticks[joystick_index].getAxis(i);
+                CalibrationMinimum[axis] = min(CalibrationMinimum[axis], raw);
+                CalibrationMaximum[axis] = max(CalibrationMaximum[axis], raw);
             }
+        }
+        else
+        {
+            latest->axis[axis] = raw;
+        }
+    }
 
-            if (buttons != buttons_prev)
+    joystickHidQueueEdges(latest->buttons, latest->axis[AXIS_DPAD], timeMicros);
+}
+
+uint32_t joystickHidReplayReports(uint32_t updateMicros)
+{
+    // In real time every report that is due is read, otherwise one report is read per update and the update
+    // takes the report's time, so timing (like hold events) plays out the same as it did when it was captured
+    // As fast as possible, the hold events due before the next report get updates of their own
+    while (true)
+    {
+        if (!ReplayReportPending)
+        {
+            int length = hidCaptureDecode(&ReplayState, ReplayCapture + ReplayPosition, ReplayLength - ReplayPosition, &ReplayReport);
+            if (length == 0)
             {
-                if (joysticks[joystick_index].joystickType() == JoystickController::PS3)
-                {
-                    uint8_t leds = 0;
-                    if (buttons & 0x8000)
-                        leds = 1; // Srq
-                    if (buttons & 0x2000)
-                        leds = 2; // Cir
-                    if (buttons & 0x1000)
-                        leds = 4; // Tri
-                    if (buttons & 0x4000)
-                        leds = 8; // X  //Tri
-                    joysticks[joystick_index].setLEDs(leds);
-                }
-                else
-                {
-                    uint8_t lr = (buttons & 1) ? 0xff : 0;
-                    uint8_t lg = (buttons & 2) ? 0xff : 0;
-                    uint8_t lb = (buttons & 4) ? 0xff : 0;
-                    joysticks[joystick_index].setLEDs(lr, lg, lb);
-                }
-                buttons_prev = buttons;
+                // The capture ended, the replayed joysticks go inactive so nothing is left held
+                uint32_t endMicros = ReplaySpeed == JOYSTICK_REPLAY_FAST ? ReplayStartMicros + ReplayReport.timeMicros : updateMicros;
+                ReplayCapture = NULL;
+                joystickHidDeactivateSlots();
+                joystickHidMerge(endMicros);
+                return endMicros;
             }
+            ReplayPosition += length;
+            ReplayReportPending = true;
+        }
 
-            Serial.println();
-            joysticks[joystick_index].joystickDataClear();
+        uint32_t reportMicros = ReplayStartMicros + ReplayReport.timeMicros;
+        if (ReplaySpeed == JOYSTICK_REPLAY_REALTIME && (int32_t)(updateMicros - reportMicros) < 0)
+        {
+            return updateMicros;
+        }
+        uint32_t holdMicros = 0;
+        if (ReplaySpeed == JOYSTICK_REPLAY_FAST && joystickHidNextHold(&holdMicros) && (int32_t)(holdMicros - reportMicros) < 0)
+        {
+            return holdMicros;
+        }
+
+        joystickHidReadReport(ReplayReport.device, ReplayReport.buttons, ReplayReport.axis, reportMicros);
+        ReplayReportPending = false;
+        if (ReplaySpeed == JOYSTICK_REPLAY_FAST)
+        {
+            return reportMicros;
         }
     }
+}
 
-    return true;
+void joystickHidQueueEvent(JoystickEventType type, uint32_t button, uint8_t dpad, uint32_t timeMicros, uint32_t heldMicros)
+{
+    // Releases always fit, the queue keeps a slot for the release of every press it took
+    // Presses and holds that would use up those slots are dropped instead, the count is logged once there is room again
+    // A release is only left out if its press was dropped, so the UX never sees a button that stays down
+    bool isDpad = button == 0;
+    int releasesOwed = __builtin_popcount(JoystickEventReleasesOwed) + (JoystickEventDpadReleaseOwed ? 1 : 0);
+    if (type == JOYSTICK_EVENT_RELEASE)
+    {
+        bool owed = isDpad ? JoystickEventDpadReleaseOwed : (JoystickEventReleasesOwed & button) != 0;
+        if (!owed)
+        {
+            return;
+        }
+    }
+    else if (type == JOYSTICK_EVENT_HOLD && !(JoystickEventReleasesOwed & button))
+    {
+        return;
+    }
+    else
+    {
+        int slotsNeeded = type == JOYSTICK_EVENT_PRESS ? 2 : 1;
+        if (JoystickEventCount + releasesOwed + slotsNeeded > JOYSTICK_EVENT_QUEUE_SIZE)
+        {
+            JoystickEventsDropped++;
+            return;
+        }
+    }
+    if (JoystickEventsDropped != 0)
+    {
+        LOG_WARNING(LOG_JOYSTICK_EVENTS_DROPPED, JoystickEventsDropped);
+        JoystickEventsDropped = 0;
+    }
+
+    JoystickEvent_t *event = &JoystickEventQueue[(JoystickEventHead + JoystickEventCount) % JOYSTICK_EVENT_QUEUE_SIZE];
+    event->type = type;
+    event->button = button;
+    event->dpad = dpad;
+    event->timeMicros = timeMicros;
+    event->heldMicros = heldMicros;
+    event->trace = JoystickHidReportTrace;
+    if (type == JOYSTICK_EVENT_HOLD)
+    {
+        event->trace.id = latencyTraceNewId();
+        event->trace.reportMicros = timeMicros;
+    }
+    event->trace.updatedMicros = micros();
+    JoystickEventCount++;
+    JoystickEventsQueued = true;
+
+    if (type == JOYSTICK_EVENT_PRESS || type == JOYSTICK_EVENT_RELEASE)
+    {
+        bool owed = type == JOYSTICK_EVENT_PRESS;
+        if (isDpad)
+        {
+            JoystickEventDpadReleaseOwed = owed;
+        }
+        else if (owed)
+        {
+            JoystickEventReleasesOwed |= button;
+        }
+        else
+        {
+            JoystickEventReleasesOwed &= ~button;
+        }
+    }
+}
+
+void joystickHidQueueEdges(uint32_t buttons, uint8_t dpad, uint32_t timeMicros)
+{
+    // Queue a press or a release for every button that changed
+    uint32_t changed = buttons ^ JoystickEventButtons;
+    for (int i = 0; changed != 0; i++, changed >>= 1)
+    {
+        if (!(changed & 1))
+        {
+            continue;
+        }
+
+        uint32_t button = 1UL << i;
+        if (buttons & button)
+        {
+            ButtonPressMicros[i] = timeMicros;
+            ButtonHoldMicros[i] = timeMicros;
+            joystickHidQueueEvent(JOYSTICK_EVENT_PRESS, button, DPAD_CENTER, timeMicros, 0);
+        }
+        else
+        {
+            joystickHidQueueEvent(JOYSTICK_EVENT_RELEASE, button, DPAD_CENTER, timeMicros, timeMicros - ButtonPressMicros[i]);
+        }
+    }
+    JoystickEventButtons = buttons;
+
+    // Moving the d-pad releases the old direction and presses the new one
+    if (dpad != JoystickEventDpad)
+    {
+        if (JoystickEventDpad != DPAD_CENTER)
+        {
+            joystickHidQueueEvent(JOYSTICK_EVENT_RELEASE, 0, JoystickEventDpad, timeMicros, timeMicros - DpadPressMicros);
+        }
+        if (dpad != DPAD_CENTER)
+        {
+            DpadPressMicros = timeMicros;
+            joystickHidQueueEvent(JOYSTICK_EVENT_PRESS, 0, dpad, timeMicros, 0);
+        }
+        JoystickEventDpad = dpad;
+    }
+}
+
+bool joystickHidNextHold(uint32_t *holdMicros)
+{
+    // Find the held button that is due to send a hold event first
+    bool held = false;
+    uint32_t buttons = JoystickEventButtons;
+    for (int i = 0; buttons != 0; i++, buttons >>= 1)
+    {
+        uint32_t dueMicros = ButtonHoldMicros[i] + JOYSTICK_HOLD_EVENT_INTERVAL;
+        if ((buttons & 1) && (!held || (int32_t)(dueMicros - *holdMicros) < 0))
+        {
+            *holdMicros = dueMicros;
+            held = true;
+        }
+    }
+    return held;
+}
+
+void joystickHidQueueHolds(uint32_t timeMicros)
+{
+    uint32_t held = JoystickEventButtons;
+    for (int i = 0; held != 0; i++, held >>= 1)
+    {
+        if ((held & 1) && timeMicros - ButtonHoldMicros[i] >= JOYSTICK_HOLD_EVENT_INTERVAL)
+        {
+            ButtonHoldMicros[i] = timeMicros;
+            joystickHidQueueEvent(JOYSTICK_EVENT_HOLD, 1UL << i, DPAD_CENTER, timeMicros, timeMicros - ButtonPressMicros[i]);
+        }
+    }
 }
 
 
 
 //=============================================================================
-// Show when devices are added or removed
+// Show when devices are added or removed, returns true if any were
 //=============================================================================
-void PrintDeviceListChanges()
+bool PrintDeviceListChanges()
 {
+    bool changed = false;
     for (uint8_t i = 0; i < CNT_DEVICES; i++)
     {
         if (*drivers[i] != driver_active[i])
         {
             if (driver_active[i])
             {
-                Serial.printf("*** Device %s - disconnected ***\n", driver_names[i]);
+                LOG_INFO(LOG_DEVICE_DISCONNECTED, driver_names[i]);
                 driver_active[i] = false;
+                changed = true;
             }
             else
             {
-                Serial.printf("*** Device %s %x:%x - connected ***\n", driver_names[i], drivers[i]->idVendor(), drivers[i]->idProduct());
+                LOG_INFO(LOG_DEVICE_CONNECTED, driver_names[i], drivers[i]->idVendor(), drivers[i]->idProduct());
                 driver_active[i] = true;
+                changed = true;
 
                 const uint8_t *psz = drivers[i]->manufacturer();
                 if (psz && *psz)
-                    Serial.printf("  manufacturer: %s\n", psz);
+                    LOG_INFO(LOG_DEVICE_MANUFACTURER, psz);
                 psz = drivers[i]->product();
                 if (psz && *psz)
-                    Serial.printf("  product: %s\n", psz);
+                    LOG_INFO(LOG_DEVICE_PRODUCT, psz);
                 psz = drivers[i]->serialNumber();
                 if (psz && *psz)
-                    Serial.printf("  Serial: %s\n", psz);
+                    LOG_INFO(LOG_DEVICE_SERIAL_NUMBER, psz);
             }
         }
     }
@@ -162,24 +871,28 @@ void PrintDeviceListChanges()
         {
             if (hid_driver_active[i])
             {
-                Serial.printf("*** HID Device %s - disconnected ***\n", hid_driver_names[i]);
+                LOG_INFO(LOG_HID_DEVICE_DISCONNECTED, hid_driver_names[i]);
                 hid_driver_active[i] = false;
+                changed = true;
             }
             else
             {
-                Serial.printf("*** HID Device %s %x:%x - connected ***\n", hid_driver_names[i], hiddrivers[i]->idVendor(), hiddrivers[i]->idProduct());
+                LOG_INFO(LOG_HID_DEVICE_CONNECTED, hid_driver_names[i], hiddrivers[i]->idVendor(), hiddrivers[i]->idProduct());
                 hid_driver_active[i] = true;
+                changed = true;
 
                 const uint8_t *psz = hiddrivers[i]->manufacturer();
                 if (psz && *psz)
-                    Serial.printf("  manufacturer: %s\n", psz);
+                    LOG_INFO(LOG_DEVICE_MANUFACTURER, psz);
                 psz = hiddrivers[i]->product();
                 if (psz && *psz)
-                    Serial.printf("  product: %s\n", psz);
+                    LOG_INFO(LOG_DEVICE_PRODUCT, psz);
                 psz = hiddrivers[i]->serialNumber();
                 if (psz && *psz)
-                    Serial.printf("  Serial: %s\n", psz);
+                    LOG_INFO(LOG_DEVICE_SERIAL_NUMBER, psz);
             }
         }
     }
-}
\ No newline at end of file
+
+    return changed;
+}
@@ -2,6 +2,7 @@
 #define _JOYSTICK_HID_H_
 
 #include <Arduino.h>
+#include "latencyTrace.h"
 
 // Joystick button mappings
 const uint32_t BUTTON_1         = 0b1;
@@ -30,20 +31,175 @@ const int AXIS_LEFT_STICK_Y = 1;
 const int AXIS_RIGHT_STICK_X = 2;
 const int AXIS_RIGHT_STICK_Y = 3;
 const int AXIS_DPAD = 4;
+const int JOYSTICK_AXIS_COUNT = 5;
+
+// The number of joysticks that can be connected at once, each one has its own slot
+const int JOYSTICK_SLOT_COUNT = 4;
+
+// Joystick axis centers
+const uint8_t AXIS_STICK_CENTER = 128;
+
+// The default amount a stick axis has to move (from the last reported value) before the change is reported
+// Smaller movements are sensor noise and are left out of the joystick data
+const uint8_t JOYSTICK_DEFAULT_AXIS_EPSILON = 2;
+
+// The number of input events that can wait for the UX, and how often a held button sends a hold event
+// Releases are never dropped, a slot is kept for the release of every queued press
+const int JOYSTICK_EVENT_QUEUE_SIZE = 32;
+const uint32_t JOYSTICK_HOLD_EVENT_INTERVAL = 50000;
+
+// How often an output report (LEDs or rumble) can be sent to one joystick, and to any joystick
+// Changes in between are coalesced and only the latest state is sent, so output reports don't crowd out input reports
+const uint32_t JOYSTICK_OUTPUT_INTERVAL = 20000;
+const uint32_t JOYSTICK_OUTPUT_BUS_INTERVAL = 4000;
 
 // Joystick data structure
 struct JoystickHidData_t
 {
     uint32_t buttons;
-    uint8_t axis[5];
+    uint8_t axis[JOYSTICK_AXIS_COUNT];
+
+    // The latency trace of the report the data last changed with
+    LatencyTraceStart_t trace;
+};
+
+// The changes between two joystick data snapshots
+struct JoystickHidChanges_t
+{
+    // Buttons that went down and buttons that came up
+    uint32_t buttonsPressed;
+    uint32_t buttonsReleased;
+
+    // Every bit is one axis that changed, stick axes only count once they moved by at least the axis epsilon
+    uint8_t axesChanged;
+
+    // Whether or not a USB device was connected or disconnected
+    bool devicesChanged;
+
+    // Whether or not input events were queued
+    bool eventsQueued;
+};
+
+// How the joysticks are merged into the single control view (the JoystickHidData_t from joystickHidUpdate())
+enum JoystickMergePolicy : uint8_t
+{
+    JOYSTICK_MERGE_PRIMARY,      // The primary joystick is in control while it is active, otherwise the active joystick in the lowest slot
+    JOYSTICK_MERGE_FIRST_ACTIVE, // The joystick that became active first stays in control until it is disconnected
+    JOYSTICK_MERGE_ROLE_SPLIT,   // The primary (helm) joystick drives the sticks and the secondary (pyro) joystick the buttons and d-pad
+};
+
+// Input event types
+enum JoystickEventType : uint8_t
+{
+    JOYSTICK_EVENT_PRESS,   // A button or d-pad direction went down
+    JOYSTICK_EVENT_RELEASE, // A button or d-pad direction came up
+    JOYSTICK_EVENT_HOLD,    // A button is still down, sent every JOYSTICK_HOLD_EVENT_INTERVAL while it is held
+};
+
+// An input edge, queued when the joystick report that contains it is read
+// The d-pad directions are pressed and released like buttons (moving between directions releases one and presses the other)
+struct JoystickEvent_t
+{
+    JoystickEventType type;
+
+    // The button the event is for, or 0 for d-pad events
+    uint32_t button;
+
+    // The d-pad direction the event is for, or DPAD_CENTER for button events
+    uint8_t dpad;
+
+    // When the report with the edge was read (or when the hold event was sent)
+    uint32_t timeMicros;
+
+    // How long the button has been down for hold and release events
+    uint32_t heldMicros;
+
+    // The latency trace of the report with the edge (hold events start their own trace)
+    LatencyTraceStart_t trace;
+};
+
+// The LEDs of a joystick, PS3 joysticks show the player LEDs (one bit each) instead of the color
+struct JoystickLeds_t
+{
+    uint8_t red;
+    uint8_t green;
+    uint8_t blue;
+    uint8_t playerLeds;
+};
+
+// Output report counters, requested is every LED or rumble change (one output report each without coalescing)
+struct JoystickOutputStats_t
+{
+    uint32_t requested;
+    uint32_t sent;
 };
 
 // Initializes the joystick HID device
 void joystickHidInit();
 
 // Polls the joystick HID device for updates, stores the data in the provided JoystickHidData_t structure
-// Returns true if the joystick data has been updated; false otherwise
-bool joystickHidUpdate(JoystickHidData_t *joystickHidData);
+// and what changed since the last update in the provided JoystickHidChanges_t structure
+// Returns true if anything changed; false otherwise
+bool joystickHidUpdate(JoystickHidData_t *joystickHidData, JoystickHidChanges_t *joystickHidChanges);
+
+// Takes the oldest input event from the queue
+// Returns true if there was an event; false otherwise
+bool joystickHidNextEvent(JoystickEvent_t *event);
+
+// How fast a capture is replayed
+enum JoystickReplaySpeed : uint8_t
+{
+    JOYSTICK_REPLAY_REALTIME, // Every report is read when it is due, as it was captured
+    JOYSTICK_REPLAY_FAST,     // One report is read every update, timestamped with the time it was captured at
+};
+
+// Streams every joystick report to the log as a LOG_HID_CAPTURE record (see hidCapture.h) so the session can be replayed
+void joystickHidSetCapture(bool enabled);
+
+// Reads the reports of a capture (see hidCapture.h) instead of the USB joysticks, the capture must stay valid until it ends
+// The replay ends after the last report, leaving the buttons released and the sticks centered
+void joystickHidBeginReplay(const uint8_t *capture, uint32_t length, JoystickReplaySpeed speed);
+
+// Stops replaying a capture, the USB joysticks are read again
+void joystickHidEndReplay();
+
+// Whether or not a capture is being replayed
+bool joystickHidIsReplaying();
+
+// Sets how the joysticks are merged into the single control view
+// With JOYSTICK_MERGE_ROLE_SPLIT, the sticks are centered while the primary joystick is inactive and the buttons are
+// released while the secondary joystick is inactive, one joystick never stands in for the other's role
+void joystickHidSetMergePolicy(JoystickMergePolicy policy, int primarySlot, int secondarySlot);
+
+// Gets the (calibrated) state of a single joystick
+// Returns true if the joystick is active (it reported since it was connected); false otherwise
+bool joystickHidGetSlot(int slot, JoystickHidData_t *joystickHidData);
+
+// Sets the amount a stick axis has to move before the change is reported
+void joystickHidSetAxisEpsilon(uint8_t epsilon);
+
+// Sets the response of a stick axis (see AxisCalibration_t) and rebuilds its lookup table
+void joystickHidSetAxisResponse(int axis, uint8_t deadzone, uint8_t expo, bool inverted);
+
+// Starts capturing the extents of the sticks, the sticks must be at rest because their centers are captured right away
+void joystickHidBeginCalibration();
+
+// Stops capturing the extents of the sticks, then applies and saves the new calibration
+void joystickHidEndCalibration();
+
+// Whether or not the extents of the sticks are being captured
+bool joystickHidIsCalibrating();
+
+// Sets the LEDs every joystick shows for the system state, they take the place of the button feedback
+// Pass NULL to go back to the button feedback
+void joystickHidSetStatusLeds(const JoystickLeds_t *leds);
+
+// Rumbles a joystick, or every joystick if slot is -1, the motors stop after timeoutMillis
+void joystickHidRumble(int slot, uint8_t left, uint8_t right, uint8_t timeoutMillis);
+
+// Gets and clears the output report counters
+void joystickHidGetOutputStats(JoystickOutputStats_t *stats);
+void joystickHidResetOutputStats();
 
 
 #endif // end _JOYSTICK_HID_H_
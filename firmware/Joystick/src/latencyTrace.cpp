@@ -0,0 +1,153 @@
+#include "latencyTrace.h"
+
+const char *LATENCY_TRACE_NAMES[LATENCY_TRACE_KIND_COUNT] = { "Propulsion", "Trigger" };
+const char *LATENCY_STAGE_NAMES[LATENCY_STAGE_COUNT + 1] = { "hid", "ux", "encode", "wire", "total" };
+
+// The trace of each kind that is in flight, between its request being set and its message being written
+struct LatencyTraceFlight_t
+{
+    uint32_t id;
+    uint32_t pointMicros[LATENCY_POINT_COUNT];
+    uint8_t pointsReached; // Every bit is one point that was marked
+};
+
+// The completed traces of a kind, the oldest is overwritten once it is full
+struct LatencyTraceSamples_t
+{
+    uint32_t stageMicros[LATENCY_TRACE_SAMPLE_COUNT][LATENCY_STAGE_COUNT];
+    int next;
+    int count;
+};
+
+uint32_t LatencyTraceLastId = 0;
+LatencyTraceFlight_t LatencyTraceFlights[LATENCY_TRACE_KIND_COUNT];
+LatencyTraceSamples_t LatencyTraceSamples[LATENCY_TRACE_KIND_COUNT];
+
+uint32_t latencyTraceNewId()
+{
+    LatencyTraceLastId++;
+    if (LatencyTraceLastId == 0)
+    {
+        LatencyTraceLastId = 1;
+    }
+    return LatencyTraceLastId;
+}
+
+void latencyTraceRequest(LatencyTraceKind kind, const LatencyTraceStart_t *start, uint32_t timeMicros)
+{
+    if (start->id == 0)
+    {
+        return;
+    }
+
+    LatencyTraceFlight_t *flight = &LatencyTraceFlights[kind];
+    flight->id = start->id;
+    flight->pointMicros[LATENCY_POINT_REPORT_RECEIVED] = start->reportMicros;
+    flight->pointMicros[LATENCY_POINT_HID_UPDATED] = start->updatedMicros;
+    flight->pointMicros[LATENCY_POINT_REQUEST_SET] = timeMicros;
+    flight->pointsReached = (1 << LATENCY_POINT_REPORT_RECEIVED) | (1 << LATENCY_POINT_HID_UPDATED) | (1 << LATENCY_POINT_REQUEST_SET);
+}
+
+void latencyTraceMark(LatencyTraceKind kind, uint32_t id, LatencyTracePoint point, uint32_t timeMicros)
+{
+    LatencyTraceFlight_t *flight = &LatencyTraceFlights[kind];
+    if (id == 0 || flight->id != id)
+    {
+        return;
+    }
+    flight->pointMicros[point] = timeMicros;
+    flight->pointsReached |= 1 << point;
+
+    if (point != LATENCY_POINT_WIRE_WRITTEN)
+    {
+        return;
+    }
+
+    // Only traces that passed through every point are kept, the trace is over either way
+    flight->id = 0;
+    if (flight->pointsReached != (1 << LATENCY_POINT_COUNT) - 1)
+    {
+        return;
+    }
+    LatencyTraceSamples_t *samples = &LatencyTraceSamples[kind];
+    for (int stage = 0; stage < LATENCY_STAGE_COUNT; stage++)
+    {
+        samples->stageMicros[samples->next][stage] = flight->pointMicros[stage + 1] - flight->pointMicros[stage];
+    }
+    samples->next = (samples->next + 1) % LATENCY_TRACE_SAMPLE_COUNT;
+    samples->count = min(samples->count + 1, LATENCY_TRACE_SAMPLE_COUNT);
+}
+
+int latencyTraceSampleCount(LatencyTraceKind kind)
+{
+    return LatencyTraceSamples[kind].count;
+}
+
+uint32_t latencyTracePercentile(LatencyTraceKind kind, int stage, int percent)
+{
+    LatencyTraceSamples_t *samples = &LatencyTraceSamples[kind];
+    if (samples->count == 0)
+    {
+        return 0;
+    }
+
+    // Sort a copy of the stage's times (insertion sort, there are only a few samples)
+    uint32_t sorted[LATENCY_TRACE_SAMPLE_COUNT];
+    for (int i = 0; i < samples->count; i++)
+    {
+        uint32_t value = 0;
+        for (int s = 0; s < LATENCY_STAGE_COUNT; s++)
+        {
+            if (s == stage || stage == LATENCY_STAGE_TOTAL)
+            {
+                value += samples->stageMicros[i][s];
+            }
+        }
+
+        int j = i;
+        for (; j > 0 && sorted[j - 1] > value; j--)
+        {
+            sorted[j] = sorted[j - 1];
+        }
+        sorted[j] = value;
+    }
+
+    // Nearest rank
+    int rank = (percent * samples->count + 99) / 100;
+    return sorted[constrain(rank, 1, samples->count) - 1];
+}
+
+void latencyTracePrint(Print *out)
+{
+    for (int kind = 0; kind < LATENCY_TRACE_KIND_COUNT; kind++)
+    {
+        LatencyTraceKind traceKind = (LatencyTraceKind)kind;
+        out->print(LATENCY_TRACE_NAMES[kind]);
+        out->print(": ");
+        out->print(latencyTraceSampleCount(traceKind));
+        out->println(" traces (p50/p90/p99/max us)");
+        if (latencyTraceSampleCount(traceKind) == 0)
+        {
+            continue;
+        }
+
+        for (int stage = 0; stage <= LATENCY_STAGE_TOTAL; stage++)
+        {
+            out->print("  ");
+            out->print(LATENCY_STAGE_NAMES[stage]);
+            out->print(": ");
+            out->print(latencyTracePercentile(traceKind, stage, 50));
+            out->print('/');
+            out->print(latencyTracePercentile(traceKind, stage, 90));
+            out->print('/');
+            out->print(latencyTracePercentile(traceKind, stage, 99));
+            out->print('/');
+            out->println(latencyTracePercentile(traceKind, stage, 100));
+        }
+    }
+}
+
+void latencyTraceReset()
+{
+    memset(LatencyTraceSamples, 0, sizeof(LatencyTraceSamples));
+}
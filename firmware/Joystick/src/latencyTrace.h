@@ -0,0 +1,66 @@
+#ifndef _LATENCY_TRACE_H_
+#define _LATENCY_TRACE_H_
+
+#include <Arduino.h>
+
+// The number of completed traces kept for each kind of request, the percentiles are taken over them
+const int LATENCY_TRACE_SAMPLE_COUNT = 64;
+
+// The requests that are traced from the joystick input to the wire
+enum LatencyTraceKind : uint8_t
+{
+    LATENCY_TRACE_PROPULSION,  // A stick movement turning into a SetPropulsion message
+    LATENCY_TRACE_TRIGGER,     // A trigger hold turning into a TriggerSequence message
+    LATENCY_TRACE_KIND_COUNT,
+};
+
+// The points a trace passes through, in order
+enum LatencyTracePoint : uint8_t
+{
+    LATENCY_POINT_REPORT_RECEIVED, // The USB report was read (or the hold event was sent)
+    LATENCY_POINT_HID_UPDATED,     // The JoystickHidData_t (or input event) was handed to the UX
+    LATENCY_POINT_REQUEST_SET,     // The SystemStatus_t request flag was set
+    LATENCY_POINT_FRAME_ENCODED,   // The message was encoded
+    LATENCY_POINT_WIRE_WRITTEN,    // The last byte of the message was written
+    LATENCY_POINT_COUNT,
+};
+
+// The time spent between two points (each stage ends at the point after it), and the whole trace
+const int LATENCY_STAGE_COUNT = LATENCY_POINT_COUNT - 1;
+const int LATENCY_STAGE_TOTAL = LATENCY_STAGE_COUNT;
+
+// The start of a trace, carried with the input it was taken from until the input sets a request
+struct LatencyTraceStart_t
+{
+    // 0 for input that isn't traced
+    uint32_t id;
+
+    uint32_t reportMicros;
+    uint32_t updatedMicros;
+};
+
+// Gets the id for a new trace, ids are never 0
+uint32_t latencyTraceNewId();
+
+// Marks the request flag of a kind as set by the input the trace started from
+// Each kind has one trace in flight, it is replaced by the next request (only the latest request is sent)
+void latencyTraceRequest(LatencyTraceKind kind, const LatencyTraceStart_t *start, uint32_t timeMicros);
+
+// Marks the message carrying a trace as encoded or written, writing the last byte completes the trace
+// Marks for a trace that is no longer in flight are ignored
+void latencyTraceMark(LatencyTraceKind kind, uint32_t id, LatencyTracePoint point, uint32_t timeMicros);
+
+// Gets the number of completed traces of a kind that the percentiles are taken over
+int latencyTraceSampleCount(LatencyTraceKind kind);
+
+// Gets a percentile (0-100) of the time spent in a stage (or LATENCY_STAGE_TOTAL) by the completed traces of a kind
+uint32_t latencyTracePercentile(LatencyTraceKind kind, int stage, int percent);
+
+// Prints the percentiles of every stage of every kind of trace
+void latencyTracePrint(Print *out);
+
+// Clears the completed traces
+void latencyTraceReset();
+
+
+#endif // end _LATENCY_TRACE_H_
@@ -0,0 +1,237 @@
+#include "linkStats.h"
+#include <string.h>
+
+enum LinkStatsPingState : uint8_t
+{
+    LINK_PING_FREE = 0,
+    LINK_PING_IN_FLIGHT,
+    LINK_PING_REPLIED,
+    LINK_PING_LOST, // Kept until the slot is reused so a late reply can be told apart
+};
+
+// A ping in the in flight table, each iteration has its slot (iteration % LINK_STATS_MAX_IN_FLIGHT)
+struct LinkStatsPing_t
+{
+    uint32_t iteration;
+    uint32_t sentMicros;
+    LinkStatsPingState state;
+};
+
+LinkStatsPing_t LinkStatsPings[LINK_STATS_MAX_IN_FLIGHT];
+LinkStats_t LinkStats;
+int LinkStatsLostInRow = 0;
+bool LinkStatsAnyReplied = false;
+uint32_t LinkStatsHighestReplied = 0;
+
+// Recent round trips, the oldest is overwritten once it is full
+uint32_t LinkStatsRtts[LINK_STATS_RTT_SAMPLE_COUNT];
+int LinkStatsRttNext = 0;
+int LinkStatsRttCount = 0;
+
+// Smoothed round trip and its variation (RFC 6298) and the last round trip for the jitter
+uint32_t LinkStatsRttVariation = 0;
+uint32_t LinkStatsLastRtt = 0;
+
+void linkStatsAddRtt(uint32_t rtt);
+uint32_t linkStatsPercentile(int percent);
+void linkStatsLose(LinkStatsPing_t *ping);
+void linkStatsBackOff();
+
+
+void linkStatsPingSent(uint32_t iteration, uint32_t timeMicros)
+{
+    LinkStatsPing_t *ping = &LinkStatsPings[iteration % LINK_STATS_MAX_IN_FLIGHT];
+    if (ping->state == LINK_PING_IN_FLIGHT)
+    {
+        linkStatsLose(ping);
+        linkStatsBackOff();
+    }
+
+    ping->iteration = iteration;
+    ping->sentMicros = timeMicros;
+    ping->state = LINK_PING_IN_FLIGHT;
+    LinkStats.sent++;
+}
+
+uint32_t linkStatsPingReplied(uint32_t iteration, uint32_t timeMicros)
+{
+    LinkStatsPing_t *ping = &LinkStatsPings[iteration % LINK_STATS_MAX_IN_FLIGHT];
+    if (ping->iteration != iteration)
+    {
+        // Too old to still be in the table (or never sent)
+        return 0;
+    }
+    if (ping->state != LINK_PING_IN_FLIGHT && ping->state != LINK_PING_LOST)
+    {
+        return 0;
+    }
+
+    // A late reply was already counted as lost, but its round trip is real and it shows the link is up
+    // so it still goes into the timeout, otherwise the timeout could never grow past a round trip that went up
+    uint32_t rtt = timeMicros - ping->sentMicros;
+    if (ping->state == LINK_PING_LOST)
+    {
+        LinkStats.late++;
+    }
+    else
+    {
+        LinkStats.replied++;
+    }
+    ping->state = LINK_PING_REPLIED;
+    LinkStatsLostInRow = 0;
+
+    // Iterations wrap, so the order is the sign of the difference
+    if (LinkStatsAnyReplied && (int32_t)(iteration - LinkStatsHighestReplied) < 0)
+    {
+        LinkStats.outOfOrder++;
+    }
+    else
+    {
+        LinkStatsHighestReplied = iteration;
+        LinkStatsAnyReplied = true;
+    }
+
+    linkStatsAddRtt(rtt);
+    return rtt;
+}
+
+bool linkStatsUpdate(uint32_t timeMicros)
+{
+    // Pings that time out together only back the timeout off once
+    bool timedOut = false;
+    for (int i = 0; i < LINK_STATS_MAX_IN_FLIGHT; i++)
+    {
+        LinkStatsPing_t *ping = &LinkStatsPings[i];
+        if (ping->state == LINK_PING_IN_FLIGHT && timeMicros - ping->sentMicros >= LinkStats.timeout)
+        {
+            linkStatsLose(ping);
+            timedOut = true;
+        }
+    }
+    if (timedOut)
+    {
+        linkStatsBackOff();
+    }
+    return LinkStatsLostInRow >= LINK_STATS_LOST_PING_LIMIT;
+}
+
+void linkStatsClearInFlight()
+{
+    for (int i = 0; i < LINK_STATS_MAX_IN_FLIGHT; i++)
+    {
+        if (LinkStatsPings[i].state == LINK_PING_IN_FLIGHT)
+        {
+            LinkStatsPings[i].state = LINK_PING_FREE;
+        }
+    }
+    LinkStatsLostInRow = 0;
+}
+
+void linkStatsGet(LinkStats_t *stats)
+{
+    *stats = LinkStats;
+    uint32_t completed = LinkStats.replied + LinkStats.lost;
+    stats->lossPercent = completed > 0 ? (LinkStats.lost * 100 + completed / 2) / completed : 0;
+    stats->p95Rtt = linkStatsPercentile(95);
+    stats->p99Rtt = linkStatsPercentile(99);
+}
+
+void linkStatsReset()
+{
+    memset(LinkStatsPings, 0, sizeof(LinkStatsPings));
+    memset(&LinkStats, 0, sizeof(LinkStats));
+    LinkStats.timeout = LINK_STATS_INITIAL_TIMEOUT_MICROS;
+    LinkStatsLostInRow = 0;
+    LinkStatsAnyReplied = false;
+    LinkStatsRttNext = 0;
+    LinkStatsRttCount = 0;
+}
+
+void linkStatsLose(LinkStatsPing_t *ping)
+{
+    ping->state = LINK_PING_LOST;
+    LinkStats.lost++;
+    LinkStatsLostInRow++;
+}
+
+void linkStatsBackOff()
+{
+    LinkStats.timeout = LinkStats.timeout > LINK_STATS_MAX_TIMEOUT_MICROS / 2 ? LINK_STATS_MAX_TIMEOUT_MICROS : LinkStats.timeout * 2;
+}
+
+void linkStatsAddRtt(uint32_t rtt)
+{
+    LinkStatsRtts[LinkStatsRttNext] = rtt;
+    LinkStatsRttNext = (LinkStatsRttNext + 1) % LINK_STATS_RTT_SAMPLE_COUNT;
+    if (LinkStatsRttCount < LINK_STATS_RTT_SAMPLE_COUNT)
+    {
+        LinkStatsRttCount++;
+    }
+
+    if (LinkStatsRttCount == 1)
+    {
+        LinkStats.minRtt = rtt;
+        LinkStats.meanRtt = rtt;
+        LinkStatsRttVariation = rtt / 2;
+        LinkStats.jitter = 0;
+    }
+    else
+    {
+        uint32_t error = rtt > LinkStats.meanRtt ? rtt - LinkStats.meanRtt : LinkStats.meanRtt - rtt;
+        LinkStatsRttVariation = (3 * LinkStatsRttVariation + error) / 4;
+        LinkStats.meanRtt = (7 * LinkStats.meanRtt + rtt) / 8;
+
+        // Interarrival jitter as RTP estimates it (RFC 3550), from the change between consecutive round trips
+        int32_t change = rtt > LinkStatsLastRtt ? rtt - LinkStatsLastRtt : LinkStatsLastRtt - rtt;
+        LinkStats.jitter += (change - (int32_t)LinkStats.jitter) / 16;
+        if (rtt < LinkStats.minRtt)
+        {
+            LinkStats.minRtt = rtt;
+        }
+    }
+    LinkStatsLastRtt = rtt;
+
+    uint32_t timeout = LinkStats.meanRtt + 4 * LinkStatsRttVariation;
+    if (timeout < LINK_STATS_MIN_TIMEOUT_MICROS)
+    {
+        timeout = LINK_STATS_MIN_TIMEOUT_MICROS;
+    }
+    if (timeout > LINK_STATS_MAX_TIMEOUT_MICROS)
+    {
+        timeout = LINK_STATS_MAX_TIMEOUT_MICROS;
+    }
+    LinkStats.timeout = timeout;
+}
+
+uint32_t linkStatsPercentile(int percent)
+{
+    if (LinkStatsRttCount == 0)
+    {
+        return 0;
+    }
+
+    // Sort a copy of the round trips (insertion sort, there are only a few samples)
+    uint32_t sorted[LINK_STATS_RTT_SAMPLE_COUNT] = {};
+    for (int i = 0; i < LinkStatsRttCount; i++)
+    {
+        uint32_t value = LinkStatsRtts[i];
+        int j = i;
+        for (; j > 0 && sorted[j - 1] > value; j--)
+        {
+            sorted[j] = sorted[j - 1];
+        }
+        sorted[j] = value;
+    }
+
+    // Nearest rank
+    int rank = (percent * LinkStatsRttCount + 99) / 100;
+    if (rank < 1)
+    {
+        rank = 1;
+    }
+    else if (rank > LinkStatsRttCount)
+    {
+        rank = LinkStatsRttCount;
+    }
+    return sorted[rank - 1];
+}
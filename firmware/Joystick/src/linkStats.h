@@ -0,0 +1,64 @@
+#ifndef _LINK_STATS_H_
+#define _LINK_STATS_H_
+
+#include <stdint.h>
+
+// Link quality of the aggregator connection, measured with pings keyed by their iteration
+// This file doesn't depend on Arduino so it builds on a host with the link (see coms.h)
+
+// The number of pings that can be waiting on a reply, a ping still waiting when its slot is reused is lost
+const int LINK_STATS_MAX_IN_FLIGHT = 8;
+
+// The number of recent round trips the percentiles are taken over
+const int LINK_STATS_RTT_SAMPLE_COUNT = 64;
+
+// Bounds of the reply timeout, which follows the round trips (smoothed round trip + 4x its variation, as TCP does)
+// and doubles every time pings time out (RFC 6298 5.5) until the next reply
+// The initial timeout is used until the first reply
+const uint32_t LINK_STATS_MIN_TIMEOUT_MICROS = 20000;
+const uint32_t LINK_STATS_MAX_TIMEOUT_MICROS = 1000000;
+const uint32_t LINK_STATS_INITIAL_TIMEOUT_MICROS = 500000;
+
+// The number of pings in a row without a reply before the connection is lost
+const int LINK_STATS_LOST_PING_LIMIT = 3;
+
+// Link quality summary, times are in microseconds
+struct LinkStats_t
+{
+    uint32_t sent;
+    uint32_t replied;
+    uint32_t lost; // Pings that timed out (or were pushed out of the in flight table)
+    uint32_t late; // Replies to pings that were already counted as lost (also counted in lost)
+    uint32_t outOfOrder; // Replies to a ping older than one that was already replied to
+    uint32_t lossPercent; // Lost out of the pings that replied or were lost
+
+    uint32_t minRtt;
+    uint32_t meanRtt; // Smoothed
+    uint32_t p95Rtt;
+    uint32_t p99Rtt;
+    uint32_t jitter; // Smoothed difference between consecutive round trips
+    uint32_t timeout; // The current reply timeout
+};
+
+// Marks a ping as sent
+void linkStatsPingSent(uint32_t iteration, uint32_t timeMicros);
+
+// Marks a ping as replied to, returns its round trip (0 if the ping isn't in the table anymore or was already replied to)
+// Late replies, to pings already counted as lost, still count as round trips and show the link is up
+uint32_t linkStatsPingReplied(uint32_t iteration, uint32_t timeMicros);
+
+// Counts the pings that are waiting longer than the reply timeout as lost
+// Returns true if the last LINK_STATS_LOST_PING_LIMIT pings were all lost; false otherwise
+bool linkStatsUpdate(uint32_t timeMicros);
+
+// Forgets the pings in flight, when the connection is lost they won't be replied to
+void linkStatsClearInFlight();
+
+// Gets the link quality summary
+void linkStatsGet(LinkStats_t *stats);
+
+// Clears the counters and round trips
+void linkStatsReset();
+
+
+#endif // end _LINK_STATS_H_
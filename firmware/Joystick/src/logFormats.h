@@ -0,0 +1,24 @@
+#ifndef _LOG_FORMATS_H_
+#define _LOG_FORMATS_H_
+
+// Every message the firmware logs
+// Only the id of a message and its arguments are sent, the host decoder (tools/JoystickLogDecoder) reads this file
+// to turn them back into text. Messages are identified by their position in the list, so only add to the end.
+// Arguments are formatted with %d, %u, %x (32 bit integers), %s (strings, truncated to LOG_MAX_STRING_LENGTH)
+// and %b (binary data, as hex)
+#define LOG_FORMATS(LOG_FORMAT) \
+    LOG_FORMAT(LOG_RECORDS_DROPPED,         "*** %u log records dropped ***") \
+    LOG_FORMAT(LOG_DEVICE_CONNECTED,        "*** Device %s %x:%x - connected ***") \
+    LOG_FORMAT(LOG_DEVICE_DISCONNECTED,     "*** Device %s - disconnected ***") \
+    LOG_FORMAT(LOG_HID_DEVICE_CONNECTED,    "*** HID Device %s %x:%x - connected ***") \
+    LOG_FORMAT(LOG_HID_DEVICE_DISCONNECTED, "*** HID Device %s - disconnected ***") \
+    LOG_FORMAT(LOG_DEVICE_MANUFACTURER,     "  manufacturer: %s") \
+    LOG_FORMAT(LOG_DEVICE_PRODUCT,          "  product: %s") \
+    LOG_FORMAT(LOG_DEVICE_SERIAL_NUMBER,    "  Serial: %s") \
+    LOG_FORMAT(LOG_JOYSTICK_REPORT,         "Joystick(%d): buttons = %x axes = %d %d %d %d %d") \
+    LOG_FORMAT(LOG_JOYSTICK_AXIS_CHANGED,   "Joystick(%d): axis %d:%d") \
+    LOG_FORMAT(LOG_JOYSTICK_EVENTS_DROPPED, "*** %u input events dropped ***") \
+    LOG_FORMAT(LOG_HID_CAPTURE,             "HID capture %b")
+
+
+#endif // end _LOG_FORMATS_H_
@@ -0,0 +1,131 @@
+#include "logger.h"
+
+// The log buffer is a single writer, single reader ring
+// The positions only ever count up, so the amount of data in the buffer is always head - tail
+uint8_t LogBuffer[LOG_BUFFER_SIZE];
+volatile uint32_t LogBufferHead = 0; // Where the next record is written
+volatile uint32_t LogBufferTail = 0; // Where the next byte is sent from
+uint32_t LogDroppedCount = 0;
+uint32_t LogDroppedUnreported = 0; // Dropped records that haven't been reported in the log yet
+Print *LogPort = &Serial;
+
+void logRecordBegin(LogRecord_t *record, LogFormatId id)
+{
+    uint32_t timestamp = micros();
+    record->length = 0;
+    record->data[record->length++] = LOG_RECORD_START;
+    record->data[record->length++] = id;
+    logRecordAppend(record, timestamp);
+}
+
+void logRecordAppend(LogRecord_t *record, const char *text)
+{
+    // Strings are stored as their length followed by the characters, truncated to fit
+    int lengthIndex = record->length;
+    if (lengthIndex >= LOG_MAX_RECORD_SIZE)
+    {
+        return;
+    }
+    record->length++;
+
+    int length = 0;
+    if (text != NULL)
+    {
+        while (text[length] != '\0' && length < LOG_MAX_STRING_LENGTH && record->length < LOG_MAX_RECORD_SIZE)
+        {
+            record->data[record->length++] = text[length++];
+        }
+    }
+    record->data[lengthIndex] = length;
+}
+
+void logRecordAppend(LogRecord_t *record, const uint8_t *text)
+{
+    logRecordAppend(record, (const char *)text);
+}
+
+void logRecordAppend(LogRecord_t *record, LogBytes_t bytes)
+{
+    // Binary arguments are truncated to fit like strings, but can hold any byte
+    int lengthIndex = record->length;
+    if (lengthIndex >= LOG_MAX_RECORD_SIZE)
+    {
+        return;
+    }
+    record->length++;
+
+    int length = 0;
+    while (length < bytes.length && length < LOG_MAX_STRING_LENGTH && record->length < LOG_MAX_RECORD_SIZE)
+    {
+        record->data[record->length++] = bytes.data[length++];
+    }
+    record->data[lengthIndex] = length;
+}
+
+bool logBufferWrite(const uint8_t *data, int length)
+{
+    uint32_t head = LogBufferHead;
+    if (LOG_BUFFER_SIZE - (head - LogBufferTail) < (uint32_t)length)
+    {
+        return false;
+    }
+
+    for (int i = 0; i < length; i++)
+    {
+        LogBuffer[(head + i) & (LOG_BUFFER_SIZE - 1)] = data[i];
+    }
+
+    // Only publish the record once all of it is in the buffer
+    LogBufferHead = head + length;
+    return true;
+}
+
+void logRecordCommit(LogRecord_t *record)
+{
+    // Report records that were dropped before the next record that makes it into the buffer
+    if (LogDroppedUnreported > 0)
+    {
+        LogRecord_t droppedRecord;
+        logRecordBegin(&droppedRecord, LOG_RECORDS_DROPPED);
+        logRecordAppend(&droppedRecord, LogDroppedUnreported);
+        if (logBufferWrite(droppedRecord.data, droppedRecord.length))
+        {
+            LogDroppedUnreported = 0;
+        }
+    }
+
+    if (LogDroppedUnreported > 0 || !logBufferWrite(record->data, record->length))
+    {
+        LogDroppedCount++;
+        LogDroppedUnreported++;
+    }
+}
+
+void logDrain()
+{
+    // Only send what the serial port can take without blocking
+    uint32_t tail = LogBufferTail;
+    uint32_t pending = LogBufferHead - tail;
+    int writable = LogPort->availableForWrite();
+    while (pending > 0 && writable > 0)
+    {
+        // Send the data up to the end of the buffer, then wrap around
+        uint32_t start = tail & (LOG_BUFFER_SIZE - 1);
+        uint32_t length = min(min(pending, LOG_BUFFER_SIZE - start), (uint32_t)writable);
+        LogPort->write(LogBuffer + start, length);
+        tail += length;
+        pending -= length;
+        writable -= length;
+    }
+    LogBufferTail = tail;
+}
+
+void logSetPort(Print *port)
+{
+    LogPort = port;
+}
+
+uint32_t logDroppedCount()
+{
+    return LogDroppedCount;
+}
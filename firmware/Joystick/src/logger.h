@@ -0,0 +1,128 @@
+#ifndef _LOGGER_H_
+#define _LOGGER_H_
+
+#include <Arduino.h>
+#include <type_traits>
+#include "logFormats.h"
+
+// Log levels, messages below LOG_LEVEL are compiled out (build with -DLOG_LEVEL=LOG_LEVEL_DEBUG to see every message)
+#define LOG_LEVEL_DEBUG 0
+#define LOG_LEVEL_INFO 1
+#define LOG_LEVEL_WARNING 2
+#define LOG_LEVEL_ERROR 3
+#ifndef LOG_LEVEL
+#define LOG_LEVEL LOG_LEVEL_INFO
+#endif
+
+// Size of the ring buffer that holds records until they are written to the serial port (must be a power of two)
+const uint32_t LOG_BUFFER_SIZE = 1024;
+
+// The largest record that can be logged, and the longest string argument (longer strings are truncated)
+const int LOG_MAX_RECORD_SIZE = 64;
+const int LOG_MAX_STRING_LENGTH = 24;
+
+// Every record starts with this byte so the host decoder can find the start of the next record after an error
+const uint8_t LOG_RECORD_START = 0x1E;
+
+// The ids of the log messages
+#define LOG_FORMAT_ID(id, text) id,
+enum LogFormatId : uint8_t
+{
+    LOG_FORMATS(LOG_FORMAT_ID)
+    LOG_FORMAT_COUNT,
+};
+#undef LOG_FORMAT_ID
+
+// A log record that is being built
+// Records are the start byte, the message id, a microsecond timestamp and then the arguments
+// Integers are 4 bytes (little endian) and strings are a length byte followed by the characters
+struct LogRecord_t
+{
+    uint8_t data[LOG_MAX_RECORD_SIZE];
+    int length;
+};
+
+// Starts a new record for a message
+void logRecordBegin(LogRecord_t *record, LogFormatId id);
+
+// Appends a string argument to a record
+void logRecordAppend(LogRecord_t *record, const char *text);
+void logRecordAppend(LogRecord_t *record, const uint8_t *text);
+
+// A binary argument, stored like a string (a length byte followed by the bytes)
+struct LogBytes_t
+{
+    const uint8_t *data;
+    int length;
+};
+
+// Appends a binary argument to a record
+void logRecordAppend(LogRecord_t *record, LogBytes_t bytes);
+
+// Appends an integer argument to a record
+template <typename T>
+void logRecordAppend(LogRecord_t *record, T value)
+{
+    static_assert(std::is_integral<T>::value || std::is_enum<T>::value, "Log arguments must be integers or strings");
+    if (record->length + 4 <= LOG_MAX_RECORD_SIZE)
+    {
+        uint32_t bits = (uint32_t)value;
+        for (int i = 0; i < 4; i++, bits >>= 8)
+        {
+            record->data[record->length++] = bits & 0xFF;
+        }
+    }
+}
+
+// Adds a record to the log buffer, it is dropped (and counted) if the buffer is full
+// Records must only be logged from the main loop, the buffer has a single writer and a single reader (logDrain())
+void logRecordCommit(LogRecord_t *record);
+
+// Logs a message with its arguments without formatting it or waiting for the serial port
+template <typename... Args>
+void logWrite(LogFormatId id, Args... args)
+{
+    LogRecord_t record;
+    logRecordBegin(&record, id);
+    int unused[] = { 0, (logRecordAppend(&record, args), 0)... };
+    (void)unused;
+    logRecordCommit(&record);
+}
+
+// Writes as much of the log buffer to the serial port as it can take without blocking
+// Call this when the main loop is idle
+void logDrain();
+
+// Sets the serial port the log is written to (Serial by default)
+// The log is binary, so nothing else may be written to its port
+void logSetPort(Print *port);
+
+// Gets the number of records dropped because the log buffer was full
+uint32_t logDroppedCount();
+
+#if LOG_LEVEL <= LOG_LEVEL_DEBUG
+#define LOG_DEBUG(...) logWrite(__VA_ARGS__)
+#else
+#define LOG_DEBUG(...) do {} while (0)
+#endif
+
+#if LOG_LEVEL <= LOG_LEVEL_INFO
+#define LOG_INFO(...) logWrite(__VA_ARGS__)
+#else
+#define LOG_INFO(...) do {} while (0)
+#endif
+
+#if LOG_LEVEL <= LOG_LEVEL_WARNING
+#define LOG_WARNING(...) logWrite(__VA_ARGS__)
+#else
+#define LOG_WARNING(...) do {} while (0)
+#endif
+
+#if LOG_LEVEL <= LOG_LEVEL_ERROR
+#define LOG_ERROR(...) logWrite(__VA_ARGS__)
+#else
+#define LOG_ERROR(...) do {} while (0)
+#endif
+
+
+#endif // end _LOGGER_H_
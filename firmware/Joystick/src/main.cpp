@@ -2,6 +2,10 @@
 #include "status.h"
 #include "joystickHid.h"
 #include "ux.h"
+#include "scheduler.h"
+#include "logger.h"
+#include "latencyTrace.h"
+#include "coms.h"
 #include "pb_encode.h"
 #include "pb_decode.h"
 #include "Joystick.pb.h"
@@ -9,21 +13,185 @@
 SystemStatus_t SystemStatus;
 
 JoystickHidData_t JoystickHidData;
+JoystickHidChanges_t JoystickHidChanges;
+
+// Main loop tasks
+// HID input is polled at 1kHz and must never wait behind a display frame for more than a period,
+// the display is drawn when the UX needs it (input changes and its own refresh rate) and is put off while input is due
+const uint32_t HID_TASK_PERIOD = 1000;
+const uint32_t HID_TASK_DEADLINE = 1000;
+const uint32_t DISPLAY_TASK_DEADLINE = 40000;
+const uint32_t COMS_TASK_PERIOD = 1000;
+const uint32_t COMS_TASK_DEADLINE = 1000;
+
+void hidTask();
+void displayTask();
+void comsTask();
+
+SchedulerTask_t HidTask = { "HID", hidTask, HID_TASK_PERIOD, HID_TASK_DEADLINE, false };
+SchedulerTask_t DisplayTask = { "UX", displayTask, 0, DISPLAY_TASK_DEADLINE, true };
+SchedulerTask_t ComsTask = { "COM", comsTask, COMS_TASK_PERIOD, COMS_TASK_DEADLINE, false };
+
+// The aggregator link runs over the first hardware UART
+const uint32_t COMS_BAUD_RATE = 115200;
+
+// With UX_PROFILE the serial monitor is used for the profiling commands, so the binary log moves to the second hardware UART
+// (at the rate the log decoder opens serial ports with)
+const uint32_t PROFILE_LOG_BAUD_RATE = 115200;
+
+int comsSerialRead(uint8_t *data, int length);
+int comsSerialWrite(const uint8_t *data, int length);
+void comsTraced(pb_size_t messageTag, uint32_t traceId, bool written);
+
+const ComsPort_t ComsSerialPort = { comsSerialRead, comsSerialWrite, comsTraced };
 
 void setup()
 {
     joystickHidInit();
     uxInit();
+
+    Serial1.begin(COMS_BAUD_RATE);
+    comsInit(&ComsSerialPort);
+
+#ifdef UX_PROFILE
+    Serial2.begin(PROFILE_LOG_BAUD_RATE);
+    logSetPort(&Serial2);
+#endif
+
+#ifdef HID_CAPTURE
+    // Stream every joystick report over the serial port so the session can be replayed (see hidCapture.h)
+    joystickHidSetCapture(true);
+#endif
+
+    schedulerAddTask(&HidTask);
+    schedulerAddTask(&DisplayTask);
+    schedulerAddTask(&ComsTask);
 }
 
 void loop()
 {
-    // Update the status of the joystick HID device
-    bool joystickUpdated = joystickHidUpdate(&JoystickHidData);
+    // Run the next task that is due, the log is only sent to the serial port when there is nothing else to do
+    // and then the core sleeps until the next task is due (or the USB host or the serial port need it)
+    if (!schedulerRun())
+    {
+        logDrain();
+        schedulerIdle();
+    }
+
+#ifdef UX_PROFILE
+    // Profiling commands from the serial monitor, the log is on Serial2 so it doesn't get mixed into the replies
+    // 'p' prints the render statistics, 'r' clears them and 'f' dumps the current frame as a PBM image
+    // 'o' prints (and clears) how many joystick output reports were requested and how many were sent
+    // 'l' prints the input to wire latency percentiles (see latencyTrace.h)
+    // 'c' prints the aggregator link statistics, the ping round trips, the achieved propulsion rate and the transmit queue times
+    if (Serial.available())
+    {
+        switch (Serial.read())
+        {
+            case 'p':
+                uxProfilePrint(&Serial);
+                break;
+            case 'r':
+                uxProfileReset();
+                break;
+            case 'f':
+                uxWriteFramePbm(&Serial);
+                break;
+            case 'o':
+            {
+                JoystickOutputStats_t stats;
+                joystickHidGetOutputStats(&stats);
+                Serial.printf("Joystick outputs: %lu requested, %lu sent\n", (unsigned long)stats.requested, (unsigned long)stats.sent);
+                joystickHidResetOutputStats();
+                break;
+            }
+            case 'l':
+                latencyTracePrint(&Serial);
+                break;
+            case 'c':
+            {
+                ComsStats_t *stats = comsStats();
+                Serial.printf("Link: %lu frames sent, %lu received, %lu bad\n", (unsigned long)stats->framesSent,
+                    (unsigned long)stats->framesReceived, (unsigned long)stats->badFrames);
+                Serial.printf("Status: %lu full, %lu deltas, %lu resyncs\n", (unsigned long)stats->statusSnapshots,
+                    (unsigned long)stats->statusDeltas, (unsigned long)stats->statusResyncs);
+                const char *classNames[COMS_TX_CLASS_COUNT] = { "Abort", "Command", "Propulsion", "Ping", "Status" };
+                for (int i = 0; i < COMS_TX_CLASS_COUNT; i++)
+                {
+                    ComsTxClassStats_t *txClass = &stats->txClasses[i];
+                    Serial.printf("%s queue us: %lu sent, mean %lu, max %lu, %lu aged\n", classNames[i], (unsigned long)txClass->sent,
+                        (unsigned long)(txClass->sent > 0 ? txClass->totalQueueMicros / txClass->sent : 0),
+                        (unsigned long)txClass->maxQueueMicros, (unsigned long)txClass->aged);
+                }
+                Serial.printf("Propulsion: %lu/s, %lu sent (%lu keepalives), %lu dropped\n", (unsigned long)stats->propulsionRate,
+                    (unsigned long)stats->propulsionSent, (unsigned long)stats->propulsionKeepalives, (unsigned long)stats->propulsionDropped);
+
+                LinkStats_t link;
+                linkStatsGet(&link);
+                Serial.printf("Ping: %lu sent, %lu replied, %lu lost (%lu%%), %lu late, %lu out of order\n", (unsigned long)link.sent,
+                    (unsigned long)link.replied, (unsigned long)link.lost, (unsigned long)link.lossPercent, (unsigned long)link.late,
+                    (unsigned long)link.outOfOrder);
+                Serial.printf("RTT us: min %lu, mean %lu, p95 %lu, p99 %lu, jitter %lu, timeout %lu\n", (unsigned long)link.minRtt,
+                    (unsigned long)link.meanRtt, (unsigned long)link.p95Rtt, (unsigned long)link.p99Rtt, (unsigned long)link.jitter,
+                    (unsigned long)link.timeout);
+                break;
+            }
+        }
+    }
+#endif
+}
+
+void hidTask()
+{
+    // Update the status of the joystick HID device, quiet polls don't wake the UX
+    bool joystickUpdated = joystickHidUpdate(&JoystickHidData, &JoystickHidChanges);
+
+    // Turn the input into requests right away, the display task can be put off
+    uxHandleInput(&SystemStatus, &JoystickHidData);
 
-    // If required, update the UX (user inputs and display outputs) 
+    // If required, update the UX (user inputs and display outputs)
     if (uxUpdateRequired(joystickUpdated, false))
     {
-        uxUpdate(&SystemStatus, &JoystickHidData);
+        schedulerTrigger(&DisplayTask);
     }
 }
+
+void displayTask()
+{
+    uxUpdate(&SystemStatus, &JoystickHidData);
+}
+
+void comsTask()
+{
+    // Send what is waiting on the link and apply the replies that came in, status changes wake the UX
+    bool comsUpdated = comsUpdate(&SystemStatus, millis(), micros());
+    comsSendRequests(&SystemStatus, millis(), micros());
+
+    if (uxUpdateRequired(false, comsUpdated))
+    {
+        schedulerTrigger(&DisplayTask);
+    }
+}
+
+int comsSerialRead(uint8_t *data, int length)
+{
+    int count = 0;
+    while (count < length && Serial1.available() > 0)
+    {
+        data[count++] = Serial1.read();
+    }
+    return count;
+}
+
+int comsSerialWrite(const uint8_t *data, int length)
+{
+    // Only what fits in the transmit buffer is written, so the link never waits on the UART
+    int room = min(Serial1.availableForWrite(), length);
+    return room > 0 ? Serial1.write(data, room) : 0;
+}
+
+void comsTraced(pb_size_t messageTag, uint32_t traceId, bool written)
+{
+    LatencyTraceKind kind = messageTag == JoystickMessage_set_propulsion_tag ? LATENCY_TRACE_PROPULSION : LATENCY_TRACE_TRIGGER;
+    latencyTraceMark(kind, traceId, written ? LATENCY_POINT_WIRE_WRITTEN : LATENCY_POINT_FRAME_ENCODED, micros());
+}
@@ -0,0 +1,243 @@
+#include "scheduler.h"
+
+// The weight of the newest run in each task's moving average run time (1/8)
+const int SCHEDULER_AVERAGE_SHIFT = 3;
+
+SchedulerTask_t *SchedulerTasks[SCHEDULER_MAX_TASKS];
+int SchedulerTaskCount = 0;
+
+// The idle timer only has to wake the core, its interrupt has nothing else to do
+IntervalTimer SchedulerIdleTimer;
+SchedulerIdleStats_t SchedulerIdle;
+
+bool schedulerIsReleased(SchedulerTask_t *task, uint32_t now)
+{
+    if (task->periodMicros == 0)
+    {
+        return task->triggered;
+    }
+    return (int32_t)(now - task->releaseMicros) >= 0;
+}
+
+uint32_t schedulerDeadline(SchedulerTask_t *task)
+{
+    return task->releaseMicros + task->deadlineMicros;
+}
+
+bool schedulerWouldDelayOthers(SchedulerTask_t *task, uint32_t now)
+{
+    // A task is never put off past its own deadline
+    // The prediction uses the recent worst case, the all time worst is only a statistic
+    uint32_t finishMicros = now + task->recentMaxRunMicros;
+    if ((int32_t)(finishMicros - schedulerDeadline(task)) > 0)
+    {
+        return false;
+    }
+
+    // Check if any task that can't be put off would finish late if it had to wait for this task
+    for (int i = 0; i < SchedulerTaskCount; i++)
+    {
+        SchedulerTask_t *other = SchedulerTasks[i];
+        if (other == task || other->deferrable)
+        {
+            continue;
+        }
+
+        // Triggered tasks that haven't been released yet can't be predicted
+        if (other->periodMicros == 0 && !other->triggered)
+        {
+            continue;
+        }
+
+        if ((int32_t)(finishMicros + other->averageRunMicros - schedulerDeadline(other)) > 0)
+        {
+            return true;
+        }
+    }
+    return false;
+}
+
+void schedulerAddTask(SchedulerTask_t *task)
+{
+    if (SchedulerTaskCount >= SCHEDULER_MAX_TASKS)
+    {
+        return;
+    }
+
+    task->releaseMicros = micros();
+    task->triggered = false;
+    task->deferred = false;
+    SchedulerTasks[SchedulerTaskCount++] = task;
+}
+
+void schedulerTrigger(SchedulerTask_t *task)
+{
+    uint32_t now = micros();
+    if (task->periodMicros == 0)
+    {
+        if (!task->triggered)
+        {
+            task->triggered = true;
+            task->releaseMicros = now;
+        }
+    }
+    else if ((int32_t)(now - task->releaseMicros) < 0)
+    {
+        task->releaseMicros = now;
+    }
+}
+
+bool schedulerRun()
+{
+    uint32_t now = micros();
+
+    // Pick the released task with the earliest deadline
+    // Deferrable tasks that would make other tasks late are put off until those tasks have run
+    uint32_t passedOverMask = 0;
+    SchedulerTask_t *next;
+    while (true)
+    {
+        int nextIndex = -1;
+        for (int i = 0; i < SchedulerTaskCount; i++)
+        {
+            SchedulerTask_t *task = SchedulerTasks[i];
+            if ((passedOverMask & (1 << i)) || !schedulerIsReleased(task, now))
+            {
+                continue;
+            }
+            if (nextIndex == -1 || (int32_t)(schedulerDeadline(task) - schedulerDeadline(SchedulerTasks[nextIndex])) < 0)
+            {
+                nextIndex = i;
+            }
+        }
+
+        if (nextIndex == -1)
+        {
+            return false;
+        }
+
+        next = SchedulerTasks[nextIndex];
+        if (next->deferrable && schedulerWouldDelayOthers(next, now))
+        {
+            if (!next->deferred)
+            {
+                next->deferred = true;
+                next->deferrals++;
+            }
+            passedOverMask |= 1 << nextIndex;
+            continue;
+        }
+        break;
+    }
+
+    // Run the task
+    uint32_t startMicros = micros();
+    next->run();
+    uint32_t finishMicros = micros();
+
+    // Update the task's statistics
+    uint32_t runMicros = finishMicros - startMicros;
+    uint32_t latenessMicros = startMicros - next->releaseMicros;
+    next->runs++;
+    next->averageRunMicros = next->averageRunMicros - (next->averageRunMicros >> SCHEDULER_AVERAGE_SHIFT) + (runMicros >> SCHEDULER_AVERAGE_SHIFT);
+    next->maxRunMicros = max(next->maxRunMicros, runMicros);
+    next->recentMaxRunMicros = max(next->recentMaxRunMicros - (next->recentMaxRunMicros >> SCHEDULER_AVERAGE_SHIFT), runMicros);
+    next->maxLatenessMicros = max(next->maxLatenessMicros, latenessMicros);
+    if ((int32_t)(finishMicros - schedulerDeadline(next)) > 0)
+    {
+        next->overruns++;
+    }
+
+    // Set up the next release of the task
+    // Periodic tasks that fell more than a period behind start over from now instead of running back to back
+    next->deferred = false;
+    if (next->periodMicros == 0)
+    {
+        next->triggered = false;
+    }
+    else
+    {
+        next->releaseMicros += next->periodMicros;
+        if ((int32_t)(finishMicros - next->releaseMicros) > (int32_t)next->periodMicros)
+        {
+            next->releaseMicros = finishMicros;
+        }
+    }
+    return true;
+}
+
+void schedulerIdleWake()
+{
+}
+
+void schedulerIdle()
+{
+    // Find the next release, tasks that only run when triggered are released by other tasks or interrupts
+    uint32_t now = micros();
+    bool releasePending = false;
+    uint32_t releaseMicros = 0;
+    for (int i = 0; i < SchedulerTaskCount; i++)
+    {
+        SchedulerTask_t *task = SchedulerTasks[i];
+        if (task->periodMicros != 0 && (!releasePending || (int32_t)(task->releaseMicros - releaseMicros) < 0))
+        {
+            releasePending = true;
+            releaseMicros = task->releaseMicros;
+        }
+    }
+    int32_t sleepMicros = (int32_t)(releaseMicros - now) - (int32_t)SCHEDULER_IDLE_WAKE_MARGIN;
+    if (!releasePending || sleepMicros < (int32_t)SCHEDULER_IDLE_MIN_SLEEP)
+    {
+        return;
+    }
+
+    // Interrupts stay masked until the core is asleep so one that comes in first still wakes it
+    __disable_irq();
+    SchedulerIdleTimer.begin(schedulerIdleWake, sleepMicros);
+#ifdef __arm__
+    asm volatile("wfi");
+#endif
+    SchedulerIdleTimer.end();
+    __enable_irq();
+
+    // Only wake ups by the idle timer are late, USB and serial interrupts wake the core before it is due
+    uint32_t wakeMicros = micros();
+    int32_t wakeLatencyMicros = (int32_t)(wakeMicros - (now + sleepMicros));
+    SchedulerIdle.sleeps++;
+    SchedulerIdle.sleptMicros += wakeMicros - now;
+    if (wakeLatencyMicros > 0)
+    {
+        SchedulerIdle.maxWakeLatencyMicros = max(SchedulerIdle.maxWakeLatencyMicros, (uint32_t)wakeLatencyMicros);
+    }
+}
+
+SchedulerIdleStats_t *schedulerIdleStats()
+{
+    return &SchedulerIdle;
+}
+
+int schedulerTaskCount()
+{
+    return SchedulerTaskCount;
+}
+
+SchedulerTask_t *schedulerTask(int index)
+{
+    return SchedulerTasks[index];
+}
+
+void schedulerResetStatistics()
+{
+    for (int i = 0; i < SchedulerTaskCount; i++)
+    {
+        SchedulerTask_t *task = SchedulerTasks[i];
+        task->runs = 0;
+        task->overruns = 0;
+        task->deferrals = 0;
+        task->averageRunMicros = 0;
+        task->maxRunMicros = 0;
+        task->recentMaxRunMicros = 0;
+        task->maxLatenessMicros = 0;
+    }
+    memset(&SchedulerIdle, 0, sizeof(SchedulerIdle));
+}
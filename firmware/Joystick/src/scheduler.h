@@ -0,0 +1,90 @@
+#ifndef _SCHEDULER_H_
+#define _SCHEDULER_H_
+
+#include <Arduino.h>
+
+// The maximum number of tasks the main loop scheduler can run
+const int SCHEDULER_MAX_TASKS = 8;
+
+// While idle the core sleeps until the next task is released, waking this long before the release to cover its wake latency
+// Idle periods shorter than the minimum sleep are spun through instead
+const uint32_t SCHEDULER_IDLE_WAKE_MARGIN = 20;
+const uint32_t SCHEDULER_IDLE_MIN_SLEEP = 50;
+
+// A task run cooperatively by the main loop
+// Tasks are released periodically (or when triggered) and the released task with the earliest deadline runs first
+struct SchedulerTask_t
+{
+    // A short name for the task, shown on the loop statistics menu
+    const char *name;
+
+    // The function that does the task's work, it must return without blocking
+    void (*run)();
+
+    // The amount of time between releases of the task, 0 for tasks that only run when triggered
+    uint32_t periodMicros;
+
+    // The amount of time after its release that the task must finish by
+    uint32_t deadlineMicros;
+
+    // Whether or not the task can be put off when running it would make other tasks miss their deadlines
+    bool deferrable;
+
+    // When the task was (or will next be) released
+    uint32_t releaseMicros;
+
+    // Whether or not a triggered task has been released
+    bool triggered;
+
+    // Whether or not the current release of the task has already been put off
+    bool deferred;
+
+    // Statistics
+    uint32_t runs;
+    uint32_t overruns; // Runs that finished after their deadline
+    uint32_t deferrals; // Releases that were put off to protect the deadlines of other tasks
+    uint32_t averageRunMicros; // Moving average of the time the task takes to run
+    uint32_t maxRunMicros;
+    uint32_t recentMaxRunMicros; // The longest recent run, decays towards the newer runs so one slow run doesn't count forever
+    uint32_t maxLatenessMicros; // The longest time between a release and the task starting
+};
+
+// Adds a task to the scheduler, periodic tasks are released right away
+void schedulerAddTask(SchedulerTask_t *task);
+
+// Releases a task now (if it isn't already released)
+void schedulerTrigger(SchedulerTask_t *task);
+
+// Runs the released task with the earliest deadline, if any
+// Returns true if a task was run; false otherwise
+bool schedulerRun();
+
+// Gets the number of tasks added to the scheduler
+int schedulerTaskCount();
+
+// Gets a task added to the scheduler, in the order they were added
+SchedulerTask_t *schedulerTask(int index);
+
+// Idle statistics
+struct SchedulerIdleStats_t
+{
+    uint32_t sleeps;
+    uint32_t sleptMicros;
+
+    // The longest time between the wake up being due and the core running again, must stay under SCHEDULER_IDLE_WAKE_MARGIN
+    // so sleeping never delays a task
+    uint32_t maxWakeLatencyMicros;
+};
+
+// Sleeps the core (WFI) until the next task is released or an interrupt (USB host, serial...) wakes it
+// Call this when schedulerRun() has nothing to run
+void schedulerIdle();
+
+// Gets the idle statistics
+SchedulerIdleStats_t *schedulerIdleStats();
+
+// Clears the statistics of every task and the idle statistics
+void schedulerResetStatistics();
+
+
+#endif // end _SCHEDULER_H_
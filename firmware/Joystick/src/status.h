@@ -1,7 +1,7 @@
 #ifndef _STATUS_H_
 #define _STATUS_H_
 
-#include <Arduino.h>
+#include <stdint.h>
 
 const int IGNIOR_CONTROLLER_COUNT = 3;
 
@@ -42,6 +42,10 @@ struct SystemStatus_t
     // Whether or not a visual test has been requested by the UX
     bool visualTestUpdateRequested;
 
+    // The latency traces (see latencyTrace.h) of the input that requested the propulsion update and the sequence trigger
+    uint32_t propulsionTraceId;
+    uint32_t sequenceTriggerTraceId;
+
 
     //
     // UX Noitification
@@ -153,8 +157,12 @@ struct SystemStatus_t
     //
 
     /// The last time a propulsion system update was sent to the aggregator
+    /// Updates are paced on a fixed grid, so while the sticks keep moving this is the time the update was due
     uint32_t lastPropulsionMessageSentMillis;
 
+    // The number of times the UX changed the propulsion values, updates that weren't sent before the next one are dropped
+    uint32_t propulsionUpdateCount;
+
     // The left propulsion value
     uint8_t propulsionLeft;
     
@@ -177,11 +185,7 @@ struct SystemStatus_t
     // Fault status
     //
 
-    // The last fault message received from the aggregator
-    char faultMessage[255];
-
-    // The length of the last fault message received from the aggregator
-    int faultMessageLength = -1;
+    // The faults received from the aggregator are kept in the fault log (see faultLog.h)
 };
 
 
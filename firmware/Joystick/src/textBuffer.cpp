@@ -0,0 +1,68 @@
+#include "textBuffer.h"
+
+void textBufferClear(TextBuffer_t *buffer)
+{
+    buffer->length = 0;
+    buffer->text[0] = '\0';
+}
+
+void textBufferAppend(TextBuffer_t *buffer, char c)
+{
+    if (buffer->length < TEXT_BUFFER_CAPACITY)
+    {
+        buffer->text[buffer->length++] = c;
+        buffer->text[buffer->length] = '\0';
+    }
+}
+
+void textBufferAppend(TextBuffer_t *buffer, const char *text, int length)
+{
+    for (int i = 0; i < length && text[i] != '\0' && buffer->length < TEXT_BUFFER_CAPACITY; i++)
+    {
+        buffer->text[buffer->length++] = text[i];
+    }
+    buffer->text[buffer->length] = '\0';
+}
+
+void textBufferAppendNumber(TextBuffer_t *buffer, uint32_t value)
+{
+    // Build the digits backwards, then append them in order
+    char digits[10];
+    int digitCount = 0;
+    do
+    {
+        digits[digitCount++] = '0' + (value % 10);
+        value /= 10;
+    } while (value != 0);
+
+    while (digitCount > 0)
+    {
+        textBufferAppend(buffer, digits[--digitCount]);
+    }
+}
+
+void textBufferAppendTime(TextBuffer_t *buffer, uint32_t timeInMillis)
+{
+    const uint32_t MINUTE_IN_MILLIS = 60000;
+    const uint32_t SECOND_IN_MILLIS = 1000;
+    if (timeInMillis > MINUTE_IN_MILLIS)
+    {
+        textBufferAppendNumber(buffer, timeInMillis / MINUTE_IN_MILLIS);
+        textBufferAppend(buffer, 'm');
+        textBufferAppendNumber(buffer, (timeInMillis % MINUTE_IN_MILLIS) / SECOND_IN_MILLIS);
+        textBufferAppend(buffer, 's');
+    }
+    else
+    {
+        textBufferAppendNumber(buffer, timeInMillis / SECOND_IN_MILLIS);
+        textBufferAppend(buffer, 's');
+    }
+}
+
+void textBufferAppendMillis(TextBuffer_t *buffer, uint32_t timeInMicros)
+{
+    uint32_t tenths = (timeInMicros + 50) / 100;
+    textBufferAppendNumber(buffer, tenths / 10);
+    textBufferAppend(buffer, '.');
+    textBufferAppendNumber(buffer, tenths % 10);
+}
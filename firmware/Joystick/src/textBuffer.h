@@ -0,0 +1,36 @@
+#ifndef _TEXT_BUFFER_H_
+#define _TEXT_BUFFER_H_
+
+#include <Arduino.h>
+
+// The maximum number of characters a text buffer can hold (not including the null terminator)
+const int TEXT_BUFFER_CAPACITY = 31;
+
+// A fixed capacity, null terminated text buffer that never allocates
+// Text appended past the capacity is dropped
+struct TextBuffer_t
+{
+    char text[TEXT_BUFFER_CAPACITY + 1];
+    int length;
+};
+
+// Empties the text buffer
+void textBufferClear(TextBuffer_t *buffer);
+
+// Appends a single character to the text buffer
+void textBufferAppend(TextBuffer_t *buffer, char c);
+
+// Appends the first length characters of text to the text buffer, stopping early at a null terminator
+void textBufferAppend(TextBuffer_t *buffer, const char *text, int length = TEXT_BUFFER_CAPACITY);
+
+// Appends the decimal representation of value to the text buffer
+void textBufferAppendNumber(TextBuffer_t *buffer, uint32_t value);
+
+// Appends a duration to the text buffer formatted as "<minutes>m<seconds>s" or "<seconds>s" when under a minute
+void textBufferAppendTime(TextBuffer_t *buffer, uint32_t timeInMillis);
+
+// Appends a short duration to the text buffer in milliseconds with one decimal, formatted as "<millis>.<tenths>"
+void textBufferAppendMillis(TextBuffer_t *buffer, uint32_t timeInMicros);
+
+
+#endif // end _TEXT_BUFFER_H_
@@ -1,4 +1,9 @@
 #include "ux.h"
+#include "textBuffer.h"
+#include "scheduler.h"
+#include "latencyTrace.h"
+#include "linkStats.h"
+#include "faultLog.h"
 #include <Adafruit_GFX.h>
 #include <Adafruit_PCD8544.h>
 
@@ -6,7 +11,7 @@
 // Constants
 // =============================================================================
 
-const int UX_REFRESH_RATE = 40;
+const int UX_REFRESH_RATE = 40; // The maximum amount of time between UX updates when there are no joystick or coms updates (25Hz)
 const int UX_NOTIFICATION_TIMEOUT = 2000; // The amount of time to display a notification before clearing it
 
 // Menu input mappings
@@ -16,22 +21,23 @@ const int MENU_HOME_BUTTON = BUTTON_MENU_1;
 const int VISUAL_TEST_BUTTON = BUTTON_MENU_2;
 const int VISUAL_TEST_UP_BUTTON = DPAD_UP;
 const int VISUAL_TEST_DOWN_BUTTON = DPAD_DOWN;
+const int FAULT_NEWER_BUTTON = DPAD_UP;
+const int FAULT_OLDER_BUTTON = DPAD_DOWN;
 const int PROPULSION_LEFT_AXIS = AXIS_LEFT_STICK_Y;
 const int PROPULSION_RIGHT_AXIS = AXIS_RIGHT_STICK_Y;
 const int DISARM_BUTTON = BUTTON_1;
+const int CALIBRATE_BUTTON = BUTTON_1;
 const int TRIGGER_SEQ_BUTTON_1 = BUTTON_L_TRIGGER;
 const int TRIGGER_SEQ_BUTTON_2 = BUTTON_R_TRIGGER;
 
-// Propulsion system input mappings
-const int PROPULSION_CENTER = 128; // Center value for the propulsion system
-const int PROPULSION_DEADZONE = 5; // Deadzone for the propulsion system
 
 // Menu top bar constrains
 const int MENU_HEADER_HEIGHT = 10;
 
 // Menu navigation
 typedef void (*MenuHandler)(SystemStatus_t *systemStatus, JoystickHidData_t *joystickHidData);
-const int MENU_COUNT = 7;
+typedef void (*MenuInputHandler)(SystemStatus_t *systemStatus, const JoystickEvent_t *event);
+const int MENU_COUNT = 10;
 const int HOME_MENU = 0;
 
 // Menu line positions
@@ -43,6 +49,30 @@ const int MENU_LINE_4 = MENU_LINE_3 + MENU_LINE_HEIGHT;
 const int CENTER_VERTICALLY = -1;
 const int CENTER_VERTICALLY_FULL_SCREEN = -2;
 
+// Text metrics
+// All UX text uses the fixed width classic font at size 1, so text is measured by counting characters instead of
+// scanning it with getTextBounds(). The widths match getTextBounds() at x = 0, including lines that wrap.
+const int FONT_CHARACTER_WIDTH = 6; // Width of a character of the classic font, including the spacing column
+const int TEXT_MAX_LINE_WIDTH = (LCDWIDTH / FONT_CHARACTER_WIDTH) * FONT_CHARACTER_WIDTH; // Width of a full (wrapping) line
+
+// Width in pixels of a line of length characters
+constexpr int textWidth(int length)
+{
+    return length * FONT_CHARACTER_WIDTH < TEXT_MAX_LINE_WIDTH ? length * FONT_CHARACTER_WIDTH : TEXT_MAX_LINE_WIDTH;
+}
+
+// Number of characters before the end of the first line of text (carriage returns aren't drawn)
+constexpr int textLineLength(const char *text)
+{
+    return (*text == '\0' || *text == '\n') ? 0 : (*text == '\r' ? 0 : 1) + textLineLength(text + 1);
+}
+
+// Width in pixels of the first line of text, known at compile time for string literals
+constexpr int textLineWidth(const char *text)
+{
+    return textWidth(textLineLength(text));
+}
+
 // Trigger sequence values
 const int TRIGGER_SEQ_HOLDTIME = 3000; // The amount of time the trigger sequence buttons must be held to trigger the sequence
 
@@ -51,9 +81,67 @@ const int VISUAL_TEST_TOGGLE_HOLD_TIME = 2500; // Time to hold the visual test b
 const int VISUAL_TEST_TYPE_MIN = 0;
 const int VISUAL_TEST_TYPE_MAX = 3;
 
+// Joystick output values
+const JoystickLeds_t ARMED_JOYSTICK_LEDS = { 0xff, 0, 0, 0x0F }; // The joysticks show red (every player LED on PS3 joysticks) while the system is armed
+const uint8_t TRIGGER_RUMBLE_STRENGTH = 0xff; // The joysticks rumble once the trigger buttons were held long enough to trigger the sequence
+const uint8_t TRIGGER_RUMBLE_TIMEOUT = 0xff;
+
 // Arm/disarm constants
 const int ARM_DIGITS_TIMEOUT = 1500; // The amount of time between arm digit presses before the system times out and resets the arm code
 
+// Debug menu values
+const int DEBUG_STATS_REFRESH_TIME = 500; // The amount of time between redraws of statistics that change every frame
+
+// Retained-mode widgets
+// Each widget owns a rectangle of the display and is only redrawn (and flushed) when the model it was drawn from changes.
+// The content widgets of a menu (lines 1-4 or the body) tile the area below the menu top bar so that switching
+// between them never leaves stale pixels behind.
+enum UxWidgetId
+{
+    UX_WIDGET_NAV_LEFT = 0,
+    UX_WIDGET_NAV_RIGHT,
+    UX_WIDGET_TITLE,
+    UX_WIDGET_LINE_1,
+    UX_WIDGET_LINE_2,
+    UX_WIDGET_LINE_3,
+    UX_WIDGET_LINE_4,
+    UX_WIDGET_BODY,
+    UX_WIDGET_NOTIFICATION,
+    UX_WIDGET_COUNT,
+};
+
+struct UxWidgetRect_t
+{
+    int16_t x;
+    int16_t y;
+    int16_t width;
+    int16_t height;
+};
+
+const int MENU_NAV_TRIANGLE_SIZE = 8;
+const UxWidgetRect_t UX_WIDGET_RECTS[UX_WIDGET_COUNT] =
+{
+    { 0, 0, MENU_NAV_TRIANGLE_SIZE + 1, MENU_HEADER_HEIGHT },                                                                   // UX_WIDGET_NAV_LEFT
+    { LCDWIDTH - 1 - MENU_NAV_TRIANGLE_SIZE, 0, MENU_NAV_TRIANGLE_SIZE + 1, MENU_HEADER_HEIGHT },                               // UX_WIDGET_NAV_RIGHT
+    { MENU_NAV_TRIANGLE_SIZE + 1, 0, LCDWIDTH - (2 * (MENU_NAV_TRIANGLE_SIZE + 1)), MENU_HEADER_HEIGHT },                       // UX_WIDGET_TITLE
+    { 0, MENU_HEADER_HEIGHT + 1, LCDWIDTH, MENU_LINE_2 - (MENU_HEADER_HEIGHT + 1) },                                             // UX_WIDGET_LINE_1
+    { 0, MENU_LINE_2, LCDWIDTH, MENU_LINE_HEIGHT },                                                                             // UX_WIDGET_LINE_2
+    { 0, MENU_LINE_3, LCDWIDTH, MENU_LINE_HEIGHT },                                                                             // UX_WIDGET_LINE_3
+    { 0, MENU_LINE_4, LCDWIDTH, LCDHEIGHT - MENU_LINE_4 },                                                                      // UX_WIDGET_LINE_4
+    { 0, MENU_HEADER_HEIGHT + 1, LCDWIDTH, LCDHEIGHT - (MENU_HEADER_HEIGHT + 1) },                                              // UX_WIDGET_BODY
+    { 0, 0, LCDWIDTH, LCDHEIGHT },                                                                                              // UX_WIDGET_NOTIFICATION
+};
+
+// Marquee (scrolls text that is too wide for the display through one page of the body)
+const int UX_MARQUEE_PAGE = 2; // The display page (8 rows) the marquee scrolls through, just below the menu top bar
+const int UX_MARQUEE_Y = UX_MARQUEE_PAGE * 8; // The top row of the marquee page, text that fits is drawn there too so it doesn't move when it starts scrolling
+const int UX_MARQUEE_STEP_TIME = 40; // The amount of time between each one column step of the marquee (25 columns/s)
+const int UX_MARQUEE_GAP_COLUMNS = 4 * FONT_CHARACTER_WIDTH; // Blank columns between the end of the text and the start of its repeat
+
+// Layout values used to detect when the whole display needs to be redrawn
+const int UX_LAYOUT_INVALID = -1;
+const int UX_LAYOUT_NOTIFICATION = -2;
+
 
 // =============================================================================
 // Global Variables
@@ -63,7 +151,10 @@ uint32_t lastUxUpdateMillis = 0;
 Adafruit_PCD8544 Display = Adafruit_PCD8544(5, 4, 3);
 int CurrentMenu = 0;
 
-uint32_t triggerSequenceButtonsPressedStart = INT32_MAX;
+// The buttons left down by the input events handled so far
+uint32_t InputButtonsHeld = 0;
+
+uint32_t triggerSequenceButtonsPressedStartMicros = 0;
 bool triggerSequenceButtonsPressed = false;
 bool triggerSequenceButtonsPressedToAbort = false;
 bool triggerSequenceButtonsTimeout = false;
@@ -71,38 +162,101 @@ bool triggerSequenceButtonsTimeout = false;
 bool CycleLeftPressed = false;
 bool CycleRightPressed = false;
 
-uint32_t VisualTestPressedMillis = 0;
-bool VisualTestPressed = false;
-bool VisualTestUpPressed = false;
-bool VisualTestDownPressed = false;
-
 // Arm system menu state
 uint8_t ArmUnlockCode = 0; // Every two bits is one digit of the unlock code
 uint8_t ArmDigitsEntered = 0;
-uint32_t lastArmDigitEnteredMillis = 0;
+uint32_t lastArmDigitEnteredMicros = 0;
 bool NextArmDigitPressed = false;
 
+// Calibration menu state
+bool CalibrationSaved = false;
+bool CalibrationSaveRequested = false; // Saving writes the EEPROM, so it is left to the next display update instead of the input handling
+
+// Whether or not the joysticks show the armed LEDs
+bool JoystickArmedLedsShown = false;
+
+// Loop menu state, the idle time is shown for the time since the last redraw
+uint32_t LoopIdleSleptMicros = 0;
+uint32_t LoopIdleSampleMicros = 0;
+
+// Retained-mode widget state
+struct UxWidget_t
+{
+    // The model (bound values or a hash of them) the widget was last drawn with
+    uint32_t model;
+
+    // Whether or not the widget's pixels in the display buffer were drawn from model
+    bool valid;
+};
+UxWidget_t UxWidgets[UX_WIDGET_COUNT];
+uint32_t UxWidgetsDrawnMask = 0; // Every bit is one widget that was drawn (or kept) during the current frame
+int UxLayout = UX_LAYOUT_INVALID; // The menu (or notification) the widgets are currently laid out for
+bool UxFrameDirty = false; // Whether or not any widget was redrawn during the current frame
+bool UxFlushPending = false; // Whether or not redrawn widgets are waiting for the previous display update to finish
+
+#ifdef UX_PROFILE
+// Render statistics of each menu, the last entry is for notifications
+struct UxProfile_t
+{
+    uint32_t frames;
+    uint32_t totalMicros;
+    uint32_t maxMicros;
+    uint32_t bytesSent; // Bytes sent to the display, including updates that are still in progress
+};
+UxProfile_t UxProfiles[MENU_COUNT + 1];
+const char *UX_PROFILE_NAMES[MENU_COUNT + 1] =
+{
+    "Status",
+    "Vis. Test",
+    "Sequence",
+    "Joysticks",
+    "Ignition",
+    "Fault",
+    "Arm System",
+    "Calibrate",
+    "Loop",
+    "Latency",
+    "Notification",
+};
+#endif
+
+// Marquee state
+uint32_t MarqueeStartMillis = 0; // When the marquee text was first drawn
+uint32_t MarqueeOffset = 0; // The text column currently drawn in the leftmost display column
+
+// Fault menu state
+int FaultMenuIndex = 0; // The fault log entry shown, 0 is the newest
+
 
 // =============================================================================
 // Function Prototypes
 // =============================================================================
 
-// Input detection helpers
+// Input helpers
+void handleInputEvent(SystemStatus_t *systemStatus, const JoystickEvent_t *event);
 void updatePropulsionFromInput(SystemStatus_t *systemStatus, JoystickHidData_t *joystickHidData);
-void updateSequenceTriggerFromInput(SystemStatus_t *systemStatus, JoystickHidData_t *joystickHidData);
-void updateSelectedMenuFromInput(JoystickHidData_t *joystickHidData);
-void updateVisualTestStatusRequestFromInput(SystemStatus_t *systemStatus, JoystickHidData_t *joystickHidData);
+void updateSequenceTriggerFromEvent(SystemStatus_t *systemStatus, const JoystickEvent_t *event);
+void updateSelectedMenuFromEvent(const JoystickEvent_t *event);
+void updateVisualTestStatusRequestFromEvent(SystemStatus_t *systemStatus, const JoystickEvent_t *event);
+void updateJoystickLedsFromStatus(SystemStatus_t *systemStatus);
 
 // Drawing helpers
 void drawNotification(SystemStatus_t *systemStatus);
 void drawMenuTopBar(bool cycleLeftHeld, bool cycleRightHeld);
-void drawMenuTitle(String title);
+void drawMenuTitle(const char *title);
 void drawConnectionTimer(SystemStatus_t *systemStatus);
-void drawCenteredText(String text, int y);
+void drawCenteredText(const char *text, int y);
+void drawBodyText(const char *text);
 void drawSelectionTriangle(int x, int y, bool selected);
+bool drawMarquee(UxWidgetId widget, const char *text, int length, uint32_t model);
+void drawMarqueeColumn(int x, const char *text, int length, uint32_t textColumn);
 
-// String helpers
-String getTimeString(uint32_t timeInMillis);
+// Retained-mode widget helpers
+void uxBeginFrame(int layout);
+void uxEndFrame();
+bool uxWidgetNeedsRedraw(UxWidgetId widget, uint32_t model);
+uint32_t uxHash(const char *text, uint32_t hash = 2166136261u);
+uint32_t uxHash(uint32_t value, uint32_t hash = 2166136261u);
 
 // Menu handlers (render menu and handle user interaction)
 void handleStatusMenu(SystemStatus_t *systemStatus, JoystickHidData_t *joystickHidData);
@@ -112,6 +266,9 @@ void handleJoystickMenu(SystemStatus_t *systemStatus, JoystickHidData_t *joystic
 void handleIgnitorMenu(SystemStatus_t *systemStatus, JoystickHidData_t *joystickHidData);
 void handleFaultMenu(SystemStatus_t *systemStatus, JoystickHidData_t *joystickHidData);
 void handleArmSystemMenu(SystemStatus_t *systemStatus, JoystickHidData_t *joystickHidData);
+void handleCalibrationMenu(SystemStatus_t *systemStatus, JoystickHidData_t *joystickHidData);
+void handleLoopMenu(SystemStatus_t *systemStatus, JoystickHidData_t *joystickHidData);
+void handleLatencyMenu(SystemStatus_t *systemStatus, JoystickHidData_t *joystickHidData);
 
 // Menu handler function pointers
 const MenuHandler MenuHandlers[MENU_COUNT] = 
@@ -123,6 +280,30 @@ const MenuHandler MenuHandlers[MENU_COUNT] =
     handleIgnitorMenu,
     handleFaultMenu,
     handleArmSystemMenu,
+    handleCalibrationMenu,
+    handleLoopMenu,
+    handleLatencyMenu,
+};
+
+// Menu input handlers (handle the input events that happen while the menu is shown)
+void handleVisibilityTestInput(SystemStatus_t *systemStatus, const JoystickEvent_t *event);
+void handleArmSystemInput(SystemStatus_t *systemStatus, const JoystickEvent_t *event);
+void handleCalibrationInput(SystemStatus_t *systemStatus, const JoystickEvent_t *event);
+void handleFaultInput(SystemStatus_t *systemStatus, const JoystickEvent_t *event);
+
+// Menu input handler function pointers, menus without input are nullptr
+const MenuInputHandler MenuInputHandlers[MENU_COUNT] =
+{
+    nullptr,
+    handleVisibilityTestInput,
+    nullptr,
+    nullptr,
+    nullptr,
+    handleFaultInput,
+    handleArmSystemInput,
+    handleCalibrationInput,
+    nullptr,
+    nullptr,
 };
 
 // =============================================================================
@@ -142,41 +323,61 @@ void uxInit()
     Display.setTextSize(1);
     Display.setTextColor(BLACK);
 
-    // Draw the top menu bar
+    // Draw the top menu bar and render it to the display
+    uxBeginFrame(CurrentMenu);
     drawMenuTopBar(CycleLeftPressed, CycleRightPressed);
     drawMenuTitle("Status");
-
-    // Render the current buffer to the display
-    Display.display();
+    uxEndFrame();
 }
 
 bool uxUpdateRequired(bool joystickUpdated, bool comsUpdated)
 {
+    // Input and coms changes are handled right away
     if (joystickUpdated || comsUpdated)
     {
         return true;
     }
-    else if (millis() - lastUxUpdateMillis >= UX_REFRESH_RATE)
+
+    // Retry sending the last frame as soon as the display is done with the previous one
+    if (UxFlushPending && !Display.displayInProgress())
     {
         return true;
     }
-    else
+
+    // Otherwise, refresh at the UX refresh rate so time based widgets (timers, notification timeouts) stay current
+    return millis() - lastUxUpdateMillis >= UX_REFRESH_RATE;
+}
+
+void uxHandleInput(SystemStatus_t *systemStatus, JoystickHidData_t *joystickHidData)
+{
+    // Perform updates to the UX state based on joystick input
+    // Button and d-pad edges are handled in the order they happened, so presses between UX updates aren't lost
+    JoystickEvent_t event;
+    while (joystickHidNextEvent(&event))
     {
-        // If the joystick was updated, update the display
-        return true;
+        handleInputEvent(systemStatus, &event);
     }
+    updatePropulsionFromInput(systemStatus, joystickHidData);
+    updateJoystickLedsFromStatus(systemStatus);
 }
 
 void uxUpdate(SystemStatus_t *systemStatus, JoystickHidData_t *joystickHidData)
 {
-    // Clear the display
-    Display.clearDisplay();
+#ifdef UX_PROFILE
+    uint32_t profileStartMicros = micros();
+    uint32_t profileStartBytes = Display.getBytesSent();
+#endif
 
-    // Perform updates to the UX state based on joystick input
-    updatePropulsionFromInput(systemStatus, joystickHidData);
-    updateSequenceTriggerFromInput(systemStatus, joystickHidData);
-    updateSelectedMenuFromInput(joystickHidData);
-    updateVisualTestStatusRequestFromInput(systemStatus, joystickHidData);
+    // Save the calibration the calibrate button ended
+    if (CalibrationSaveRequested)
+    {
+        joystickHidEndCalibration();
+        CalibrationSaveRequested = false;
+        CalibrationSaved = true;
+    }
+
+    // Start a new frame, redrawing everything if switching between menus or notifications
+    uxBeginFrame(systemStatus->notificationType != UX_NOTIFICATION_NONE ? UX_LAYOUT_NOTIFICATION : CurrentMenu);
 
     // If there is a notification to display, draw it
     if (systemStatus->notificationType != UX_NOTIFICATION_NONE)
@@ -194,23 +395,112 @@ void uxUpdate(SystemStatus_t *systemStatus, JoystickHidData_t *joystickHidData)
         MenuHandlers[CurrentMenu](systemStatus, joystickHidData);
     }
 
-    // Update the display 
-    Display.display();
+    // Update the display with the widgets that changed
+    uxEndFrame();
 
     // Update the last UX update time
     lastUxUpdateMillis = millis();
+
+#ifdef UX_PROFILE
+    // Charge the frame to the menu (or notification) that was drawn
+    UxProfile_t *profile = &UxProfiles[UxLayout == UX_LAYOUT_NOTIFICATION ? MENU_COUNT : UxLayout];
+    uint32_t elapsedMicros = micros() - profileStartMicros;
+    profile->frames++;
+    profile->totalMicros += elapsedMicros;
+    profile->maxMicros = max(profile->maxMicros, elapsedMicros);
+    profile->bytesSent += Display.getBytesSent() - profileStartBytes;
+#endif
+}
+
+#ifdef UX_PROFILE
+void uxProfilePrint(Print *out)
+{
+    for (int i = 0; i <= MENU_COUNT; i++)
+    {
+        UxProfile_t *profile = &UxProfiles[i];
+        if (profile->frames == 0)
+        {
+            continue;
+        }
+
+        out->print(UX_PROFILE_NAMES[i]);
+        out->print(": ");
+        out->print(profile->frames);
+        out->print(" frames, avg ");
+        out->print(profile->totalMicros / profile->frames);
+        out->print("us, max ");
+        out->print(profile->maxMicros);
+        out->print("us, ");
+        out->print((float)profile->bytesSent / profile->frames);
+        out->println(" SPI bytes/frame");
+    }
+}
+
+void uxProfileReset()
+{
+    memset(UxProfiles, 0, sizeof(UxProfiles));
+}
+
+void uxWriteFramePbm(Print *out)
+{
+    // Binary PBM: a text header, then each row of pixels packed 8 to a byte (MSB first, 1 is black)
+    out->print("P4\n");
+    out->print(LCDWIDTH);
+    out->print(" ");
+    out->print(LCDHEIGHT);
+    out->print("\n");
+
+    // The display buffer is stored a page (8 rows) at a time, one byte per column with the top row in the LSB
+    uint8_t *buffer = Display.getBuffer();
+    for (int y = 0; y < LCDHEIGHT; y++)
+    {
+        const uint8_t *page = buffer + ((y / 8) * LCDWIDTH);
+        uint8_t rowMask = 1 << (y % 8);
+        for (int x = 0; x < LCDWIDTH; x += 8)
+        {
+            uint8_t packed = 0;
+            for (int bit = 0; bit < 8 && x + bit < LCDWIDTH; bit++)
+            {
+                if (page[x + bit] & rowMask)
+                {
+                    packed |= 0x80 >> bit;
+                }
+            }
+            out->write(packed);
+        }
+    }
+}
+#endif
+
+void handleInputEvent(SystemStatus_t *systemStatus, const JoystickEvent_t *event)
+{
+    // Keep track of the buttons that are down, for inputs that are combinations of buttons
+    if (event->type == JOYSTICK_EVENT_PRESS)
+    {
+        InputButtonsHeld |= event->button;
+    }
+    else if (event->type == JOYSTICK_EVENT_RELEASE)
+    {
+        InputButtonsHeld &= ~event->button;
+    }
+
+    updateSequenceTriggerFromEvent(systemStatus, event);
+    updateSelectedMenuFromEvent(event);
+    updateVisualTestStatusRequestFromEvent(systemStatus, event);
+
+    // The current menu only gets input while it is shown
+    if (systemStatus->notificationType == UX_NOTIFICATION_NONE && MenuInputHandlers[CurrentMenu] != nullptr)
+    {
+        MenuInputHandlers[CurrentMenu](systemStatus, event);
+    }
 }
 
 void updatePropulsionFromInput(SystemStatus_t *systemStatus, JoystickHidData_t *joystickHidData)
 {
     // Read the left and right propulsion values from the joystick axis
-    // If either joystick is in the deadzone, set the propulsion value to the center value
+    // The axes are already calibrated by the HID layer, sticks in their deadzone read as centered
     int leftPropulsion = joystickHidData->axis[PROPULSION_LEFT_AXIS];
-    leftPropulsion = leftPropulsion < PROPULSION_CENTER - PROPULSION_DEADZONE || leftPropulsion > PROPULSION_CENTER + PROPULSION_DEADZONE
-        ? leftPropulsion : PROPULSION_CENTER;
     int rightPropulsion = joystickHidData->axis[PROPULSION_RIGHT_AXIS];
-    rightPropulsion = rightPropulsion < PROPULSION_CENTER - PROPULSION_DEADZONE || rightPropulsion > PROPULSION_CENTER + PROPULSION_DEADZONE
-        ? rightPropulsion : PROPULSION_CENTER;
 
     // Update the propulsion values in the system status
     if (systemStatus->propulsionLeft != leftPropulsion || systemStatus->propulsionRight != rightPropulsion)
@@ -218,18 +508,26 @@ void updatePropulsionFromInput(SystemStatus_t *systemStatus, JoystickHidData_t *
         systemStatus->propulsionLeft = leftPropulsion;
         systemStatus->propulsionRight = rightPropulsion;
 
-        // Request an update to the propulsion system
+        // Request an update to the propulsion system, only the latest values are sent
         systemStatus->propulsionUpdateRequested = true;
+        systemStatus->propulsionUpdateCount++;
+        systemStatus->propulsionTraceId = joystickHidData->trace.id;
+        latencyTraceRequest(LATENCY_TRACE_PROPULSION, &joystickHidData->trace, micros());
     }
 }
 
-void updateSequenceTriggerFromInput(SystemStatus_t *systemStatus, JoystickHidData_t *joystickHidData)
+void updateSequenceTriggerFromEvent(SystemStatus_t *systemStatus, const JoystickEvent_t *event)
 {
-    bool triggerButtonsCurrentlyPressed = (joystickHidData->buttons & TRIGGER_SEQ_BUTTON_1) && (joystickHidData->buttons & TRIGGER_SEQ_BUTTON_2);
+    if (!(event->button & (TRIGGER_SEQ_BUTTON_1 | TRIGGER_SEQ_BUTTON_2)))
+    {
+        return;
+    }
+    bool triggerButtonsCurrentlyPressed = (InputButtonsHeld & TRIGGER_SEQ_BUTTON_1) && (InputButtonsHeld & TRIGGER_SEQ_BUTTON_2);
 
     // If both of the sequence trigger buttons are pressed and a sequence is currently running,
     // request the sequence to abort. 
-    if (triggerButtonsCurrentlyPressed && systemStatus->isSequenceRunning && !triggerSequenceButtonsPressed)
+    if (event->type == JOYSTICK_EVENT_PRESS && triggerButtonsCurrentlyPressed && systemStatus->isSequenceRunning
+        && !triggerSequenceButtonsPressed)
     {
         systemStatus->sequenceAbortRequested = true;
 
@@ -246,9 +544,10 @@ void updateSequenceTriggerFromInput(SystemStatus_t *systemStatus, JoystickHidDat
     // If both of the sequence trigger buttons are pressed and a sequence is not currently running,
     // start a timer so that when the trigger buttons are held for a certain amount of time,
     // the selected sequence will be triggered.
-    else if (triggerButtonsCurrentlyPressed && !triggerSequenceButtonsPressed)
+    // The timer starts when the second button went down, not when the UX noticed it
+    else if (event->type == JOYSTICK_EVENT_PRESS && triggerButtonsCurrentlyPressed && !triggerSequenceButtonsPressed)
     {
-        triggerSequenceButtonsPressedStart = millis();
+        triggerSequenceButtonsPressedStartMicros = event->timeMicros;
         systemStatus->notificationType = UX_NOTIFICATION_HOLD_TO_TRIGGER;
 
         triggerSequenceButtonsPressed = true;
@@ -258,17 +557,20 @@ void updateSequenceTriggerFromInput(SystemStatus_t *systemStatus, JoystickHidDat
 
     // If the trigger buttons are pressed for a certain amount of time, trigger the sequence
     // NOTE: This won't happen if the triggers were initially pressed to abort the sequence
-    else if (!triggerSequenceButtonsPressedToAbort && triggerSequenceButtonsPressed && !triggerSequenceButtonsTimeout
-        && millis() - triggerSequenceButtonsPressedStart >= TRIGGER_SEQ_HOLDTIME)
+    else if (event->type == JOYSTICK_EVENT_HOLD && !triggerSequenceButtonsPressedToAbort && triggerSequenceButtonsPressed
+        && !triggerSequenceButtonsTimeout && event->timeMicros - triggerSequenceButtonsPressedStartMicros >= TRIGGER_SEQ_HOLDTIME * 1000UL)
     {
         systemStatus->sequenceTriggerRequested = true;
+        systemStatus->sequenceTriggerTraceId = event->trace.id;
+        latencyTraceRequest(LATENCY_TRACE_TRIGGER, &event->trace, micros());
         systemStatus->notificationType = UX_NOTIFICATION_TRIGGERING;
         systemStatus->notificationStartMillis = millis();
         triggerSequenceButtonsTimeout = true;
+        joystickHidRumble(-1, TRIGGER_RUMBLE_STRENGTH, TRIGGER_RUMBLE_STRENGTH, TRIGGER_RUMBLE_TIMEOUT);
     }
 
     // If the trigger buttons have been released, reset the triggering sequence
-    else if (!triggerButtonsCurrentlyPressed && triggerSequenceButtonsPressed)
+    else if (event->type == JOYSTICK_EVENT_RELEASE && triggerSequenceButtonsPressed)
     {
         if (systemStatus->notificationType == UX_NOTIFICATION_HOLD_TO_TRIGGER)
         {
@@ -279,38 +581,55 @@ void updateSequenceTriggerFromInput(SystemStatus_t *systemStatus, JoystickHidDat
     }
 }
 
-void updateSelectedMenuFromInput(JoystickHidData_t *joystickHidData)
+void updateJoystickLedsFromStatus(SystemStatus_t *systemStatus)
+{
+    // Software or physically armed shows on the joysticks, otherwise they show the button feedback
+    bool armed = systemStatus->isSoftwareArmed || systemStatus->isPhysicallyArmed;
+    if (armed != JoystickArmedLedsShown)
+    {
+        joystickHidSetStatusLeds(armed ? &ARMED_JOYSTICK_LEDS : NULL);
+        JoystickArmedLedsShown = armed;
+    }
+}
+
+void updateSelectedMenuFromEvent(const JoystickEvent_t *event)
 {
     // If the home button is pressed, reset the menu to the home menu
-    if (joystickHidData->buttons & MENU_HOME_BUTTON)
+    if (event->type == JOYSTICK_EVENT_PRESS && event->button == MENU_HOME_BUTTON)
     {
         CurrentMenu = HOME_MENU;
     }
 
     // Cycle the selected menu left whenever the left menu cycle button is released
-    if (joystickHidData->buttons & LEFT_MENU_CYCLE_BUTTON)
+    if (event->button == LEFT_MENU_CYCLE_BUTTON)
     {
-        CycleLeftPressed = true;
-    }
-    else if (CycleLeftPressed)
-    {
-        CycleLeftPressed = false;
-        CurrentMenu = (CurrentMenu - 1 + MENU_COUNT) % MENU_COUNT;
+        if (event->type == JOYSTICK_EVENT_PRESS)
+        {
+            CycleLeftPressed = true;
+        }
+        else if (event->type == JOYSTICK_EVENT_RELEASE)
+        {
+            CycleLeftPressed = false;
+            CurrentMenu = (CurrentMenu - 1 + MENU_COUNT) % MENU_COUNT;
+        }
     }
 
     // Cycle the selected menu right whenever the right menu cycle button is released
-    if (joystickHidData->buttons & RIGHT_MENU_CYCLE_BUTTON)
+    if (event->button == RIGHT_MENU_CYCLE_BUTTON)
     {
-        CycleRightPressed = true;
-    }
-    else if (CycleRightPressed)
-    {
-        CycleRightPressed = false;
-        CurrentMenu = (CurrentMenu + 1) % MENU_COUNT;
+        if (event->type == JOYSTICK_EVENT_PRESS)
+        {
+            CycleRightPressed = true;
+        }
+        else if (event->type == JOYSTICK_EVENT_RELEASE)
+        {
+            CycleRightPressed = false;
+            CurrentMenu = (CurrentMenu + 1) % MENU_COUNT;
+        }
     }
 }
 
-void updateVisualTestStatusRequestFromInput(SystemStatus_t *systemStatus, JoystickHidData_t *joystickHidData)
+void updateVisualTestStatusRequestFromEvent(SystemStatus_t *systemStatus, const JoystickEvent_t *event)
 {
     //
     // Visual test button behavior:
@@ -319,13 +638,14 @@ void updateVisualTestStatusRequestFromInput(SystemStatus_t *systemStatus, Joysti
     // When the button is released before VISUAL_TEST_TOGGLE_HOLD_TIME, visual test is disabled (behavior is momentary)
     //
 
-    // When the visual test button is first pressed, update the button status and enable the visual test test
-    if (joystickHidData->buttons & VISUAL_TEST_BUTTON && !VisualTestPressed)
+    if (event->button != VISUAL_TEST_BUTTON)
     {
-        // Update button state
-        VisualTestPressed = true;
-        VisualTestPressedMillis = millis();
+        return;
+    }
 
+    // When the visual test button is first pressed, enable the visual test
+    if (event->type == JOYSTICK_EVENT_PRESS)
+    {
         // If visual test is not already enabled, enable it and request an update
         if (!systemStatus->isVisualTestEnabled)
         {
@@ -334,30 +654,37 @@ void updateVisualTestStatusRequestFromInput(SystemStatus_t *systemStatus, Joysti
         }
     }
 
-    // When the visual test button is released, update the button state and 
-    // disable the visual test if the input was a momentary push instead of a toggle
-    else if (VisualTestPressed && !(joystickHidData->buttons & VISUAL_TEST_BUTTON))
+    // When the visual test button is released, disable the visual test if the input was a momentary push instead of a toggle
+    // The hold time is measured between the edges, not between UX updates
+    else if (event->type == JOYSTICK_EVENT_RELEASE && event->heldMicros < VISUAL_TEST_TOGGLE_HOLD_TIME * 1000UL)
     {
-        // Update button state
-        VisualTestPressed = false;
-
-        // If the button is released before the toggle hold time, disable the visual test
-        if (millis() - VisualTestPressedMillis < VISUAL_TEST_TOGGLE_HOLD_TIME)
-        {
-            systemStatus->isVisualTestEnabled = false;
-            systemStatus->visualTestUpdateRequested = true;
-        }
-        
+        systemStatus->isVisualTestEnabled = false;
+        systemStatus->visualTestUpdateRequested = true;
     }
 }
 
 void drawNotification(SystemStatus_t *systemStatus)
 {
+    // If the current notification isn't a "hold to trigger" notification,  clear the notification after the timeout
+    // NOTE: The notification stays on the display until the next update switches back to the current menu
+    if (systemStatus->notificationType != UX_NOTIFICATION_HOLD_TO_TRIGGER 
+        && millis() - systemStatus->notificationStartMillis >= UX_NOTIFICATION_TIMEOUT)
+    {
+        systemStatus->notificationType = UX_NOTIFICATION_NONE;
+        return;
+    }
+
+    // Only redraw the notification when the notification type changes
+    if (!uxWidgetNeedsRedraw(UX_WIDGET_NOTIFICATION, systemStatus->notificationType))
+    {
+        return;
+    }
+
     // Draw a rounded rectangle around the screen to indicate a notification
     Display.drawRoundRect(0, 0, Display.width(), Display.height(), 5, BLACK);
 
     // Draw the notification message in the center of the screen
-    String notificationText = "";
+    const char *notificationText;
     switch (systemStatus->notificationType)
     {
         case UX_NOTIFICATION_CONNECTED:
@@ -392,84 +719,93 @@ void drawNotification(SystemStatus_t *systemStatus)
             break;
     }
     drawCenteredText(notificationText, CENTER_VERTICALLY_FULL_SCREEN);
-
-    // If the current notification isn't a "hold to trigger" notification,  clear the notification after the timeout
-    if (systemStatus->notificationType != UX_NOTIFICATION_HOLD_TO_TRIGGER 
-        && millis() - systemStatus->notificationStartMillis >= UX_NOTIFICATION_TIMEOUT)
-    {
-        systemStatus->notificationType = UX_NOTIFICATION_NONE;
-    }
 }
 
 void drawMenuTopBar(bool cycleLeftPressed, bool cycleRightPressed)
 {
-    const int triangleSize = 8;
+    const int triangleSize = MENU_NAV_TRIANGLE_SIZE;
     const int leftTriangleStartX = Display.width() - 1 - triangleSize;
 
     // Draw left navigation triangle
     // Invert the triangle region if the left menu cycle button is currently pressed
-    int leftTriangleColor = BLACK;
-    if (cycleLeftPressed)
+    if (uxWidgetNeedsRedraw(UX_WIDGET_NAV_LEFT, cycleLeftPressed))
     {
-        Display.fillRect(0, 0, triangleSize, triangleSize + 1, BLACK);
-        leftTriangleColor = WHITE;
+        int leftTriangleColor = BLACK;
+        if (cycleLeftPressed)
+        {
+            Display.fillRect(0, 0, triangleSize, triangleSize + 1, BLACK);
+            leftTriangleColor = WHITE;
+        }
+        Display.fillTriangle(0, triangleSize / 2, triangleSize, 0, triangleSize, triangleSize, leftTriangleColor);
     }
-    Display.fillTriangle(0, triangleSize / 2, triangleSize, 0, triangleSize, triangleSize, leftTriangleColor);
 
     // Draw right navigation triangle
     // Invert the triangle region if the right menu cycle button is currently pressed
-    int rightTriangleColor = BLACK;
-    if (cycleRightPressed)
+    if (uxWidgetNeedsRedraw(UX_WIDGET_NAV_RIGHT, cycleRightPressed))
     {
-        Display.fillRect(leftTriangleStartX, 0, triangleSize, triangleSize + 1, BLACK);
-        rightTriangleColor = WHITE;
+        int rightTriangleColor = BLACK;
+        if (cycleRightPressed)
+        {
+            Display.fillRect(leftTriangleStartX, 0, triangleSize, triangleSize + 1, BLACK);
+            rightTriangleColor = WHITE;
+        }
+        Display.fillTriangle(Display.width() - 1, triangleSize / 2, leftTriangleStartX, 0, leftTriangleStartX, triangleSize, rightTriangleColor);
     }
-    Display.fillTriangle(Display.width() - 1, triangleSize / 2, leftTriangleStartX, 0, leftTriangleStartX, triangleSize, rightTriangleColor);
 
-    // Draw buttom of menu bar
-    Display.drawLine(0, MENU_HEADER_HEIGHT, Display.width(), MENU_HEADER_HEIGHT, BLACK);
+    // NOTE: The bottom of the menu bar never changes, it is drawn by uxBeginFrame() when the layout changes
 }
 
-void drawMenuTitle(String title)
+void drawMenuTitle(const char *title)
 {
+    // Only redraw the title when it changes
+    if (!uxWidgetNeedsRedraw(UX_WIDGET_TITLE, uxHash(title)))
+    {
+        return;
+    }
+
     // Draw the title into the top menu bar
-    int16_t titleX, titleY;
-    uint16_t titleWidth, titleHeight;
-    Display.getTextBounds(title, 0, 0, &titleX, &titleY, &titleWidth, &titleHeight);
+    int titleWidth = textLineWidth(title);
     Display.setCursor((Display.width()/2) - (titleWidth/2), 1);
-    Display.write(title.c_str());
+    Display.write(title);
 }
 
 void drawConnectionTimer(SystemStatus_t *systemStatus)
 {
+    // Only redraw the connection timer when the displayed time (whole seconds) or the connection state changes
+    uint32_t timeSinceLastConnection = millis() - systemStatus->lastMessageReceivedMillis;
+    if (!uxWidgetNeedsRedraw(UX_WIDGET_BODY, uxHash(timeSinceLastConnection / 1000, uxHash(systemStatus->isConnectionLost))))
+    {
+        return;
+    }
+
     // Create text for the connection timer
-    String connectionTimerText;
+    TextBuffer_t connectionTimerText;
+    textBufferClear(&connectionTimerText);
     if (systemStatus->isConnectionLost)
     {
-        connectionTimerText = "Reconnecting";
+        textBufferAppend(&connectionTimerText, "Reconnecting");
     }
     else
     {
-        connectionTimerText = "Connecting";
+        textBufferAppend(&connectionTimerText, "Connecting");
     }
-    connectionTimerText += "\n";
-    uint32_t timeSinceLastConnection = millis() - systemStatus->lastMessageReceivedMillis;
-    connectionTimerText += getTimeString(timeSinceLastConnection);
+    textBufferAppend(&connectionTimerText, '\n');
+    textBufferAppendTime(&connectionTimerText, timeSinceLastConnection);
 
     // Draw the connection time in the center of the screen
-    drawCenteredText(connectionTimerText, CENTER_VERTICALLY);
+    drawCenteredText(connectionTimerText.text, CENTER_VERTICALLY);
 }
 
-void drawCenteredText(String text, int y)
+void drawCenteredText(const char *text, int y)
 {
     // Get the number of lines in the text
     int lineCount = 1;
-    int currentTextIndex = 0;
-    text.indexOf('\n', 0);
-    while ((currentTextIndex = text.indexOf('\n', currentTextIndex)) != -1)
+    for (const char *c = text; *c != '\0'; c++)
     {
-        lineCount++;
-        currentTextIndex++;
+        if (*c == '\n')
+        {
+            lineCount++;
+        }
     }
 
     // Calculate the y position of the first line
@@ -483,29 +819,102 @@ void drawCenteredText(String text, int y)
     }
 
     // Draw the text
-    int lineStartIndex = 0;
+    const char *lineStart = text;
     for (int i = 0; i < lineCount; i++)
     {
-        // Get the start and end index of the current line
-        int lineEndIndex = text.indexOf('\n', lineStartIndex);
-        if (lineEndIndex == -1)
+        // Get the length and width of the current line
+        int lineLength = 0;
+        int lineCharacters = 0;
+        while (lineStart[lineLength] != '\n' && lineStart[lineLength] != '\0')
         {
-            lineEndIndex = text.length();
+            if (lineStart[lineLength] != '\r')
+            {
+                lineCharacters++;
+            }
+            lineLength++;
         }
+        int lineWidth = textWidth(lineCharacters);
 
-        // Get the current line of text
-        String currentLine = text.substring(lineStartIndex, lineEndIndex);
-        int16_t currentLineX, currentLineY;
-        uint16_t currentLineWidth, currentLineHeight;
-        Display.getTextBounds(currentLine, 0, 0, &currentLineX, &currentLineY, &currentLineWidth, &currentLineHeight);
-        Display.setCursor((Display.width() / 2) - (currentLineWidth / 2), y + (i * MENU_LINE_HEIGHT));
-        Display.write(currentLine.c_str());
+        // Draw the current line of text
+        Display.setCursor((Display.width() / 2) - (lineWidth / 2), y + (i * MENU_LINE_HEIGHT));
+        Display.write(lineStart, lineLength);
 
-        // Update the start index for the next line
-        lineStartIndex = lineEndIndex + 1;
+        // Update the start of the next line
+        lineStart += lineLength + 1;
+    }
+}
+
+void drawBodyText(const char *text)
+{
+    // Draw the text centered in the area below the menu top bar, only redrawing it when the text changes
+    if (uxWidgetNeedsRedraw(UX_WIDGET_BODY, uxHash(text)))
+    {
+        drawCenteredText(text, CENTER_VERTICALLY);
     }
 }
 
+bool drawMarquee(UxWidgetId widget, const char *text, int length, uint32_t model)
+{
+    // Returns true when the widget was cleared, so whatever else shares it has to be drawn again
+    // Text that fits on one line is drawn once, like any other widget, on the same page the marquee scrolls through
+    int textColumns = length * FONT_CHARACTER_WIDTH;
+    if (textColumns <= LCDWIDTH)
+    {
+        if (uxWidgetNeedsRedraw(widget, model))
+        {
+            Display.setCursor(0, UX_MARQUEE_Y);
+            Display.write(text, length);
+            return true;
+        }
+        return false;
+    }
+
+    // Longer text starts scrolling from its first character whenever its model changes (or the widget was drawn over)
+    uint32_t now = millis();
+    uint32_t offset = (now - MarqueeStartMillis) / UX_MARQUEE_STEP_TIME;
+    bool cleared = uxWidgetNeedsRedraw(widget, model);
+    if (cleared)
+    {
+        MarqueeStartMillis = now;
+        offset = 0;
+    }
+    else if (offset == MarqueeOffset)
+    {
+        return false;
+    }
+    else if (offset - MarqueeOffset < LCDWIDTH)
+    {
+        // Move what is already on the display left in place and only draw the columns scrolling in on the right
+        uint32_t steps = offset - MarqueeOffset;
+        Display.shiftColumnsLeft(UX_MARQUEE_PAGE, UX_MARQUEE_PAGE, 0, LCDWIDTH - 1, steps);
+        for (uint32_t x = LCDWIDTH - steps; x < LCDWIDTH; x++)
+        {
+            drawMarqueeColumn(x, text, length, offset + x);
+        }
+        MarqueeOffset = offset;
+        UxFrameDirty = true;
+        return false;
+    }
+
+    // Draw every column when starting over or when the marquee fell a whole screen behind
+    for (int x = 0; x < LCDWIDTH; x++)
+    {
+        drawMarqueeColumn(x, text, length, offset + x);
+    }
+    MarqueeOffset = offset;
+    UxFrameDirty = true;
+    return cleared;
+}
+
+void drawMarqueeColumn(int x, const char *text, int length, uint32_t textColumn)
+{
+    // The text repeats with a gap after it, columns in the gap are drawn as the blank column of a space
+    int textColumns = length * FONT_CHARACTER_WIDTH;
+    textColumn %= textColumns + UX_MARQUEE_GAP_COLUMNS;
+    char c = (textColumn < (uint32_t)textColumns) ? text[textColumn / FONT_CHARACTER_WIDTH] : ' ';
+    Display.drawFastCharColumn(x, UX_MARQUEE_Y, c, textColumn % FONT_CHARACTER_WIDTH, BLACK, WHITE);
+}
+
 void drawSelectionTriangle(int x, int y, bool selected)
 {
     // Draw a triangle at the specified position
@@ -520,24 +929,95 @@ void drawSelectionTriangle(int x, int y, bool selected)
     }
 }
 
-String getTimeString(uint32_t timeInMillis)
+void uxBeginFrame(int layout)
 {
-    const int MINUTE_IN_MILLIS = 60000;
-    const int SECOND_IN_MILLIS = 1000;
-    String timeString = "";
-    if (timeInMillis > MINUTE_IN_MILLIS)
+    UxWidgetsDrawnMask = 0;
+    UxFrameDirty = false;
+
+    // If the layout hasn't changed, keep the widgets that are already on the display
+    if (layout == UxLayout)
     {
-        timeString += (timeInMillis / MINUTE_IN_MILLIS);
-        timeString += "m";
-        timeString += (timeInMillis % MINUTE_IN_MILLIS) / SECOND_IN_MILLIS;
-        timeString += "s";
+        return;
     }
-    else
+
+    // Otherwise, clear the display and invalidate every widget so the new layout is drawn from scratch
+    UxLayout = layout;
+    Display.clearDisplay();
+    for (int i = 0; i < UX_WIDGET_COUNT; i++)
+    {
+        UxWidgets[i].valid = false;
+    }
+
+    // Draw buttom of menu bar
+    if (layout != UX_LAYOUT_NOTIFICATION)
+    {
+        Display.drawLine(0, MENU_HEADER_HEIGHT, Display.width(), MENU_HEADER_HEIGHT, BLACK);
+    }
+    UxFrameDirty = true;
+}
+
+void uxEndFrame()
+{
+    // Widgets that weren't drawn this frame may have been drawn over by other widgets,
+    // so they need to be fully redrawn the next time they are used
+    for (int i = 0; i < UX_WIDGET_COUNT; i++)
+    {
+        if (!(UxWidgetsDrawnMask & (1 << i)))
+        {
+            UxWidgets[i].valid = false;
+        }
+    }
+
+    // Only push the buffer to the display if something was redrawn
+    // The update is sent in the background, if the previous update is still being sent try again next frame
+    if (UxFrameDirty)
+    {
+        UxFlushPending = true;
+    }
+    if (UxFlushPending && Display.displayAsync())
+    {
+        UxFlushPending = false;
+    }
+}
+
+bool uxWidgetNeedsRedraw(UxWidgetId widget, uint32_t model)
+{
+    UxWidgetsDrawnMask |= 1 << widget;
+
+    // If the widget is already showing the model, nothing needs to be drawn
+    UxWidget_t *state = &UxWidgets[widget];
+    if (state->valid && state->model == model)
+    {
+        return false;
+    }
+
+    // Clear the widget so the caller can redraw it
+    const UxWidgetRect_t *rect = &UX_WIDGET_RECTS[widget];
+    Display.fillRect(rect->x, rect->y, rect->width, rect->height, WHITE);
+    state->model = model;
+    state->valid = true;
+    UxFrameDirty = true;
+    return true;
+}
+
+uint32_t uxHash(const char *text, uint32_t hash)
+{
+    // FNV-1a hash of the null terminated text
+    while (*text)
+    {
+        hash = (hash ^ (uint8_t)*text++) * 16777619u;
+    }
+    return hash;
+}
+
+uint32_t uxHash(uint32_t value, uint32_t hash)
+{
+    // FNV-1a hash of the bytes of the value
+    for (int i = 0; i < 4; i++, value >>= 8)
     {
-        timeString += timeInMillis / SECOND_IN_MILLIS;
-        timeString += "s";
+        hash = (hash ^ (value & 0xFF)) * 16777619u;
     }
-    return timeString;
+    return hash;
 }
 
 
@@ -559,94 +1039,121 @@ void handleStatusMenu(SystemStatus_t *systemStatus, JoystickHidData_t *joystickH
 
     // Draw the overall system status on the first line
     // Full caps means that the operator should be aware that fireworks could be ignited
-    Display.setCursor(0, MENU_LINE_1);
+    const char *systemStatusText;
     if (systemStatus->isSequenceRunning && systemStatus->isSoftwareArmed && systemStatus-> isPhysicallyArmed)
     {
-        Display.write("SEQ. RUNNING");
+        systemStatusText = "SEQ. RUNNING";
     }
     else if (systemStatus->isSequenceRunning)
     {
-        Display.write("Seq. Running");
+        systemStatusText = "Seq. Running";
     }
     else if (systemStatus->isFullyArmed)
     {
-        Display.write("SYSTEM ARMED");
+        systemStatusText = "SYSTEM ARMED";
     }
     else if (systemStatus->isSoftwareArmed && systemStatus-> isPhysicallyArmed)
     {
         // In this state, the system is armed but not fully armed
         // This means that at least one of the ignitors is either not connected OR is not pyhsically armed
-        Display.write("ARMED IN PART");
+        systemStatusText = "ARMED IN PART";
     }
     else if (systemStatus-> isPhysicallyArmed)
     {
-        Display.write("Phys. Armed");
+        systemStatusText = "Phys. Armed";
     }
     else if (systemStatus->isSoftwareArmed)
     {
-        Display.write("Soft. Armed");
+        systemStatusText = "Soft. Armed";
     }
     else
     {
-        Display.write("Connected");
+        systemStatusText = "Connected";
+    }
+    if (uxWidgetNeedsRedraw(UX_WIDGET_LINE_1, uxHash(systemStatusText)))
+    {
+        Display.setCursor(0, MENU_LINE_1);
+        Display.write(systemStatusText);
     }
 
-    // Draw the current print round trip time on the second line
-    Display.setCursor(0, MENU_LINE_2);
-    Display.write("Ping:");
-    Display.print(systemStatus->lastPingRoundtripMillis);
-    Display.write("ms");
+    // Draw the link quality on the second line: the mean and p99 ping round trips and the ping loss
+    LinkStats_t linkStats;
+    linkStatsGet(&linkStats);
+    TextBuffer_t pingText;
+    textBufferClear(&pingText);
+    textBufferAppend(&pingText, 'P');
+    textBufferAppendMillis(&pingText, linkStats.meanRtt);
+    textBufferAppend(&pingText, '/');
+    textBufferAppendMillis(&pingText, linkStats.p99Rtt);
+    textBufferAppend(&pingText, ' ');
+    textBufferAppendNumber(&pingText, linkStats.lossPercent);
+    textBufferAppend(&pingText, '%');
+    if (uxWidgetNeedsRedraw(UX_WIDGET_LINE_2, uxHash(pingText.text)))
+    {
+        Display.setCursor(0, MENU_LINE_2);
+        Display.write(pingText.text);
+    }
 
     // Draw the ignition system status on the third line
-    Display.setCursor(0, MENU_LINE_3);
-    Display.write("Ign:");
+    const char *ignitionStatusText;
     if (systemStatus->areAllIgnitorsPhysicallyArmed)
     {
         // All ignitors are connected and armed
-        Display.write("Ready");
+        ignitionStatusText = "Ready";
     }
     else if (systemStatus->areAnyIgnitorsControllersLost)
     {
         // One or more ignitors have lost connection to the aggregator
-        Display.write("Lost");
+        ignitionStatusText = "Lost";
     }
     else if (systemStatus->areAllIgnitorsControllersConnected)
     {
         // All ignitors are connected but not all are armed
-        Display.write("Connected");
+        ignitionStatusText = "Connected";
     }
     else
     {
-        Display.write("Waiting");
+        ignitionStatusText = "Waiting";
+    }
+    if (uxWidgetNeedsRedraw(UX_WIDGET_LINE_3, uxHash(ignitionStatusText)))
+    {
+        Display.setCursor(0, MENU_LINE_3);
+        Display.write("Ign:");
+        Display.write(ignitionStatusText);
     }
 
     // Draw the sequencer status on the fourth line
-    Display.setCursor(0, MENU_LINE_4);
-    Display.write("Seq:");
+    const char *sequencerStatusText;
     if (systemStatus->isSequenceAborted)
     {
         // The sequencer aborted the sequence
-        Display.write("Aborted");
+        sequencerStatusText = "Aborted";
     }
     else if (systemStatus->isSequenceRunning)
     {
         // The sequencer is currently running a sequence
-        Display.write("Running");
+        sequencerStatusText = "Running";
     }
     else if (systemStatus->isSequencerConnectionLost)
     {
         // The sequencer has lost connection to the aggregator
-        Display.write("Lost");
+        sequencerStatusText = "Lost";
     }
     else if (systemStatus->isSequencerConnected)
     {
         // The sequencer is connected and responding to pings
-        Display.write("Ready");
+        sequencerStatusText = "Ready";
     }
     else
     {
         // The sequencer is not connected
-        Display.write("Waiting");
+        sequencerStatusText = "Waiting";
+    }
+    if (uxWidgetNeedsRedraw(UX_WIDGET_LINE_4, uxHash(sequencerStatusText)))
+    {
+        Display.setCursor(0, MENU_LINE_4);
+        Display.write("Seq:");
+        Display.write(sequencerStatusText);
     }
 }
 
@@ -655,56 +1162,47 @@ void handleVisibilityTestMenu(SystemStatus_t *systemStatus, JoystickHidData_t *j
     // Draw the title of the visual test menu
     drawMenuTitle("Vis. Test");
 
-    // Update the visual test type based on joystick input
-    if (joystickHidData->axis[AXIS_DPAD] == VISUAL_TEST_UP_BUTTON)
+    // Draw the visual test type selection menu
+    // Each line is only redrawn when its selection state changes
+    const char *visualTestNames[VISUAL_TEST_TYPE_MAX + 1] = { "Std. Blink", "LED F/B", "RGB Wave", "LED White" };
+    const int visualTestLines[VISUAL_TEST_TYPE_MAX + 1] = { MENU_LINE_1, MENU_LINE_2, MENU_LINE_3, MENU_LINE_4 };
+    const UxWidgetId visualTestWidgets[VISUAL_TEST_TYPE_MAX + 1] = { UX_WIDGET_LINE_1, UX_WIDGET_LINE_2, UX_WIDGET_LINE_3, UX_WIDGET_LINE_4 };
+    for (int i = VISUAL_TEST_TYPE_MIN; i <= VISUAL_TEST_TYPE_MAX; i++)
+    {
+        bool selected = systemStatus->visualTestType == i;
+        if (uxWidgetNeedsRedraw(visualTestWidgets[i], selected))
+        {
+            drawSelectionTriangle(0, visualTestLines[i], selected);
+            Display.setCursor(12, visualTestLines[i]);
+            Display.write(visualTestNames[i]);
+        }
+    }
+}
+
+void handleVisibilityTestInput(SystemStatus_t *systemStatus, const JoystickEvent_t *event)
+{
+    // Cycle the visual test type whenever the d-pad is released from up or down
+    if (event->type != JOYSTICK_EVENT_RELEASE)
     {
-        VisualTestUpPressed = true;
+        return;
     }
-    else if (VisualTestUpPressed)
+    if (event->dpad == VISUAL_TEST_UP_BUTTON)
     {
-        VisualTestUpPressed = false;
         systemStatus->visualTestType = (systemStatus->visualTestType - 1 + (VISUAL_TEST_TYPE_MAX + 1)) % (VISUAL_TEST_TYPE_MAX + 1);
-
-        // If the visual test is currrently enabled, refresh the request to the new visual test type
-        if (systemStatus->isVisualTestEnabled)
-        {
-            systemStatus->visualTestUpdateRequested = true;
-        }
     }
-    if (joystickHidData->axis[AXIS_DPAD] == VISUAL_TEST_DOWN_BUTTON)
+    else if (event->dpad == VISUAL_TEST_DOWN_BUTTON)
     {
-        VisualTestDownPressed = true;
+        systemStatus->visualTestType = (systemStatus->visualTestType + 1) % (VISUAL_TEST_TYPE_MAX + 1);
     }
-    else if (VisualTestDownPressed)
+    else
     {
-        VisualTestDownPressed = false;
-        systemStatus->visualTestType = (systemStatus->visualTestType + 1) % (VISUAL_TEST_TYPE_MAX + 1);
-
-        // If the visual test is currrently enabled, refresh the request to the new visual test type
-        if (systemStatus->isVisualTestEnabled)
-        {
-            systemStatus->visualTestUpdateRequested = true;
-        }
+        return;
     }
 
-    // Draw the visual test type selection menu
-    // TODO: Consider moving effect names to an array in a header somewhere and drawing menu with a for loop
+    // If the visual test is currrently enabled, refresh the request to the new visual test type
+    if (systemStatus->isVisualTestEnabled)
     {
-        drawSelectionTriangle(0, MENU_LINE_1, systemStatus->visualTestType == 0);
-        Display.setCursor(12, MENU_LINE_1);
-        Display.write("Std. Blink");
-
-        drawSelectionTriangle(0, MENU_LINE_2, systemStatus->visualTestType == 1);
-        Display.setCursor(12, MENU_LINE_2);
-        Display.write("LED F/B");
-
-        drawSelectionTriangle(0, MENU_LINE_3, systemStatus->visualTestType == 2);
-        Display.setCursor(12, MENU_LINE_3);
-        Display.write("RGB Wave");
-
-        drawSelectionTriangle(0, MENU_LINE_4, systemStatus->visualTestType == 3);
-        Display.setCursor(12, MENU_LINE_4);
-        Display.write("LED White");
+        systemStatus->visualTestUpdateRequested = true;
     }
 }
 
@@ -719,7 +1217,7 @@ void handleSequenceMenu(SystemStatus_t *systemStatus, JoystickHidData_t *joystic
         return;
     }
 
-    drawCenteredText("Not\nImplemented", CENTER_VERTICALLY);
+    drawBodyText("Not\nImplemented");
 }
 
 void handleJoystickMenu(SystemStatus_t *systemStatus, JoystickHidData_t *joystickHidData)
@@ -728,18 +1226,31 @@ void handleJoystickMenu(SystemStatus_t *systemStatus, JoystickHidData_t *joystic
     drawMenuTitle("Joysticks");
 
     // Draw the left and right joystick axis values
-    Display.setCursor(0, MENU_LINE_1);
-    Display.write("Lx: ");
-    Display.print(joystickHidData->axis[AXIS_LEFT_STICK_X]);
-    Display.setCursor(0, MENU_LINE_2);
-    Display.write("Ly: ");
-    Display.print(joystickHidData->axis[AXIS_LEFT_STICK_Y]);
-    Display.setCursor(0, MENU_LINE_3);
-    Display.write("Rx: ");
-    Display.print(joystickHidData->axis[AXIS_RIGHT_STICK_X]);
-    Display.setCursor(0, MENU_LINE_4);
-    Display.write("Ry: ");
-    Display.print(joystickHidData->axis[AXIS_RIGHT_STICK_Y]);
+    // Each line is only redrawn when its axis value changes
+    if (uxWidgetNeedsRedraw(UX_WIDGET_LINE_1, joystickHidData->axis[AXIS_LEFT_STICK_X]))
+    {
+        Display.setCursor(0, MENU_LINE_1);
+        Display.write("Lx: ");
+        Display.print(joystickHidData->axis[AXIS_LEFT_STICK_X]);
+    }
+    if (uxWidgetNeedsRedraw(UX_WIDGET_LINE_2, joystickHidData->axis[AXIS_LEFT_STICK_Y]))
+    {
+        Display.setCursor(0, MENU_LINE_2);
+        Display.write("Ly: ");
+        Display.print(joystickHidData->axis[AXIS_LEFT_STICK_Y]);
+    }
+    if (uxWidgetNeedsRedraw(UX_WIDGET_LINE_3, joystickHidData->axis[AXIS_RIGHT_STICK_X]))
+    {
+        Display.setCursor(0, MENU_LINE_3);
+        Display.write("Rx: ");
+        Display.print(joystickHidData->axis[AXIS_RIGHT_STICK_X]);
+    }
+    if (uxWidgetNeedsRedraw(UX_WIDGET_LINE_4, joystickHidData->axis[AXIS_RIGHT_STICK_Y]))
+    {
+        Display.setCursor(0, MENU_LINE_4);
+        Display.write("Ry: ");
+        Display.print(joystickHidData->axis[AXIS_RIGHT_STICK_Y]);
+    }
 }
 
 void handleIgnitorMenu(SystemStatus_t *systemStatus, JoystickHidData_t *joystickHidData)
@@ -753,7 +1264,7 @@ void handleIgnitorMenu(SystemStatus_t *systemStatus, JoystickHidData_t *joystick
         return;
     }
 
-    drawCenteredText("Not\nImplemented", CENTER_VERTICALLY);
+    drawBodyText("Not\nImplemented");
 }
 
 void handleFaultMenu(SystemStatus_t *systemStatus, JoystickHidData_t *joystickHidData)
@@ -761,15 +1272,63 @@ void handleFaultMenu(SystemStatus_t *systemStatus, JoystickHidData_t *joystickHi
     drawMenuTitle("Fault");
 
     // If there are no faults, draw the "No Faults" message
-    if (systemStatus->faultMessageLength == -1)
+    if (faultLogCount() == 0)
     {
-        drawCenteredText("No Faults", CENTER_VERTICALLY);
+        drawBodyText("No Faults");
         return;
     }
 
-    // If there is a fault, draw the fault message to the display
-    Display.setCursor(0, MENU_LINE_1);
-    Display.write(systemStatus->faultMessage);
+    // Draw the fault message of the selected entry straight from the fault log
+    // Messages too long for one line scroll across it, the entry is redrawn when the selection or the log changes
+    FaultMenuIndex = min(FaultMenuIndex, faultLogCount() - 1);
+    const FaultLogEntry_t *entry = faultLogGet(FaultMenuIndex);
+    int length;
+    const char *text = faultLogText(entry, &length);
+    if (!drawMarquee(UX_WIDGET_BODY, text, length, uxHash(FaultMenuIndex, uxHash(faultLogTotal()))))
+    {
+        return;
+    }
+
+    // Below the message, draw where the entry is in the log, its source and how many times it repeated
+    const char *sourceNames[FAULT_SOURCE_COUNT] = { "Agg", "Link" };
+    TextBuffer_t entryText;
+    textBufferClear(&entryText);
+    textBufferAppendNumber(&entryText, FaultMenuIndex + 1);
+    textBufferAppend(&entryText, '/');
+    textBufferAppendNumber(&entryText, faultLogCount());
+    textBufferAppend(&entryText, ' ');
+    textBufferAppend(&entryText, sourceNames[entry->source]);
+    if (entry->repeatCount > 1)
+    {
+        textBufferAppend(&entryText, " x");
+        textBufferAppendNumber(&entryText, entry->repeatCount);
+    }
+    Display.setCursor(0, MENU_LINE_3);
+    Display.write(entryText.text);
+
+    // And when it last happened (time since power up)
+    textBufferClear(&entryText);
+    textBufferAppend(&entryText, "T+");
+    textBufferAppendTime(&entryText, entry->lastMillis);
+    Display.setCursor(0, MENU_LINE_4);
+    Display.write(entryText.text);
+}
+
+void handleFaultInput(SystemStatus_t *systemStatus, const JoystickEvent_t *event)
+{
+    // Page through the fault log whenever the d-pad is released from up (newer) or down (older)
+    if (event->type != JOYSTICK_EVENT_RELEASE)
+    {
+        return;
+    }
+    if (event->dpad == FAULT_NEWER_BUTTON && FaultMenuIndex > 0)
+    {
+        FaultMenuIndex--;
+    }
+    else if (event->dpad == FAULT_OLDER_BUTTON && FaultMenuIndex < faultLogCount() - 1)
+    {
+        FaultMenuIndex++;
+    }
 }
 
 void handleArmSystemMenu(SystemStatus_t *systemStatus, JoystickHidData_t *joystickHidData)
@@ -786,16 +1345,7 @@ void handleArmSystemMenu(SystemStatus_t *systemStatus, JoystickHidData_t *joysti
     // If the system is armed, draw the arm status and prompt the user to disarm the system
     if (systemStatus->isFullyArmed || systemStatus->isSoftwareArmed || systemStatus->isPhysicallyArmed)
     {
-        drawCenteredText("Press 1\nto Disarm", CENTER_VERTICALLY);
-
-        // If the disarm button is pressed, request to disarm the system
-        if (joystickHidData->buttons & DISARM_BUTTON)
-        {
-            systemStatus->requestedArmState = false;
-            systemStatus->softwareArmUpdateRequested = true;
-            ArmUnlockCode = 0;
-        }
-
+        drawBodyText("Press 1\nto Disarm");
         return;
     }
     
@@ -810,56 +1360,18 @@ void handleArmSystemMenu(SystemStatus_t *systemStatus, JoystickHidData_t *joysti
         ArmDigitsEntered = 0;
     }
 
-    // If a button is pressed, and it is the next digit in the unlock code, increment the digit count.
-    // If the button is not the next digit, reset the digit count
-    if (ArmDigitsEntered < 4)
-    {
-        // Determine the next digit in the unlock code the user needs to enter to arm the system
-        int nextDigit = (ArmUnlockCode >> (2 * ArmDigitsEntered)) & 0b11;
-
-        //
-        // It just so happends that mask value for each of the joystick buttons 1-4 are their face value in binary like this:
-        // 1 = 0b0001
-        // 2 = 0b0010
-        // 3 = 0b0100
-        // 4 = 0b1000
-        // This means that we can use the next digit value directlyed to custruct a buttom mask rather than using a mapping
-        //
-
-        // If correct next digit button is pressed, increment the digit count
-        if (joystickHidData->buttons & (1 << nextDigit))
-        {
-            NextArmDigitPressed = true;
-        }
-        else if (NextArmDigitPressed)
-        {
-            ArmDigitsEntered++;
-            NextArmDigitPressed = false;
-            lastArmDigitEnteredMillis = millis();
-
-            // If the user has entered all four digits, request to arm the system
-            if (ArmDigitsEntered == 4)
-            {
-                systemStatus->requestedArmState = true;
-                systemStatus->softwareArmUpdateRequested = true;
-            }
-        }
-
-        // If an invalid button is pressed, reset the digit count
-        else if (joystickHidData->buttons != 0)
-        {
-            ArmDigitsEntered = 0;
-            NextArmDigitPressed = false;
-        }
-    }
-
     // If it has been more than ARM_DIGITS_TIMEOUT since the last digit was entered, reset the unlock code
-    if (!NextArmDigitPressed && !(ArmDigitsEntered == 4) && millis() - lastArmDigitEnteredMillis > ARM_DIGITS_TIMEOUT)
+    if (!NextArmDigitPressed && !(ArmDigitsEntered == 4) && micros() - lastArmDigitEnteredMicros > ARM_DIGITS_TIMEOUT * 1000UL)
     {
         ArmDigitsEntered = 0;
     }
     
     // Draw the arm code to the display
+    // The arm code is only redrawn when the code or the entry progress changes
+    if (!uxWidgetNeedsRedraw(UX_WIDGET_BODY, uxHash(ArmUnlockCode | (ArmDigitsEntered << 8) | (NextArmDigitPressed << 16))))
+    {
+        return;
+    }
     int armCodeY = ((Display.height() - MENU_HEADER_HEIGHT) / 2) - (MENU_LINE_HEIGHT / 2) + MENU_HEADER_HEIGHT;
     int armCodeX = 12;
     for (int currentArmDigitIndex = 0; currentArmDigitIndex < 4; currentArmDigitIndex++)
@@ -905,3 +1417,228 @@ void handleArmSystemMenu(SystemStatus_t *systemStatus, JoystickHidData_t *joysti
         }
     }
 }
+
+void handleArmSystemInput(SystemStatus_t *systemStatus, const JoystickEvent_t *event)
+{
+    // The arm system menu only takes input while connected to the aggregator
+    // A digit only counts if it is pressed and released while the unlock code is shown
+    if (!systemStatus->isConnected)
+    {
+        NextArmDigitPressed = false;
+        return;
+    }
+
+    // If the system is armed and the disarm button is pressed, request to disarm the system
+    if (systemStatus->isFullyArmed || systemStatus->isSoftwareArmed || systemStatus->isPhysicallyArmed)
+    {
+        if (event->type == JOYSTICK_EVENT_PRESS && event->button == DISARM_BUTTON)
+        {
+            systemStatus->requestedArmState = false;
+            systemStatus->softwareArmUpdateRequested = true;
+            ArmUnlockCode = 0;
+        }
+        return;
+    }
+
+    // If a button is pressed, and it is the next digit in the unlock code, increment the digit count.
+    // If the button is not the next digit, reset the digit count
+    // The unlock code is generated when the menu is first drawn
+    if (ArmUnlockCode != 0 && ArmDigitsEntered < 4)
+    {
+        // Determine the next digit in the unlock code the user needs to enter to arm the system
+        int nextDigit = (ArmUnlockCode >> (2 * ArmDigitsEntered)) & 0b11;
+
+        //
+        // It just so happends that mask value for each of the joystick buttons 1-4 are their face value in binary like this:
+        // 1 = 0b0001
+        // 2 = 0b0010
+        // 3 = 0b0100
+        // 4 = 0b1000
+        // This means that we can use the next digit value directlyed to custruct a buttom mask rather than using a mapping
+        //
+
+        // If correct next digit button is pressed and released, increment the digit count
+        uint32_t nextDigitButton = 1 << nextDigit;
+        if (event->type == JOYSTICK_EVENT_PRESS && event->button == nextDigitButton)
+        {
+            NextArmDigitPressed = true;
+        }
+        else if (event->type == JOYSTICK_EVENT_RELEASE && event->button == nextDigitButton && NextArmDigitPressed)
+        {
+            ArmDigitsEntered++;
+            NextArmDigitPressed = false;
+            lastArmDigitEnteredMicros = event->timeMicros;
+
+            // If the user has entered all four digits, request to arm the system
+            if (ArmDigitsEntered == 4)
+            {
+                systemStatus->requestedArmState = true;
+                systemStatus->softwareArmUpdateRequested = true;
+            }
+        }
+
+        // If an invalid button is pressed, reset the digit count
+        else if (event->type == JOYSTICK_EVENT_PRESS)
+        {
+            ArmDigitsEntered = 0;
+            NextArmDigitPressed = false;
+        }
+    }
+}
+
+void handleCalibrationMenu(SystemStatus_t *systemStatus, JoystickHidData_t *joystickHidData)
+{
+    drawMenuTitle("Calibrate");
+
+    // Draw the instructions for the current step
+    if (joystickHidIsCalibrating())
+    {
+        drawBodyText("Move sticks\nto the edges\nPress 1: save");
+    }
+    else if (CalibrationSaved)
+    {
+        drawBodyText("Saved\nPress 1 to\nrecalibrate");
+    }
+    else
+    {
+        drawBodyText("Center sticks\nPress 1 to\ncalibrate");
+    }
+}
+
+void handleCalibrationInput(SystemStatus_t *systemStatus, const JoystickEvent_t *event)
+{
+    // The calibrate button first captures the centers of the sticks (at rest), then saves the extents they were moved to
+    if (event->type != JOYSTICK_EVENT_PRESS || event->button != CALIBRATE_BUTTON)
+    {
+        return;
+    }
+
+    if (joystickHidIsCalibrating())
+    {
+        CalibrationSaveRequested = true;
+    }
+    else
+    {
+        joystickHidBeginCalibration();
+    }
+}
+
+void handleLoopMenu(SystemStatus_t *systemStatus, JoystickHidData_t *joystickHidData)
+{
+    drawMenuTitle("Loop");
+
+    // The statistics change on every loop, so they are only redrawn a few times a second
+    uint32_t statsModel = millis() / DEBUG_STATS_REFRESH_TIME;
+
+    // Draw the average and worst run time of the first two tasks, one per line
+    const UxWidgetId taskWidgets[] = { UX_WIDGET_LINE_1, UX_WIDGET_LINE_2 };
+    const int taskLines[] = { MENU_LINE_1, MENU_LINE_2 };
+    uint32_t overruns = 0;
+    uint32_t deferrals = 0;
+    for (int i = 0; i < schedulerTaskCount(); i++)
+    {
+        SchedulerTask_t *task = schedulerTask(i);
+        overruns += task->overruns;
+        deferrals += task->deferrals;
+        if (i < 2 && uxWidgetNeedsRedraw(taskWidgets[i], statsModel))
+        {
+            TextBuffer_t taskText;
+            textBufferClear(&taskText);
+            textBufferAppend(&taskText, task->name, 4);
+            textBufferAppend(&taskText, ' ');
+            textBufferAppendNumber(&taskText, task->averageRunMicros);
+            textBufferAppend(&taskText, '/');
+            textBufferAppendNumber(&taskText, task->maxRunMicros);
+            textBufferAppend(&taskText, "us");
+            Display.setCursor(0, taskLines[i]);
+            Display.write(taskText.text);
+        }
+    }
+
+    // Draw the share of the time the core slept and the worst wake latency
+    if (uxWidgetNeedsRedraw(UX_WIDGET_LINE_3, statsModel))
+    {
+        SchedulerIdleStats_t *idle = schedulerIdleStats();
+        uint32_t now = micros();
+        uint32_t idlePercent = (uint64_t)(idle->sleptMicros - LoopIdleSleptMicros) * 100 / max(now - LoopIdleSampleMicros, (uint32_t)1);
+        LoopIdleSleptMicros = idle->sleptMicros;
+        LoopIdleSampleMicros = now;
+
+        TextBuffer_t idleText;
+        textBufferClear(&idleText);
+        textBufferAppend(&idleText, "Idle ");
+        textBufferAppendNumber(&idleText, min(idlePercent, (uint32_t)100));
+        textBufferAppend(&idleText, "% ");
+        textBufferAppendNumber(&idleText, idle->maxWakeLatencyMicros);
+        textBufferAppend(&idleText, "us");
+        Display.setCursor(0, MENU_LINE_3);
+        Display.write(idleText.text);
+    }
+
+    // Draw the missed deadlines and put off display frames of all tasks on the last line
+    if (uxWidgetNeedsRedraw(UX_WIDGET_LINE_4, statsModel))
+    {
+        TextBuffer_t totalsText;
+        textBufferClear(&totalsText);
+        textBufferAppend(&totalsText, "Ovr:");
+        textBufferAppendNumber(&totalsText, overruns);
+        textBufferAppend(&totalsText, " Def:");
+        textBufferAppendNumber(&totalsText, deferrals);
+        Display.setCursor(0, MENU_LINE_4);
+        Display.write(totalsText.text);
+    }
+}
+
+void handleLatencyMenu(SystemStatus_t *systemStatus, JoystickHidData_t *joystickHidData)
+{
+    drawMenuTitle("Latency");
+
+    // The percentiles change with every message sent, so they are only redrawn a few times a second
+    uint32_t statsModel = millis() / DEBUG_STATS_REFRESH_TIME;
+
+    if (uxWidgetNeedsRedraw(UX_WIDGET_LINE_1, 0))
+    {
+        Display.setCursor(0, MENU_LINE_1);
+        Display.write("p50/p99 us");
+    }
+
+    // Draw the median and worst case input to wire time of each kind of request, one per line
+    const char *kindNames[] = { "Prop ", "Trig " };
+    const UxWidgetId kindWidgets[] = { UX_WIDGET_LINE_2, UX_WIDGET_LINE_3 };
+    const int kindLines[] = { MENU_LINE_2, MENU_LINE_3 };
+    for (int kind = 0; kind < LATENCY_TRACE_KIND_COUNT; kind++)
+    {
+        LatencyTraceKind traceKind = (LatencyTraceKind)kind;
+        if (uxWidgetNeedsRedraw(kindWidgets[kind], statsModel))
+        {
+            TextBuffer_t latencyText;
+            textBufferClear(&latencyText);
+            textBufferAppend(&latencyText, kindNames[kind]);
+            if (latencyTraceSampleCount(traceKind) == 0)
+            {
+                textBufferAppend(&latencyText, '-');
+            }
+            else
+            {
+                textBufferAppendNumber(&latencyText, latencyTracePercentile(traceKind, LATENCY_STAGE_TOTAL, 50));
+                textBufferAppend(&latencyText, '/');
+                textBufferAppendNumber(&latencyText, latencyTracePercentile(traceKind, LATENCY_STAGE_TOTAL, 99));
+            }
+            Display.setCursor(0, kindLines[kind]);
+            Display.write(latencyText.text);
+        }
+    }
+
+    // Draw the number of traces the percentiles are taken over on the last line
+    if (uxWidgetNeedsRedraw(UX_WIDGET_LINE_4, statsModel))
+    {
+        TextBuffer_t countText;
+        textBufferClear(&countText);
+        textBufferAppend(&countText, "N:");
+        textBufferAppendNumber(&countText, latencyTraceSampleCount(LATENCY_TRACE_PROPULSION));
+        textBufferAppend(&countText, '/');
+        textBufferAppendNumber(&countText, latencyTraceSampleCount(LATENCY_TRACE_TRIGGER));
+        Display.setCursor(0, MENU_LINE_4);
+        Display.write(countText.text);
+    }
+}
@@ -10,8 +10,23 @@ void uxInit();
 // Determines if the display needs to be updated based on the joystick, coms data and the internal UX refresh rate
 bool uxUpdateRequired(bool joystickUpdated, bool comsUpdated);
 
+// Handle the joystick input: menu selection, sequence trigger and abort, visual test and propulsion requests
+// Call this after every joystick HID update, so requests to the aggregator don't wait on the next display update
+void uxHandleInput(SystemStatus_t *systemStatus, JoystickHidData_t *joystickHidData);
+
 // Update the user experience (update the display output based on the current system status and user input)
 void uxUpdate(SystemStatus_t *systemStatus, JoystickHidData_t *joystickHidData);
 
+#ifdef UX_PROFILE
+// Print the average and worst render time and the display bytes sent per update of each menu
+void uxProfilePrint(Print *out);
+
+// Clear the render statistics
+void uxProfileReset();
+
+// Write the current display buffer as a binary PBM image, so frames can be compared between builds
+void uxWriteFramePbm(Print *out);
+#endif
+
 
 #endif // end _UX_H_
\ No newline at end of file
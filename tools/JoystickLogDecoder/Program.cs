@@ -0,0 +1,198 @@
+﻿using System.IO.Ports;
+using System.Text;
+using System.Text.RegularExpressions;
+
+//
+// Decodes the binary log records written by the joystick firmware (see firmware/Joystick/src/logger.h)
+// Usage: JoystickLogDecoder <serial port or capture file> [path to logFormats.h] [--hid-capture <output file>]
+// With --hid-capture, the joystick reports of LOG_HID_CAPTURE records are also written to the output file
+// as a capture the firmware can replay (see firmware/Joystick/src/hidCapture.h)
+// When records were lost (dropped by the firmware or skipped here), each joystick's reports are left out of the
+// capture until its next keyframe, so the capture never holds a report decoded from the wrong state
+//
+
+const byte LogRecordStart = 0x1E;
+const string HidCaptureFormatName = "LOG_HID_CAPTURE";
+const string RecordsDroppedFormatName = "LOG_RECORDS_DROPPED";
+const byte HidCaptureDeviceMask = 0x0F;
+const byte HidCaptureKeyframe = 0x40;
+
+List<string> positionalArgs = new List<string>();
+string? hidCapturePath = null;
+for (int i = 0; i < args.Length; i++)
+{
+    if (args[i] == "--hid-capture" && i + 1 < args.Length)
+    {
+        hidCapturePath = args[++i];
+    }
+    else
+    {
+        positionalArgs.Add(args[i]);
+    }
+}
+
+if (positionalArgs.Count < 1)
+{
+    Console.WriteLine("Usage: JoystickLogDecoder <serial port or capture file> [path to logFormats.h] [--hid-capture <output file>]");
+    return;
+}
+
+string formatsPath = positionalArgs.Count > 1 ? positionalArgs[1] : Path.Combine("..", "..", "firmware", "Joystick", "src", "logFormats.h");
+List<string> LogFormatNames = new List<string>();
+List<string> LogFormats = ReadLogFormats(formatsPath, LogFormatNames);
+int hidCaptureFormatId = LogFormatNames.IndexOf(HidCaptureFormatName);
+int recordsDroppedFormatId = LogFormatNames.IndexOf(RecordsDroppedFormatName);
+Console.WriteLine($"Loaded {LogFormats.Count} log formats from {formatsPath}");
+
+Stream logStream = OpenLogStream(positionalArgs[0]);
+BinaryReader reader = new BinaryReader(logStream);
+FileStream? hidCaptureStream = hidCapturePath != null ? File.Create(hidCapturePath) : null;
+
+//
+// Main Loop
+//
+
+long skippedBytes = 0;
+HashSet<int> hidCaptureSyncedDevices = new HashSet<int>(); // Joysticks whose state is known since the last lost records
+try
+{
+    while (true)
+    {
+        // Find the start of the next record, anything else means bytes were lost or the stream isn't a log
+        byte start = reader.ReadByte();
+        if (start != LogRecordStart)
+        {
+            skippedBytes++;
+            continue;
+        }
+        if (skippedBytes > 0)
+        {
+            Console.WriteLine($"*** skipped {skippedBytes} bytes ***");
+            skippedBytes = 0;
+            hidCaptureSyncedDevices.Clear();
+        }
+
+        byte formatId = reader.ReadByte();
+        if (formatId >= LogFormats.Count)
+        {
+            Console.WriteLine($"*** unknown log format {formatId} ***");
+            continue;
+        }
+
+        uint timestampMicros = reader.ReadUInt32();
+        List<byte[]> binaryArgs = new List<byte[]>();
+        Console.WriteLine($"[{timestampMicros / 1000000.0,12:F6}] {FormatRecord(LogFormats[formatId], reader, binaryArgs)}");
+
+        // Capture records only hold what changed, so after lost records every joystick waits for its next keyframe
+        if (formatId == recordsDroppedFormatId)
+        {
+            hidCaptureSyncedDevices.Clear();
+        }
+
+        // Joystick reports are also saved for replay
+        if (hidCaptureStream != null && formatId == hidCaptureFormatId)
+        {
+            foreach (byte[] data in binaryArgs)
+            {
+                if (data.Length == 0)
+                {
+                    continue;
+                }
+                int device = data[0] & HidCaptureDeviceMask;
+                if ((data[0] & HidCaptureKeyframe) != 0)
+                {
+                    hidCaptureSyncedDevices.Add(device);
+                }
+                if (hidCaptureSyncedDevices.Contains(device))
+                {
+                    hidCaptureStream.Write(data);
+                }
+            }
+            hidCaptureStream.Flush();
+        }
+    }
+}
+catch (EndOfStreamException)
+{
+    // The capture file ended
+}
+finally
+{
+    hidCaptureStream?.Dispose();
+}
+
+
+//
+// Functions
+//
+
+List<string> ReadLogFormats(string path, List<string> names)
+{
+    // The formats are the LOG_FORMAT(id, "text") entries of the LOG_FORMATS list, in order
+    List<string> formats = new List<string>();
+    Regex formatEntry = new Regex("LOG_FORMAT\\(\\s*(\\w+)\\s*,\\s*\"((?:[^\"\\\\]|\\\\.)*)\"\\s*\\)");
+    foreach (Match match in formatEntry.Matches(File.ReadAllText(path)))
+    {
+        names.Add(match.Groups[1].Value);
+        formats.Add(Regex.Unescape(match.Groups[2].Value));
+    }
+    return formats;
+}
+
+Stream OpenLogStream(string source)
+{
+    // Read a capture file if there is one with this name, otherwise read straight from the serial port
+    if (File.Exists(source))
+    {
+        return File.OpenRead(source);
+    }
+
+    SerialPort serialPort = new SerialPort(source, 115200, Parity.None, 8, StopBits.One)
+    {
+        ReadTimeout = SerialPort.InfiniteTimeout
+    };
+    serialPort.Open();
+    Console.WriteLine("Serial port opened successfully.");
+    return serialPort.BaseStream;
+}
+
+string FormatRecord(string format, BinaryReader reader, List<byte[]> binaryArgs)
+{
+    // Integers are 4 bytes (little endian), strings and binary data are a length byte followed by the bytes
+    Regex specifier = new Regex("%([-+ 0#]*\\d*)([duxXsb%])");
+    return specifier.Replace(format, match =>
+    {
+        string flags = match.Groups[1].Value;
+        switch (match.Groups[2].Value)
+        {
+            case "d":
+                return FormatInteger(reader.ReadInt32(), flags, "D");
+            case "u":
+                return FormatInteger(reader.ReadUInt32(), flags, "D");
+            case "x":
+                return FormatInteger(reader.ReadUInt32(), flags, "x");
+            case "X":
+                return FormatInteger(reader.ReadUInt32(), flags, "X");
+            case "s":
+                byte length = reader.ReadByte();
+                return Encoding.ASCII.GetString(reader.ReadBytes(length));
+            case "b":
+                byte[] data = reader.ReadBytes(reader.ReadByte());
+                binaryArgs.Add(data);
+                return Convert.ToHexString(data);
+            default:
+                return "%";
+        }
+    });
+}
+
+string FormatInteger(long value, string flags, string format)
+{
+    // Only zero padding (e.g. %02x) is supported, other flags are ignored
+    int width = 0;
+    if (flags.StartsWith("0"))
+    {
+        int.TryParse(flags, out width);
+    }
+    return value.ToString(format + (width > 0 ? width.ToString() : ""));
+}